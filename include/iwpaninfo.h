@@ -21,6 +21,12 @@
 
 #define IWPANINFO_BUFSIZE	32 * 1024
 
+/*
+ * Upper bound for tables holding one entry per interface. Callers that
+ * hit it learn the real count from iwpaninfo_dump_total().
+ */
+#define IWPANINFO_MAX_IFACES	256
+
 #define DBM_TO_MBM(gain)						\
 	((int)(((float)gain) * 100))
 #define MBM_TO_DBM(gain)						\
@@ -35,18 +41,156 @@ enum iwpaninfo_opmode {
 
 extern const char *IWPANINFO_OPMODE_NAMES[];
 
+/* the fixed point members are appended, filled along with the floats */
 struct iwpaninfo_txpwrlist_entry {
 	float dbm;
 //	float mw;
+	int32_t mbm;
+	uint32_t uw;
 };
 
 struct iwpaninfo_cca_ed_lvl_list_entry {
 	float dbm;
+	int32_t mbm;
 };
 
 struct iwpaninfo_freqlist_entry {
 	uint8_t channel;
 	float mhz;
+	uint32_t khz;
+};
+
+/*
+ * Fixed point counterparts of the list entries above, filled by
+ * iwpaninfo_get_txpwrlist() and friends without any floating point.
+ */
+struct iwpaninfo_txpwrlist_entry_mbm {
+	int32_t mbm;
+	uint32_t uw;
+};
+
+struct iwpaninfo_cca_ed_lvl_list_entry_mbm {
+	int32_t mbm;
+};
+
+struct iwpaninfo_freqlist_entry_khz {
+	uint8_t page;
+	uint8_t channel;
+	uint32_t khz;
+};
+
+enum iwpaninfo_field {
+	IWPANINFO_FIELD_IFINDEX		= (1 << 0),
+	IWPANINFO_FIELD_PHY		= (1 << 1),
+	IWPANINFO_FIELD_WPAN_DEV	= (1 << 2),
+	IWPANINFO_FIELD_MODE		= (1 << 3),
+	IWPANINFO_FIELD_PAGE		= (1 << 4),
+	IWPANINFO_FIELD_CHANNEL		= (1 << 5),
+	IWPANINFO_FIELD_FREQUENCY	= (1 << 6),
+	IWPANINFO_FIELD_TXPOWER		= (1 << 7),
+	IWPANINFO_FIELD_PANID		= (1 << 8),
+	IWPANINFO_FIELD_SHORT_ADDR	= (1 << 9),
+	IWPANINFO_FIELD_EXTENDED_ADDR	= (1 << 10),
+	IWPANINFO_FIELD_MIN_BE		= (1 << 11),
+	IWPANINFO_FIELD_MAX_BE		= (1 << 12),
+	IWPANINFO_FIELD_CSMA_BACKOFF	= (1 << 13),
+	IWPANINFO_FIELD_FRAME_RETRY	= (1 << 14),
+	IWPANINFO_FIELD_LBT_MODE	= (1 << 15),
+	IWPANINFO_FIELD_CCA_MODE	= (1 << 16),
+	IWPANINFO_FIELD_CCA_OPT		= (1 << 17),
+	IWPANINFO_FIELD_CCA_ED_LEVEL	= (1 << 18),
+};
+
+#define IWPANINFO_FIELD_COUNT	19
+#define IWPANINFO_FIELD_ALL	((1 << IWPANINFO_FIELD_COUNT) - 1)
+
+extern const char *IWPANINFO_FIELD_NAMES[];
+
+/*
+ * The layouts of struct iwpaninfo_info and struct iwpaninfo_phy_caps are
+ * part of the library ABI and mirrored by the LuaJIT FFI binding, bump
+ * IWPANINFO_ABI_VERSION whenever either of them changes.
+ */
+#define IWPANINFO_ABI_VERSION	3
+
+/*
+ * Snapshot of one interface and its phy, filled from a single exchange
+ * with the backend. Only members flagged in valid carry data.
+ */
+struct iwpaninfo_info {
+	uint64_t wpan_dev;
+	uint64_t extended_address;
+	uint32_t valid;
+	uint32_t ifindex;
+	uint32_t phy;
+	int32_t txpower;		/* mBm */
+	int32_t cca_ed_level;		/* mBm */
+	uint32_t frequency;		/* kHz */
+	uint16_t panid;
+	uint16_t short_address;
+	uint8_t mode;
+	uint8_t page;
+	uint8_t channel;
+	uint8_t min_be;
+	uint8_t max_be;
+	uint8_t csma_backoff;
+	int8_t frame_retry;
+	uint8_t lbt_mode;
+	uint8_t cca_mode;
+	uint8_t cca_opt;
+	char ifname[IFNAMSIZ];
+	char phyname[32];
+};
+
+#define IWPANINFO_MAX_PAGES		32
+#define IWPANINFO_MAX_TXPOWERS		64
+#define IWPANINFO_MAX_CCA_ED_LEVELS	64
+
+/* command bitmaps span several words, nl802154 already has ids past 31 */
+#define IWPANINFO_MAX_COMMANDS		128
+#define IWPANINFO_COMMAND_WORDS		(IWPANINFO_MAX_COMMANDS / 32)
+
+/* Capability ranges of a phy as announced by the driver */
+struct iwpaninfo_phy_caps {
+	uint32_t channels[IWPANINFO_MAX_PAGES];		/* channel bitmap per page */
+	int32_t txpowers[IWPANINFO_MAX_TXPOWERS];	/* mBm */
+	int32_t cca_ed_levels[IWPANINFO_MAX_CCA_ED_LEVELS];	/* mBm */
+	uint32_t num_txpowers;
+	uint32_t num_cca_ed_levels;
+	uint32_t iftypes;	/* bitmap of nl802154_iftype */
+	uint32_t cca_modes;	/* bitmap of nl802154_cca_modes */
+	uint32_t cca_opts;	/* bitmap of nl802154_cca_opts */
+	uint32_t lbt;		/* nl802154_supported_bool_states */
+	uint32_t commands[IWPANINFO_COMMAND_WORDS];	/* nl802154_commands, empty if not announced */
+	uint8_t min_minbe;
+	uint8_t max_minbe;
+	uint8_t min_maxbe;
+	uint8_t max_maxbe;
+	uint8_t min_csma_backoffs;
+	uint8_t max_csma_backoffs;
+	int8_t min_frame_retries;
+	int8_t max_frame_retries;
+};
+
+struct iwpaninfo_ops;
+
+/*
+ * Resolved device handle, see iwpaninfo_dev_open(). Backends prefer the
+ * wpan_dev id when it is set, it stays valid across interface renames.
+ */
+struct iwpaninfo_dev {
+	const struct iwpaninfo_ops *ops;
+	char ifname[IFNAMSIZ];
+	int ifindex;
+	int phy;
+	uint64_t wpan_dev;
+};
+
+/* Non-blocking info request, the caller polls fd for readability */
+struct iwpaninfo_async {
+	int fd;
+	struct iwpaninfo_info info;
+	void *priv;
 };
 
 struct iwpaninfo_ops {
@@ -73,6 +217,22 @@ struct iwpaninfo_ops {
 	int (*lbt_mode)(const char *, int *);
 	int (*cca_mode)(const char *, int *);
 	int (*cca_opt)(const char *, int *);
+	int (*info)(const char *, struct iwpaninfo_info *);
+	int (*dump)(char *, int *);
+	int (*caps)(const char *, struct iwpaninfo_phy_caps *);
+	int (*lookup)(const char *, struct iwpaninfo_dev *);
+	int (*dev_info)(const struct iwpaninfo_dev *, struct iwpaninfo_info *);
+	int (*dev_caps)(const struct iwpaninfo_dev *, struct iwpaninfo_phy_caps *);
+	int (*dev_query)(const struct iwpaninfo_dev *, uint32_t, struct iwpaninfo_info *);
+	int (*commands)(const char *, uint32_t *);	/* IWPANINFO_COMMAND_WORDS */
+	int (*query)(const char *, uint32_t, struct iwpaninfo_info *);
+	int (*raw)(const char *, char *, int *);
+	int (*decode)(const char *, int, uint32_t, struct iwpaninfo_info *);
+	int (*async_start)(const struct iwpaninfo_dev *, struct iwpaninfo_async *);
+	int (*async_poll)(struct iwpaninfo_async *);
+	void (*async_free)(struct iwpaninfo_async *);
+	int (*event_open)(void);
+	int (*event_read)(void);
 	void (*close)(void);
 };
 
@@ -80,9 +240,44 @@ const char * iwpaninfo_type(const char *ifname);
 const struct iwpaninfo_ops * iwpaninfo_backend(const char *ifname);
 const struct iwpaninfo_ops * iwpaninfo_backend_by_name(const char *name);
 void iwpaninfo_finish(void);
+void iwpaninfo_thread_finish(void);
+
+int iwpaninfo_dev_open(const char *ifname, struct iwpaninfo_dev *dev);
+int iwpaninfo_dev_query(const struct iwpaninfo_dev *dev, uint32_t mask,
+                        struct iwpaninfo_info *info);
+
+unsigned int iwpaninfo_abi_version(void);
+int iwpaninfo_get_info(const char *ifname, struct iwpaninfo_info *info);
+int iwpaninfo_get_caps(const char *ifname, struct iwpaninfo_phy_caps *caps);
+int iwpaninfo_get_commands(const char *ifname,
+                           uint32_t commands[IWPANINFO_COMMAND_WORDS]);
+int iwpaninfo_cmd_supported(const char *ifname, int cmd);
+int iwpaninfo_get_dump(struct iwpaninfo_info *info, int max);
+int iwpaninfo_get_info_live(const char *ifname, struct iwpaninfo_info *info);
+int iwpaninfo_get_dump_live(struct iwpaninfo_info *info, int max);
+int iwpaninfo_dump_total(void);
+int iwpaninfo_query(const char *ifname, uint32_t mask,
+                    struct iwpaninfo_info *info);
+int iwpaninfo_get_txpwrlist(const char *ifname,
+                            struct iwpaninfo_txpwrlist_entry_mbm *e, int max);
+int iwpaninfo_get_cca_ed_lvl_list(const char *ifname,
+                                  struct iwpaninfo_cca_ed_lvl_list_entry_mbm *e,
+                                  int max);
+int iwpaninfo_get_freqlist(const char *ifname,
+                           struct iwpaninfo_freqlist_entry_khz *e, int max);
+
+uint32_t iwpaninfo_info_changed(const struct iwpaninfo_info *a,
+                                const struct iwpaninfo_info *b);
 
 extern const struct iwpaninfo_ops nl802154_ops;
 
 #include "iwpaninfo/utils.h"
+#include "iwpaninfo/shm.h"
+#include "iwpaninfo/rtnl.h"
+#include "iwpaninfo/topology.h"
+#include "iwpaninfo/executor.h"
+#include "iwpaninfo/snapshot.h"
+#include "iwpaninfo/history.h"
+#include "iwpaninfo/image.h"
 
 #endif
@@ -0,0 +1,46 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Parallel query executor
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef __IWPANINFO_EXECUTOR_H_
+#define __IWPANINFO_EXECUTOR_H_
+
+#include "iwpaninfo.h"
+
+#define IWPANINFO_EXEC_MAX_THREADS	8
+
+/*
+ * Called once per interface, never concurrently. rv is 0 on success,
+ * info then holds the fields of mask that the interface reported.
+ */
+typedef void (*iwpaninfo_exec_cb)(int idx, const char *ifname, int rv,
+                                  const struct iwpaninfo_info *info,
+                                  void *priv);
+
+/*
+ * Query ifnames on up to threads workers (0 picks one per online CPU,
+ * at most IWPANINFO_EXEC_MAX_THREADS), each with its own netlink context.
+ * Returns the number of successful queries or -1.
+ */
+int iwpaninfo_exec(const char **ifnames, int count, uint32_t mask, int threads,
+                   iwpaninfo_exec_cb cb, void *priv);
+
+/* Same, gathering into out[count]; failed entries have no valid fields */
+int iwpaninfo_exec_gather(const char **ifnames, int count, uint32_t mask,
+                          int threads, struct iwpaninfo_info *out);
+
+#endif
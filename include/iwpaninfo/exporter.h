@@ -0,0 +1,28 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Prometheus exporter
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef __IWPANINFO_EXPORTER_H_
+#define __IWPANINFO_EXPORTER_H_
+
+#define IWPANINFO_EXPORTER_LISTEN	"127.0.0.1:9154"
+#define IWPANINFO_EXPORTER_INTERVAL	15	/* s, counter refresh */
+
+/* Serve metrics on addr:port until the loop is terminated */
+int iwpaninfo_exporter_run(const char *addr, int interval);
+
+#endif
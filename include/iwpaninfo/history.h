@@ -0,0 +1,136 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Metric history
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef __IWPANINFO_HISTORY_H_
+#define __IWPANINFO_HISTORY_H_
+
+#include "iwpaninfo.h"
+
+/*
+ * Short term history of sampled metrics, kept in fixed size byte rings.
+ * The oldest sample of a ring is stored in full, every later one as a
+ * varint pair of the zigzag encoded change in sampling interval and in
+ * value, so a counter sampled at a steady rate costs two or three bytes
+ * per sample. A full ring drops its oldest samples to make room.
+ */
+
+enum iwpaninfo_metric {
+	IWPANINFO_METRIC_TXPOWER,	/* mBm */
+	IWPANINFO_METRIC_CHANNEL,
+	IWPANINFO_METRIC_CCA_MODE,
+	IWPANINFO_METRIC_CCA_OPT,
+	IWPANINFO_METRIC_CCA_ED_LEVEL,	/* mBm */
+	IWPANINFO_METRIC_RX_PACKETS,
+	IWPANINFO_METRIC_TX_PACKETS,
+	IWPANINFO_METRIC_RX_BYTES,
+	IWPANINFO_METRIC_TX_BYTES,
+	IWPANINFO_METRIC_RX_ERRORS,
+	IWPANINFO_METRIC_TX_ERRORS,
+	IWPANINFO_METRIC_RX_DROPPED,
+	IWPANINFO_METRIC_TX_DROPPED,
+};
+
+#define IWPANINFO_METRIC_COUNT	13
+
+extern const char *IWPANINFO_METRIC_NAMES[];
+
+struct iwpaninfo_sample {
+	int64_t ts;		/* CLOCK_REALTIME, ms */
+	int64_t value;
+};
+
+struct iwpaninfo_ring {
+	uint32_t size;		/* bytes of the data buffer */
+	uint32_t head;		/* offset of the oldest delta */
+	uint32_t len;		/* bytes in use */
+	uint32_t count;		/* samples, including the first */
+	int64_t first_ts;
+	int64_t first_val;
+	int64_t first_dt;
+	int64_t last_ts;
+	int64_t last_val;
+	int64_t last_dt;
+};
+
+void iwpaninfo_ring_init(struct iwpaninfo_ring *r, uint32_t size);
+int iwpaninfo_ring_push(struct iwpaninfo_ring *r, uint8_t *buf,
+                        int64_t ts, int64_t val);
+
+/*
+ * Copy the samples with from <= ts <= to, at most the newest last of them
+ * when last > 0 and never more than max, oldest first. Returns the number
+ * of samples copied.
+ */
+int iwpaninfo_ring_query(const struct iwpaninfo_ring *r, const uint8_t *buf,
+                         int64_t from, int64_t to, int last,
+                         struct iwpaninfo_sample *out, int max);
+
+/*
+ * The rings of all interfaces live in a POSIX shared memory object filled
+ * by iwpaninfo-shmd. Each interface gets one ring per metric, sized per
+ * metric at creation; a size of 0 disables a metric. Configuration
+ * values only get a sample when they change, counters on every record.
+ * History outlives its interface until the table is full, then the slot
+ * of the interface gone the longest is handed to a new one.
+ */
+
+#define IWPANINFO_HISTORY_NAME		"/iwpaninfo-history"
+#define IWPANINFO_HISTORY_MAGIC		0x54534948	/* "HIST" */
+#define IWPANINFO_HISTORY_VERSION	2
+#define IWPANINFO_HISTORY_MAX_RING	65536	/* bytes */
+
+#define IWPANINFO_HISTORY_SETTING_SIZE	256
+#define IWPANINFO_HISTORY_COUNTER_SIZE	2048
+
+struct iwpaninfo_history_iface {
+	char ifname[IFNAMSIZ];
+	uint32_t offset;	/* of the first ring buffer in the pool */
+	int64_t seen;		/* last record that carried it, ms */
+	struct iwpaninfo_ring rings[IWPANINFO_METRIC_COUNT];
+};
+
+struct iwpaninfo_history {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t pad;
+	uint32_t seq;
+	uint32_t count;
+	uint32_t pool_size;
+	uint32_t dropped;	/* interfaces the last record had no slot for */
+	uint32_t sizes[IWPANINFO_METRIC_COUNT];
+	struct iwpaninfo_history_iface ifaces[IWPANINFO_MAX_IFACES];
+	uint8_t pool[];
+};
+
+struct iwpaninfo_link_stats;
+
+int iwpaninfo_metric_by_name(const char *name);
+
+/* Publisher, sizes is indexed by metric, NULL selects the defaults */
+struct iwpaninfo_history * iwpaninfo_history_create(const uint32_t *sizes);
+void iwpaninfo_history_record(struct iwpaninfo_history *h,
+                              const struct iwpaninfo_info *info, int n,
+                              const struct iwpaninfo_link_stats *links, int m);
+void iwpaninfo_history_destroy(struct iwpaninfo_history *h);
+
+/* Reader, same selection as iwpaninfo_ring_query(), -1 without history */
+int iwpaninfo_history_query(const char *ifname, int metric,
+                            int64_t from, int64_t to, int last,
+                            struct iwpaninfo_sample *out, int max);
+
+#endif
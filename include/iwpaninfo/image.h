@@ -0,0 +1,182 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Binary state images
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef __IWPANINFO_IMAGE_H_
+#define __IWPANINFO_IMAGE_H_
+
+#include "iwpaninfo.h"
+
+/*
+ * Binary image of the device state: interfaces, phy capabilities and
+ * link counters. All integers are little endian and every record is
+ * naturally aligned, so on little endian hosts a mapped file can be read
+ * in place through iwpaninfo_image_section(). The image starts with a
+ * header, followed by the section table and the sections themselves:
+ *
+ *	header | section[num_sections] | section data ...
+ *
+ * Sections are arrays of fixed size records located by offset. Records
+ * carry their size as stride; later minor revisions may only append
+ * members, readers skip what they do not know. A change to an existing
+ * member bumps IWPANINFO_IMAGE_VERSION and is rejected by older readers.
+ */
+
+#define IWPANINFO_IMAGE_MAGIC	0x49505749	/* "IWPI" */
+#define IWPANINFO_IMAGE_VERSION	1
+
+/* file name suffix of exported images, see iwpaninfo export */
+#define IWPANINFO_IMAGE_SUFFIX	".iwpi"
+
+enum iwpaninfo_image_type {
+	IWPANINFO_IMAGE_IFACES	= 1,	/* struct iwpaninfo_image_iface */
+	IWPANINFO_IMAGE_PHYS	= 2,	/* struct iwpaninfo_image_phy */
+	IWPANINFO_IMAGE_LINKS	= 3,	/* struct iwpaninfo_image_link */
+	IWPANINFO_IMAGE_VALUES	= 4,	/* uint32_t, referenced by phys */
+};
+
+struct iwpaninfo_image_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t header_size;		/* offset of the section table */
+	uint32_t size;			/* of the whole image */
+	uint32_t num_sections;
+	uint64_t timestamp;		/* CLOCK_REALTIME, ms */
+	char hostname[64];
+	uint32_t dropped;		/* interfaces left out, 0 in older images */
+	uint32_t pad;
+};
+
+/* header size of the first writers, before dropped was appended */
+#define IWPANINFO_IMAGE_HEADER_MIN	88
+
+struct iwpaninfo_image_section {
+	uint32_t type;
+	uint32_t offset;		/* from the start of the image */
+	uint32_t count;
+	uint32_t stride;		/* record size */
+};
+
+struct iwpaninfo_image_iface {
+	uint64_t wpan_dev;
+	uint64_t extended_address;
+	uint32_t valid;			/* IWPANINFO_FIELD_* */
+	uint32_t ifindex;
+	uint32_t phy;
+	int32_t txpower;		/* mBm */
+	int32_t cca_ed_level;		/* mBm */
+	uint32_t frequency;		/* kHz */
+	uint16_t panid;
+	uint16_t short_address;
+	uint8_t mode;
+	uint8_t page;
+	uint8_t channel;
+	uint8_t min_be;
+	uint8_t max_be;
+	uint8_t csma_backoff;
+	int8_t frame_retry;
+	uint8_t lbt_mode;
+	uint8_t cca_mode;
+	uint8_t cca_opt;
+	uint8_t pad[2];
+	char ifname[16];
+	char phyname[32];
+};
+
+/* Arrays are runs in the VALUES section, given as index and length */
+struct iwpaninfo_image_phy {
+	uint32_t phy;
+	uint32_t iftypes;
+	uint32_t cca_modes;
+	uint32_t cca_opts;
+	uint32_t lbt;
+	uint32_t channels;		/* channel bitmap per page */
+	uint32_t num_pages;
+	uint32_t txpowers;		/* mBm */
+	uint32_t num_txpowers;
+	uint32_t cca_ed_levels;		/* mBm */
+	uint32_t num_cca_ed_levels;
+	uint8_t min_minbe;
+	uint8_t max_minbe;
+	uint8_t min_maxbe;
+	uint8_t max_maxbe;
+	uint8_t min_csma_backoffs;
+	uint8_t max_csma_backoffs;
+	int8_t min_frame_retries;
+	int8_t max_frame_retries;
+	uint32_t commands;		/* ids 0-31, 0 in images of older writers */
+	char phyname[32];
+	uint32_t commands_hi[IWPANINFO_COMMAND_WORDS - 1];	/* ids from 32 on */
+};
+
+/* phy record size of the first writers, before commands_hi was appended */
+#define IWPANINFO_IMAGE_PHY_MIN		88
+
+struct iwpaninfo_image_link {
+	char ifname[16];
+	uint32_t ifindex;
+	uint32_t link;
+	uint32_t flags;			/* IFF_* */
+	uint32_t type;			/* enum iwpaninfo_link_type */
+	uint64_t rx_packets;
+	uint64_t tx_packets;
+	uint64_t rx_bytes;
+	uint64_t tx_bytes;
+	uint64_t rx_errors;
+	uint64_t tx_errors;
+	uint64_t rx_dropped;
+	uint64_t tx_dropped;
+};
+
+/* A validated image, either mapped from a file or borrowed from memory */
+struct iwpaninfo_image {
+	const uint8_t *data;
+	size_t len;
+	int mapped;
+};
+
+struct iwpaninfo_link_stats;
+
+/* Collect the live state into a malloc()ed image of *len bytes */
+void * iwpaninfo_image_build(size_t *len);
+
+int iwpaninfo_image_open(struct iwpaninfo_image *img, const void *buf, size_t len);
+int iwpaninfo_image_map(struct iwpaninfo_image *img, const char *path);
+void iwpaninfo_image_close(struct iwpaninfo_image *img);
+
+const struct iwpaninfo_image_header *
+iwpaninfo_image_header(const struct iwpaninfo_image *img);
+
+/* Interfaces the writer had no room for */
+uint32_t iwpaninfo_image_dropped(const struct iwpaninfo_image *img);
+
+/* Raw little endian records of a section, NULL if absent */
+const void * iwpaninfo_image_section(const struct iwpaninfo_image *img,
+                                     uint32_t type, uint32_t *count,
+                                     uint32_t *stride);
+
+/* Host order copies, each returns the number of records or -1 */
+int iwpaninfo_image_ifaces(const struct iwpaninfo_image *img,
+                           struct iwpaninfo_info *info, int max);
+int iwpaninfo_image_links(const struct iwpaninfo_image *img,
+                          struct iwpaninfo_link_stats *links, int max);
+
+/* Capabilities of the idx-th phy, returns its phy index or -1 */
+int iwpaninfo_image_caps(const struct iwpaninfo_image *img, int idx,
+                         char *phyname, struct iwpaninfo_phy_caps *caps);
+
+#endif
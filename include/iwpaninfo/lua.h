@@ -26,6 +26,8 @@
 #include <lualib.h>
 #include <lauxlib.h>
 
+#include <libubox/uloop.h>
+
 #include "iwpaninfo.h"
 
 
@@ -33,11 +35,54 @@
 
 #ifdef USE_NL802154
 #define IWPANINFO_NL802154_META	"iwpaninfo.nl802154"
+#define LUA_WRAP_DEV_FIELD(op,field)				\
+	static int iwpaninfo_L_dev_##op(lua_State *L)		\
+	{							\
+		return iwpaninfo_L_dev_field(L, field);		\
+	}
+
 #endif
 
+#define IWPANINFO_DEVICE_META	"iwpaninfo.device"
+
+/* Userdata behind iwpaninfo.open() */
+struct iwpaninfo_L_dev {
+	struct iwpaninfo_dev dev;
+	struct iwpaninfo_phy_caps *caps;
+};
+
+#define IWPANINFO_SNAPSHOT_META	"iwpaninfo.snapshot"
+
+/*
+ * Userdata behind snapshot(), holds the raw reply attributes and decodes
+ * a field the first time it is indexed.
+ */
+struct iwpaninfo_L_snapshot {
+	const struct iwpaninfo_ops *ops;
+	struct iwpaninfo_info info;	/* memoized fields */
+	uint32_t decoded;		/* fields looked up so far */
+	int len;
+	char raw[];
+};
+
+#define IWPANINFO_ASYNC_TIMEOUT	1000
+
+/* Pending info_async() call, owned by uloop until the coroutine resumes */
+struct iwpaninfo_L_async {
+	struct uloop_fd fd;
+	struct uloop_timeout timeout;
+	struct iwpaninfo_async req;
+	const struct iwpaninfo_ops *ops;
+	lua_State *co;
+	int ref;
+};
+
 #define LUA_REG(type,op) \
 	{ #op, iwinfo_L_##type##_##op }
 
+#define LUA_REG_DEV(op) \
+	{ #op, iwpaninfo_L_dev_##op }
+
 #define LUA_WRAP_INT_OP(type,op)				\
 	static int iwinfo_L_##type##_##op(lua_State *L)		\
 	{							\
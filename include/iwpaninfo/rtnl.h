@@ -0,0 +1,142 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Link statistics
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef __IWPANINFO_RTNL_H_
+#define __IWPANINFO_RTNL_H_
+
+#include <net/if_arp.h>
+
+#include "iwpaninfo.h"
+
+#ifndef ARPHRD_IEEE802154
+#define ARPHRD_IEEE802154	804
+#endif
+
+#ifndef ARPHRD_IEEE802154_MONITOR
+#define ARPHRD_IEEE802154_MONITOR	805
+#endif
+
+#ifndef ARPHRD_6LOWPAN
+#define ARPHRD_6LOWPAN		825
+#endif
+
+#define IWPANINFO_MAX_LINKS	64
+
+/* node and monitor interfaces both answer nl802154 queries */
+#define IWPANINFO_ARPHRD_WPAN(type) \
+	((type) == ARPHRD_IEEE802154 || (type) == ARPHRD_IEEE802154_MONITOR)
+
+enum iwpaninfo_link_type {
+	IWPANINFO_LINK_WPAN,
+	IWPANINFO_LINK_LOWPAN,
+};
+
+struct iwpaninfo_link_stats {
+	char ifname[IFNAMSIZ];
+	uint32_t ifindex;
+	uint32_t link;		/* lower device ifindex, 0 if none */
+	uint32_t flags;		/* IFF_* */
+	uint32_t type;		/* enum iwpaninfo_link_type */
+	uint64_t rx_packets;
+	uint64_t tx_packets;
+	uint64_t rx_bytes;
+	uint64_t tx_bytes;
+	uint64_t rx_errors;
+	uint64_t tx_errors;
+	uint64_t rx_dropped;
+	uint64_t tx_dropped;
+};
+
+#define IWPANINFO_LINK_RATE_SCALE	1000
+
+/*
+ * Per-second rates, the counters above divided by the sample interval,
+ * in units of 1/IWPANINFO_LINK_RATE_SCALE per second.
+ */
+struct iwpaninfo_link_rate {
+	char ifname[IFNAMSIZ];
+	uint32_t ifindex;
+	uint32_t interval;	/* ms covered by this rate */
+	uint64_t rx_packets;
+	uint64_t tx_packets;
+	uint64_t rx_bytes;
+	uint64_t tx_bytes;
+	uint64_t rx_errors;
+	uint64_t tx_errors;
+	uint64_t rx_dropped;
+	uint64_t tx_dropped;
+};
+
+struct iwpaninfo_link_rate_ctx {
+	uint64_t stamp;		/* CLOCK_MONOTONIC, ms */
+	int count;
+	struct iwpaninfo_link_stats prev[IWPANINFO_MAX_LINKS];
+};
+
+/* Fill stats of every wpan and lowpan link from one RTM_GETLINK dump */
+int iwpaninfo_link_stats(struct iwpaninfo_link_stats *stats, int max);
+
+/*
+ * Take a new sample and fill the rates since the previous one held in
+ * ctx (zero initialised before the first call). Returns the number of
+ * rates, 0 on the first call, -1 on error.
+ */
+int iwpaninfo_link_rates(struct iwpaninfo_link_rate_ctx *ctx,
+                         struct iwpaninfo_link_rate *rates, int max);
+
+struct iwpaninfo_netdev {
+	char ifname[IFNAMSIZ];
+	uint32_t ifindex;
+	uint32_t type;		/* ARPHRD_* */
+	uint32_t flags;		/* IFF_* */
+	uint32_t master;	/* IFLA_MASTER, 0 if none */
+	uint32_t link;		/* IFLA_LINK, 0 if none */
+	int32_t phy;		/* wpan phy index, -1 if unknown */
+};
+
+/*
+ * Registry of all network interfaces, opened on first use. Call
+ * iwpaninfo_registry_update() to apply pending link notifications before
+ * a lookup, it returns the number of changes or -1 if the registry is
+ * unavailable. Returned entries are valid until the next update; the fd
+ * can be polled to update from an event loop.
+ */
+int iwpaninfo_registry_fd(void);
+int iwpaninfo_registry_update(void);
+const struct iwpaninfo_netdev * iwpaninfo_registry_find(const char *ifname);
+const struct iwpaninfo_netdev * iwpaninfo_registry_find_index(uint32_t ifindex);
+const struct iwpaninfo_netdev * iwpaninfo_registry_find_phy(int phy);
+
+struct nlmsghdr;
+
+/*
+ * Listeners see every RTM_NEWLINK and RTM_DELLINK the registry applies,
+ * from within iwpaninfo_registry_update(), and NULL when notifications
+ * were lost and they have to rebuild their state. Callbacks must not
+ * query the kernel, nested registry updates are ignored.
+ */
+typedef void (*iwpaninfo_registry_cb)(struct nlmsghdr *hdr, void *priv);
+
+int iwpaninfo_registry_listen(iwpaninfo_registry_cb cb, void *priv);
+void iwpaninfo_registry_unlisten(iwpaninfo_registry_cb cb, void *priv);
+
+int iwpaninfo_rtnl_parse_link(struct nlmsghdr *hdr, struct iwpaninfo_link_stats *s);
+
+void iwpaninfo_rtnl_close(void);
+
+#endif
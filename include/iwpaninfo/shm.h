@@ -0,0 +1,71 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Shared memory snapshot
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef __IWPANINFO_SHM_H_
+#define __IWPANINFO_SHM_H_
+
+#include "iwpaninfo.h"
+
+/*
+ * A single writer publishes the device table into a POSIX shared memory
+ * object, readers map it read-only and copy out under a seqlock: seq is
+ * odd while the table is being rewritten and readers retry until they
+ * see the same even value before and after their copy.
+ *
+ * The layout is fixed, readers refuse segments whose magic, version or
+ * struct ABI differ from their own.
+ */
+
+#define IWPANINFO_SHM_NAME		"/iwpaninfo"
+#define IWPANINFO_SHM_MAGIC		0x4e415057	/* "WPAN" */
+#define IWPANINFO_SHM_VERSION		2
+#define IWPANINFO_SHM_MAX_IFACES	IWPANINFO_MAX_IFACES
+#define IWPANINFO_SHM_INTERVAL		1000	/* ms */
+
+/* a snapshot older than this many publish intervals is ignored */
+#define IWPANINFO_SHM_STALE		3
+
+struct iwpaninfo_shm {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t abi;
+	uint32_t interval;	/* ms between publishes */
+	uint32_t seq;
+	uint64_t updated;	/* CLOCK_MONOTONIC, ms */
+	uint32_t count;
+	uint32_t total;		/* interfaces seen, count is capped */
+	struct iwpaninfo_info info[IWPANINFO_SHM_MAX_IFACES];
+};
+
+/* Publisher */
+struct iwpaninfo_shm * iwpaninfo_shm_create(uint32_t interval);
+void iwpaninfo_shm_publish(struct iwpaninfo_shm *shm,
+                           const struct iwpaninfo_info *info, int count,
+                           int total);
+void iwpaninfo_shm_destroy(struct iwpaninfo_shm *shm);
+
+/*
+ * Reader, both return -1 if no fresh snapshot is published. The read
+ * returns how many interfaces the publisher saw, which is more than it
+ * filled when max or the segment was too small.
+ */
+int iwpaninfo_shm_read(struct iwpaninfo_info *info, int max);
+int iwpaninfo_shm_get_info(const char *ifname, struct iwpaninfo_info *info);
+void iwpaninfo_shm_detach(void);
+
+#endif
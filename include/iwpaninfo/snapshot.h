@@ -0,0 +1,77 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Snapshots and diffs
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef __IWPANINFO_SNAPSHOT_H_
+#define __IWPANINFO_SNAPSHOT_H_
+
+#include <stdio.h>
+
+#include "iwpaninfo.h"
+
+/* The state of every WPAN interface at one point in time */
+struct iwpaninfo_snapshot {
+	int count;
+	int dropped;			/* interfaces that did not fit */
+	struct iwpaninfo_info info[IWPANINFO_MAX_IFACES];
+};
+
+enum iwpaninfo_change_type {
+	IWPANINFO_CHANGE_ADDED,		/* interface appeared */
+	IWPANINFO_CHANGE_REMOVED,	/* interface is gone */
+	IWPANINFO_CHANGE_FIELD,		/* field value or availability */
+};
+
+/*
+ * One entry of a snapshot diff. Interfaces are matched by name, an added
+ * interface is followed by a FIELD record for each of its fields so that
+ * the list alone is enough to rebuild the newer snapshot.
+ */
+struct iwpaninfo_change {
+	char ifname[IFNAMSIZ];
+	uint8_t type;
+	uint8_t old_valid;
+	uint8_t new_valid;
+	uint32_t field;			/* IWPANINFO_FIELD_*, FIELD only */
+	int64_t old_value;
+	int64_t new_value;
+};
+
+/* Both fill at most IWPANINFO_MAX_IFACES entries and count the rest */
+int iwpaninfo_snapshot_take(struct iwpaninfo_snapshot *s);
+
+/* Line based text format, see iwpaninfo_snapshot.c */
+int iwpaninfo_snapshot_save(const struct iwpaninfo_snapshot *s, FILE *f);
+int iwpaninfo_snapshot_load(struct iwpaninfo_snapshot *s, FILE *f);
+
+/*
+ * Compare a against the newer b and store up to max records in changes.
+ * Returns the total number of changes, which may exceed max, or -1.
+ */
+int iwpaninfo_snapshot_diff(const struct iwpaninfo_snapshot *a,
+                            const struct iwpaninfo_snapshot *b,
+                            struct iwpaninfo_change *changes, int max);
+
+/* Single field accessors, values are the raw struct members widened */
+int64_t iwpaninfo_info_field_get(const struct iwpaninfo_info *info,
+                                 uint32_t field);
+int iwpaninfo_info_field_set(struct iwpaninfo_info *info, uint32_t field,
+                             int64_t val);
+int iwpaninfo_info_field_format(uint32_t field, int64_t val,
+                                char *buf, int len);
+
+#endif
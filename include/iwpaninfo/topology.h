@@ -0,0 +1,74 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Interface topology
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef __IWPANINFO_TOPOLOGY_H_
+#define __IWPANINFO_TOPOLOGY_H_
+
+#include "iwpaninfo.h"
+
+/*
+ * phy -> wpan -> lowpan graph. Edges are kept as kernel indexes, a wpan
+ * belongs to the phy with info.phy and a lowpan to the wpan whose
+ * ifindex equals its link, so entries can be added and removed without
+ * fixing up references.
+ */
+
+struct iwpaninfo_topo_phy {
+	uint32_t phy;
+	char phyname[32];
+};
+
+struct iwpaninfo_topo_wpan {
+	struct iwpaninfo_info info;
+	uint32_t flags;			/* IFF_* */
+	int pending;			/* info not queried yet */
+};
+
+struct iwpaninfo_topo_lowpan {
+	char ifname[IFNAMSIZ];
+	uint32_t ifindex;
+	uint32_t link;			/* wpan ifindex */
+	uint32_t flags;			/* IFF_* */
+};
+
+struct iwpaninfo_topology {
+	int num_phys;
+	int num_wpans;
+	int num_lowpans;
+	int dropped;			/* entries that did not fit */
+	struct iwpaninfo_topo_phy phys[IWPANINFO_MAX_IFACES];
+	struct iwpaninfo_topo_wpan wpans[IWPANINFO_MAX_IFACES];
+	struct iwpaninfo_topo_lowpan lowpans[IWPANINFO_MAX_IFACES];
+	int listening;
+	int changed;
+	int resync;
+};
+
+/* Rebuild t from an nl802154 interface dump and an RTM_GETLINK dump */
+int iwpaninfo_topology_build(struct iwpaninfo_topology *t);
+
+/*
+ * Follow the link registry and rebuild t, returns a pollable fd.
+ * iwpaninfo_topology_event() then applies pending notifications in
+ * place and returns the number of changed entries or -1.
+ */
+int iwpaninfo_topology_event_open(struct iwpaninfo_topology *t);
+int iwpaninfo_topology_event(struct iwpaninfo_topology *t);
+void iwpaninfo_topology_free(struct iwpaninfo_topology *t);
+
+#endif
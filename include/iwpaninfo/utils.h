@@ -32,9 +32,7 @@
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
 #endif
 
-#define LOG10_MAGIC	1.25892541179
-
-extern struct uci_context *uci_ctx;
+extern __thread struct uci_context *uci_ctx;
 
 int iwpaninfo_ioctl(int cmd, void *ifr);
 
@@ -45,6 +43,40 @@ static inline int iwpaninfo_mbm2dbm(int gain)
 	return gain / 100;
 }
 
+/* Bitmaps of IWPANINFO_COMMAND_WORDS words, indexed by nl802154 command */
+static inline int iwpaninfo_command_isset(const uint32_t *commands, int cmd)
+{
+	if (cmd < 0 || cmd >= IWPANINFO_MAX_COMMANDS)
+		return 0;
+
+	return !!(commands[cmd / 32] & (1U << (cmd % 32)));
+}
+
+static inline void iwpaninfo_command_set(uint32_t *commands, int cmd)
+{
+	if (cmd >= 0 && cmd < IWPANINFO_MAX_COMMANDS)
+		commands[cmd / 32] |= (1U << (cmd % 32));
+}
+
+static inline int iwpaninfo_commands_empty(const uint32_t *commands)
+{
+	int i;
+
+	for (i = 0; i < IWPANINFO_COMMAND_WORDS; i++)
+		if (commands[i])
+			return 0;
+
+	return 1;
+}
+
+/* Integer power and frequency conversions, no floating point involved */
+uint32_t iwpaninfo_mbm2uw(int32_t mbm);
+int32_t iwpaninfo_uw2mbm(uint32_t uw);
+uint32_t iwpaninfo_channel2khz(int page, int channel);
+
+/* val / 10^digits as decimal, trailing zeros dropped */
+char * iwpaninfo_format_fixed(char *buf, size_t size, long long val, int digits);
+
 int iwpaninfo_ifup(const char *ifname);
 int iwpaninfo_ifdown(const char *ifname);
 int iwpaninfo_ifmac(const char *ifname);
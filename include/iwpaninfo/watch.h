@@ -0,0 +1,48 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Refresh scheduling
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef __IWPANINFO_WATCH_H_
+#define __IWPANINFO_WATCH_H_
+
+#include <libubox/uloop.h>
+
+#include "iwpaninfo.h"
+
+#define IWPANINFO_WATCH_DEBOUNCE	50	/* ms */
+
+/*
+ * Calls refresh on a periodic timer and, debounced, after backend
+ * notifications, so a burst of events costs a single refresh. changed is
+ * set while refresh runs if notifications arrived since the last call.
+ */
+struct iwpaninfo_watch {
+	const struct iwpaninfo_ops *ops;
+	int interval;		/* s */
+	void (*refresh)(struct iwpaninfo_watch *w);
+	int changed;
+
+	struct uloop_fd event_fd;
+	struct uloop_timeout timer;
+	int pending;
+};
+
+/* Returns 0 with events, 1 if only the timer drives refresh */
+int iwpaninfo_watch_start(struct iwpaninfo_watch *w);
+void iwpaninfo_watch_stop(struct iwpaninfo_watch *w);
+
+#endif
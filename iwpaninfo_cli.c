@@ -23,10 +23,29 @@
 #include <glob.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <time.h>
 
 #include "iwpaninfo.h"
+#include "iwpaninfo/exporter.h"
 #include "api/nl802154.h"
 
+/* Commands a phy may announce in NL802154_ATTR_SUPPORTED_COMMANDS */
+static const char *cmd_names[] = {
+	[NL802154_CMD_NEW_INTERFACE]		= "new_interface",
+	[NL802154_CMD_DEL_INTERFACE]		= "del_interface",
+	[NL802154_CMD_SET_CHANNEL]		= "set_channel",
+	[NL802154_CMD_SET_PAN_ID]		= "set_pan_id",
+	[NL802154_CMD_SET_SHORT_ADDR]		= "set_short_addr",
+	[NL802154_CMD_SET_TX_POWER]		= "set_tx_power",
+	[NL802154_CMD_SET_CCA_MODE]		= "set_cca_mode",
+	[NL802154_CMD_SET_CCA_ED_LEVEL]		= "set_cca_ed_level",
+	[NL802154_CMD_SET_MAX_FRAME_RETRIES]	= "set_max_frame_retries",
+	[NL802154_CMD_SET_BACKOFF_EXPONENT]	= "set_backoff_exponent",
+	[NL802154_CMD_SET_MAX_CSMA_BACKOFFS]	= "set_max_csma_backoffs",
+	[NL802154_CMD_SET_LBT_MODE]		= "set_lbt_mode",
+	[NL802154_CMD_SET_ACKREQ_DEFAULT]	= "set_ackreq_default",
+};
+
 static char * format_channel(int ch)
 {
 	static char buf[8];
@@ -41,28 +60,569 @@ static char * format_channel(int ch)
 
 static char * format_frequency(int freq)
 {
-	static char buf[10];
+	static char buf[16];
 
 	if (freq <= 0)
 		snprintf(buf, sizeof(buf), "unknown");
 	else
-		snprintf(buf, sizeof(buf), "%.3f GHz", ((float)freq / 1000.0));
+		snprintf(buf, sizeof(buf), "%d.%03d GHz", freq / 1000, freq % 1000);
 
 	return buf;
 }
 
 static char * format_txpower(int pwr)
 {
-	static char buf[10];
+	static char buf[24];
+	char num[16];
 
 	if (INT_MIN == pwr)
 		snprintf(buf, sizeof(buf), "unknown");
 	else
-		snprintf(buf, sizeof(buf), "%.3g dBm", MBM_TO_DBM(pwr));
+		snprintf(buf, sizeof(buf), "%s dBm",
+		         iwpaninfo_format_fixed(num, sizeof(num), pwr, 2));
 
 	return buf;
 }
 
+/*
+ * Machine-readable output. Values are written straight to stdout as they
+ * are queried, the writer only keeps the nesting state needed to produce
+ * JSON separators and flattened key paths for the kv and csv formats.
+ */
+
+enum output_format {
+	OUTPUT_TEXT,
+	OUTPUT_JSON,
+	OUTPUT_KV,
+	OUTPUT_CSV,
+};
+
+#define OUTPUT_MAX_DEPTH	8
+
+struct output_level {
+	int is_array;
+	int count;
+	size_t pathlen;
+};
+
+static enum output_format output = OUTPUT_TEXT;
+
+/* one JSON document per line instead of one array, for open ended streams */
+static int output_lines = 0;
+
+static struct {
+	int depth;
+	int ifaces;
+	struct output_level lvl[OUTPUT_MAX_DEPTH];
+	char ifname[IFNAMSIZ];
+	char path[128];
+} out;
+
+static void out_json_string(const char *s)
+{
+	putchar('"');
+
+	for (; *s; s++)
+	{
+		switch (*s)
+		{
+		case '"':
+			fputs("\\\"", stdout);
+			break;
+		case '\\':
+			fputs("\\\\", stdout);
+			break;
+		case '\n':
+			fputs("\\n", stdout);
+			break;
+		case '\t':
+			fputs("\\t", stdout);
+			break;
+		default:
+			if ((unsigned char)*s < 0x20)
+				printf("\\u%04x", *s);
+			else
+				putchar(*s);
+		}
+	}
+
+	putchar('"');
+}
+
+static void out_csv_string(const char *s)
+{
+	if (!strpbrk(s, ",\"\n "))
+	{
+		fputs(s, stdout);
+		return;
+	}
+
+	putchar('"');
+
+	for (; *s; s++)
+	{
+		if (*s == '"')
+			putchar('"');
+
+		putchar(*s);
+	}
+
+	putchar('"');
+}
+
+/* Start a member of the current container, key is NULL for array items */
+static void out_member(const char *key)
+{
+	struct output_level *l = &out.lvl[out.depth];
+	size_t len = l->pathlen;
+
+	if (output == OUTPUT_JSON)
+	{
+		if (l->count)
+			putchar(',');
+
+		if (!l->is_array)
+		{
+			out_json_string(key);
+			putchar(':');
+		}
+	}
+	else if (key)
+	{
+		snprintf(out.path + len, sizeof(out.path) - len, "%s%s",
+		         len ? "." : "", key);
+	}
+	else
+	{
+		snprintf(out.path + len, sizeof(out.path) - len, "%s%d",
+		         len ? "." : "", l->count);
+	}
+
+	l->count++;
+}
+
+static void out_value(const char *key, const char *val, int quote)
+{
+	out_member(key);
+
+	switch (output)
+	{
+	case OUTPUT_JSON:
+		if (!val)
+			fputs("null", stdout);
+		else if (quote)
+			out_json_string(val);
+		else
+			fputs(val, stdout);
+		break;
+
+	case OUTPUT_KV:
+		printf("%s.%s=%s\n", out.ifname, out.path, val ? val : "");
+		break;
+
+	case OUTPUT_CSV:
+		out_csv_string(out.ifname);
+		printf(",%s,", out.path);
+		out_csv_string(val ? val : "");
+		putchar('\n');
+		break;
+
+	case OUTPUT_TEXT:
+		printf(" %s=%s", out.path, val ? val : "unknown");
+		break;
+	}
+}
+
+static void out_str(const char *key, const char *val)
+{
+	out_value(key, val, 1);
+}
+
+static void out_null(const char *key)
+{
+	out_value(key, NULL, 0);
+}
+
+static void out_int(const char *key, long long val)
+{
+	char buf[24];
+
+	snprintf(buf, sizeof(buf), "%lld", val);
+	out_value(key, buf, 0);
+}
+
+static void out_fixed(const char *key, long long val, int digits)
+{
+	char buf[32];
+
+	out_value(key, iwpaninfo_format_fixed(buf, sizeof(buf), val, digits), 0);
+}
+
+static void out_bool(const char *key, int val)
+{
+	out_value(key, val ? "true" : "false", 0);
+}
+
+static void out_open(const char *key, int is_array)
+{
+	struct output_level *l;
+
+	if (out.depth + 1 >= OUTPUT_MAX_DEPTH)
+		return;
+
+	out_member(key);
+
+	if (output == OUTPUT_JSON)
+		putchar(is_array ? '[' : '{');
+
+	l = &out.lvl[++out.depth];
+	l->is_array = is_array;
+	l->count = 0;
+	l->pathlen = strlen(out.path);
+}
+
+static void out_close(void)
+{
+	if (output == OUTPUT_JSON)
+		putchar(out.lvl[out.depth].is_array ? ']' : '}');
+
+	if (out.depth > 0)
+		out.depth--;
+
+	out.path[out.lvl[out.depth].pathlen] = 0;
+}
+
+static void out_begin(void)
+{
+	memset(&out, 0, sizeof(out));
+	out.lvl[0].is_array = 1;
+
+	if (output == OUTPUT_JSON && !output_lines)
+		putchar('[');
+	else if (output == OUTPUT_CSV)
+		printf("interface,key,value\n");
+}
+
+static void out_end(void)
+{
+	if (output == OUTPUT_JSON && !output_lines)
+		printf("]\n");
+
+	fflush(stdout);
+}
+
+static void out_iface_begin(const char *ifname)
+{
+	struct output_level *l;
+
+	strncpy(out.ifname, ifname, sizeof(out.ifname) - 1);
+	out.path[0] = 0;
+
+	if (output == OUTPUT_JSON)
+	{
+		if (out.ifaces++ && !output_lines)
+			printf(",\n");
+
+		putchar('{');
+		out_json_string("ifname");
+		putchar(':');
+		out_json_string(ifname);
+	}
+
+	l = &out.lvl[out.depth = 1];
+	l->is_array = 0;
+	l->count = (output == OUTPUT_JSON);
+	l->pathlen = 0;
+}
+
+static void out_iface_end(void)
+{
+	if (output == OUTPUT_JSON)
+		printf(output_lines ? "}\n" : "}");
+
+	out.depth = 0;
+}
+
+static void emit_info(const struct iwpaninfo_ops *iw, const char *ifname)
+{
+	int val;
+	uint64_t addr;
+	char buf[IWPANINFO_BUFSIZE];
+	struct iwpaninfo_info info;
+
+	out_str("type", iw->name);
+
+	if (!iw->phyname(ifname, buf))
+		out_str("phy", buf);
+	else
+		out_null("phy");
+
+	if (iw->mode(ifname, &val))
+		val = IWPANINFO_OPMODE_UNKNOWN;
+	out_str("mode", IWPANINFO_OPMODE_NAMES[val]);
+
+	if (!iw->txpower(ifname, &val))
+		out_fixed("txpower", val, 2);
+	else
+		out_null("txpower");
+
+	if (0 == iw->page(ifname, &val))
+		out_int("page", val);
+	else
+		out_null("page");
+
+	if (!iw->channel(ifname, &val) && val > 0)
+		out_int("channel", val);
+	else
+		out_null("channel");
+
+	/* kHz like sample and diff, the op only knows whole MHz */
+	if (!iwpaninfo_query(ifname, IWPANINFO_FIELD_FREQUENCY, &info) &&
+	    info.frequency > 0)
+		out_fixed("frequency", info.frequency, 3);
+	else
+		out_null("frequency");
+
+	if (!iw->panid(ifname, &val))
+		out_int("panid", val);
+	else
+		out_null("panid");
+
+	if (!iw->short_address(ifname, &val))
+		out_int("short_address", val);
+	else
+		out_null("short_address");
+
+	if (!iw->extended_address(ifname, &addr))
+	{
+		snprintf(buf, sizeof(buf), "0x%016" PRIx64, addr);
+		out_str("extended_address", buf);
+	}
+	else
+	{
+		out_null("extended_address");
+	}
+
+	if (-1 != iw->min_be(ifname, &val))
+		out_int("min_be", val);
+	else
+		out_null("min_be");
+
+	if (-1 != iw->max_be(ifname, &val))
+		out_int("max_be", val);
+	else
+		out_null("max_be");
+
+	if (-1 != iw->csma_backoff(ifname, &val))
+		out_int("csma_backoff", val);
+	else
+		out_null("csma_backoff");
+
+	if (-1 != iw->frame_retry(ifname, &val))
+		out_int("frame_retry", val);
+	else
+		out_null("frame_retry");
+
+	if (-1 != iw->lbt_mode(ifname, &val))
+		out_bool("lbt_mode", val);
+	else
+		out_null("lbt_mode");
+
+	if (-1 != iw->cca_mode(ifname, &val))
+		out_int("cca_mode", val);
+	else
+		out_null("cca_mode");
+
+	if (-1 != iw->cca_opt(ifname, &val))
+		out_int("cca_opt", val);
+	else
+		out_null("cca_opt");
+}
+
+static void emit_info_field(const struct iwpaninfo_info *info, uint32_t field)
+{
+	int bit = __builtin_ctz(field);
+	const char *key = IWPANINFO_FIELD_NAMES[bit];
+	char buf[20];
+
+	if (!(info->valid & field))
+	{
+		out_null(key);
+		return;
+	}
+
+	switch (field)
+	{
+	case IWPANINFO_FIELD_IFINDEX:
+		out_int(key, info->ifindex);
+		break;
+	case IWPANINFO_FIELD_PHY:
+		if (info->phyname[0])
+			out_str(key, info->phyname);
+		else
+			out_int(key, info->phy);
+		break;
+	case IWPANINFO_FIELD_WPAN_DEV:
+		snprintf(buf, sizeof(buf), "0x%" PRIx64, info->wpan_dev);
+		out_str(key, buf);
+		break;
+	case IWPANINFO_FIELD_MODE:
+		out_str(key, IWPANINFO_OPMODE_NAMES[info->mode]);
+		break;
+	case IWPANINFO_FIELD_PAGE:
+		out_int(key, info->page);
+		break;
+	case IWPANINFO_FIELD_CHANNEL:
+		out_int(key, info->channel);
+		break;
+	case IWPANINFO_FIELD_FREQUENCY:
+		out_fixed(key, info->frequency, 3);
+		break;
+	case IWPANINFO_FIELD_TXPOWER:
+		out_fixed(key, info->txpower, 2);
+		break;
+	case IWPANINFO_FIELD_PANID:
+		out_int(key, info->panid);
+		break;
+	case IWPANINFO_FIELD_SHORT_ADDR:
+		out_int(key, info->short_address);
+		break;
+	case IWPANINFO_FIELD_EXTENDED_ADDR:
+		snprintf(buf, sizeof(buf), "0x%016" PRIx64, info->extended_address);
+		out_str(key, buf);
+		break;
+	case IWPANINFO_FIELD_MIN_BE:
+		out_int(key, info->min_be);
+		break;
+	case IWPANINFO_FIELD_MAX_BE:
+		out_int(key, info->max_be);
+		break;
+	case IWPANINFO_FIELD_CSMA_BACKOFF:
+		out_int(key, info->csma_backoff);
+		break;
+	case IWPANINFO_FIELD_FRAME_RETRY:
+		out_int(key, info->frame_retry);
+		break;
+	case IWPANINFO_FIELD_LBT_MODE:
+		out_bool(key, info->lbt_mode);
+		break;
+	case IWPANINFO_FIELD_CCA_MODE:
+		out_int(key, info->cca_mode);
+		break;
+	case IWPANINFO_FIELD_CCA_OPT:
+		out_int(key, info->cca_opt);
+		break;
+	case IWPANINFO_FIELD_CCA_ED_LEVEL:
+		out_fixed(key, info->cca_ed_level, 2);
+		break;
+	}
+}
+
+static void emit_info_fields(const struct iwpaninfo_info *info, uint32_t mask)
+{
+	uint32_t field;
+
+	for (field = 1; field & IWPANINFO_FIELD_ALL; field <<= 1)
+		if (mask & field)
+			emit_info_field(info, field);
+}
+
+static void emit_txpwrlist(const struct iwpaninfo_ops *iw, const char *ifname)
+{
+	struct iwpaninfo_txpwrlist_entry_mbm e[IWPANINFO_MAX_TXPOWERS];
+	int i, n;
+
+	out_open("txpwrlist", 1);
+
+	n = iwpaninfo_get_txpwrlist(ifname, e, ARRAY_SIZE(e));
+
+	for (i = 0; i < n; i++)
+	{
+		out_open(NULL, 0);
+		out_fixed("dbm", e[i].mbm, 2);
+		out_int("uw", e[i].uw);
+		out_close();
+	}
+
+	out_close();
+}
+
+static void emit_cca_ed_lvl_list(const struct iwpaninfo_ops *iw, const char *ifname)
+{
+	struct iwpaninfo_cca_ed_lvl_list_entry_mbm e[IWPANINFO_MAX_CCA_ED_LEVELS];
+	int i, n;
+
+	out_open("cca_ed_lvl_list", 1);
+
+	n = iwpaninfo_get_cca_ed_lvl_list(ifname, e, ARRAY_SIZE(e));
+
+	for (i = 0; i < n; i++)
+	{
+		out_open(NULL, 0);
+		out_fixed("dbm", e[i].mbm, 2);
+		out_close();
+	}
+
+	out_close();
+}
+
+static void emit_freqlist(const struct iwpaninfo_ops *iw, const char *ifname)
+{
+	struct iwpaninfo_freqlist_entry_khz e[IWPANINFO_MAX_PAGES * 32];
+	int i, n, page;
+
+	if (iw->page(ifname, &page))
+		page = -1;
+
+	out_open("freqlist", 1);
+
+	n = iwpaninfo_get_freqlist(ifname, e, ARRAY_SIZE(e));
+
+	for (i = 0; i < n; i++)
+	{
+		if (e[i].page != page)
+			continue;
+
+		out_open(NULL, 0);
+		out_int("channel", e[i].channel);
+		out_fixed("mhz", e[i].khz, 3);
+		out_close();
+	}
+
+	out_close();
+}
+
+static void emit_supported(const struct iwpaninfo_ops *iw, const char *ifname)
+{
+	uint32_t commands[IWPANINFO_COMMAND_WORDS];
+	int i;
+
+	if (iwpaninfo_get_commands(ifname, commands) ||
+	    iwpaninfo_commands_empty(commands))
+	{
+		out_null("supported");
+		return;
+	}
+
+	out_open("supported", 0);
+
+	for (i = 0; i < ARRAY_SIZE(cmd_names); i++)
+		if (cmd_names[i])
+			out_bool(cmd_names[i], iwpaninfo_command_isset(commands, i));
+
+	out_close();
+}
+
+static void emit_all(const struct iwpaninfo_ops *iw, const char *ifname)
+{
+	out_iface_begin(ifname);
+	emit_info(iw, ifname);
+	emit_txpwrlist(iw, ifname);
+	emit_freqlist(iw, ifname);
+	emit_cca_ed_lvl_list(iw, ifname);
+	out_iface_end();
+}
+
 static char* print_mode(const struct iwpaninfo_ops *iwpan, const char *ifname)
 {
 	int mode;
@@ -285,173 +845,67 @@ static void print_info(const struct iwpaninfo_ops *iw, const char *ifname)
 
 static void print_txpwrlist(const struct iwpaninfo_ops *iw, const char *ifname)
 {
-	int len, i;
-	char buf[IWPANINFO_BUFSIZE];
-	struct iwpaninfo_txpwrlist_entry *e;
+	struct iwpaninfo_txpwrlist_entry_mbm e[IWPANINFO_MAX_TXPOWERS];
+	char num[16];
+	int i, n;
 
-	if (iw->txpwrlist(ifname, buf, &len) || len <= 0)
+	n = iwpaninfo_get_txpwrlist(ifname, e, ARRAY_SIZE(e));
+
+	if (n <= 0)
 	{
 		printf("No TX power information available\n");
 		return;
 	}
 
-	for (i = 0; i < len; i += sizeof(struct iwpaninfo_txpwrlist_entry))
-	{
-		e = (struct iwpaninfo_txpwrlist_entry *) &buf[i];
-
-		printf("%.3g dBm \n", e->dbm);
-	}
+	for (i = 0; i < n; i++)
+		printf("%s dBm \n", iwpaninfo_format_fixed(num, sizeof(num), e[i].mbm, 2));
 }
 
 static void print_cca_ed_lvl_list(const struct iwpaninfo_ops *iw, const char *ifname)
 {
-	int len, i;
-	char buf[IWPANINFO_BUFSIZE];
-	struct iwpaninfo_cca_ed_lvl_list_entry *e;
+	struct iwpaninfo_cca_ed_lvl_list_entry_mbm e[IWPANINFO_MAX_CCA_ED_LEVELS];
+	char num[16];
+	int i, n;
+
+	n = iwpaninfo_get_cca_ed_lvl_list(ifname, e, ARRAY_SIZE(e));
 
-	if (iw->cca_ed_lvl_list(ifname, buf, &len) || len <= 0)
+	if (n <= 0)
 	{
 		printf("No CCA ED level information available\n");
 		return;
 	}
 
-	for (i = 0; i < len; i += sizeof(struct iwpaninfo_cca_ed_lvl_list_entry))
-	{
-		e = (struct iwpaninfo_cca_ed_lvl_list_entry *) &buf[i];
+	for (i = 0; i < n; i++)
+		printf("%s dBm \n", iwpaninfo_format_fixed(num, sizeof(num), e[i].mbm, 2));
+}
+
+static void print_supported(const struct iwpaninfo_ops *iw, const char *ifname)
+{
+	uint32_t commands[IWPANINFO_COMMAND_WORDS];
+	int i;
 
-		printf("%.3g dBm \n", e->dbm);
+	if (iwpaninfo_get_commands(ifname, commands) ||
+	    iwpaninfo_commands_empty(commands))
+	{
+		printf("No supported command information available\n");
+		return;
 	}
+
+	for (i = 0; i < ARRAY_SIZE(cmd_names); i++)
+		if (cmd_names[i])
+			printf("%-24s %s\n", cmd_names[i],
+			       iwpaninfo_command_isset(commands, i) ? "yes" : "no");
 }
 
-static void print_freq_handler(int channel_page, int channel) {
-	float freq = 0;
+static void print_freqlist(const struct iwpaninfo_ops *iw, const char *ifname)
+{
+	struct iwpaninfo_freqlist_entry_khz e[IWPANINFO_MAX_PAGES * 32];
+	char num[16];
+	int i, n, ch, page;
 
-	switch (channel_page) {
-	case 0:
-		if (channel == 0) {
-			freq = 868.3;
-			printf("%5.1f", freq);
-			break;
-		} else if (channel > 0 && channel < 11) {
-			freq = 906 + 2 * (channel - 1);
-		} else {
-			freq = 2405 + 5 * (channel - 11);
-		}
-		printf("%5.0f", freq);
-		break;
-	case 1:
-		if (channel == 0) {
-			freq = 868.3;
-			printf("%5.1f", freq);
-			break;
-		} else if (channel >= 1 && channel <= 10) {
-			freq = 906 + 2 * (channel - 1);
-		}
-		printf("%5.0f", freq);
-		break;
-	case 2:
-		if (channel == 0) {
-			freq = 868.3;
-			printf("%5.1f", freq);
-			break;
-		} else if (channel >= 1 && channel <= 10) {
-			freq = 906 + 2 * (channel - 1);
-		}
-		printf("%5.0f", freq);
-		break;
-	case 3:
-		if (channel >= 0 && channel <= 12) {
-			freq = 2412 + 5 * channel;
-		} else if (channel == 13) {
-			freq = 2484;
-		}
-		printf("%4.0f", freq);
-		break;
-	case 4:
-		switch (channel) {
-		case 0:
-			freq = 499.2;
-			break;
-		case 1:
-			freq = 3494.4;
-			break;
-		case 2:
-			freq = 3993.6;
-			break;
-		case 3:
-			freq = 4492.8;
-			break;
-		case 4:
-			freq = 3993.6;
-			break;
-		case 5:
-			freq = 6489.6;
-			break;
-		case 6:
-			freq = 6988.8;
-			break;
-		case 7:
-			freq = 6489.6;
-			break;
-		case 8:
-			freq = 7488.0;
-			break;
-		case 9:
-			freq = 7987.2;
-			break;
-		case 10:
-			freq = 8486.4;
-			break;
-		case 11:
-			freq = 7987.2;
-			break;
-		case 12:
-			freq = 8985.6;
-			break;
-		case 13:
-			freq = 9484.8;
-			break;
-		case 14:
-			freq = 9984.0;
-			break;
-		case 15:
-			freq = 9484.8;
-			break;
-		}
-		printf("%6.1f", freq);
-		break;
-	case 5:
-		if (channel >= 0 && channel <= 3) {
-			freq = 780 + 2 * channel;
-		} else if (channel >= 4 && channel <= 7) {
-			freq = 780 + 2 * (channel - 4);
-		}
-		printf("%3.0f", freq);
-		break;
-	case 6:
-		if (channel >= 0 && channel <= 7) {
-			freq = 951.2 + 0.6 * channel;
-		} else if (channel >= 8 && channel <= 9) {
-			freq = 954.4 + 0.2 * (channel - 8);
-		} else if (channel >= 10 && channel <= 21) {
-			freq = 951.1 + 0.4 * (channel - 10);
-		}
-
-		printf("%5.1f", freq);
-		break;
-	default:
-		printf("Unknown");
-		break;
-	}
-}
-
-static void print_freqlist(const struct iwpaninfo_ops *iw, const char *ifname)
-{
-	int i, len, ch, page;
-	char buf[IWPANINFO_BUFSIZE];
-	struct iwpaninfo_freqlist_entry *e;
+	n = iwpaninfo_get_freqlist(ifname, e, ARRAY_SIZE(e));
 
-	if (iw->freqlist(ifname, buf, &len) || len <= 0)
+	if (n <= 0)
 	{
 		printf("No frequency information available\n");
 		return;
@@ -463,14 +917,15 @@ static void print_freqlist(const struct iwpaninfo_ops *iw, const char *ifname)
 	if (iw->page(ifname, &page))
 		page = -1;
 
-	for (i = 0; i < len; i += sizeof(struct iwpaninfo_freqlist_entry))
+	/* only the current page, like the backend list used to report */
+	for (i = 0; i < n; i++)
 	{
-		e = (struct iwpaninfo_freqlist_entry *) &buf[i];
+		if (e[i].page != page)
+			continue;
 
-		printf("%s ", (ch == e->channel) ? "*" : " ");
-		print_freq_handler(page, e->channel);
-		printf(" MHz ");
-		printf("(Channel %s) \n", format_channel(e->channel));
+		printf("%s ", (ch == e[i].channel) ? "*" : " ");
+		printf("%6s MHz ", iwpaninfo_format_fixed(num, sizeof(num), e[i].khz, 3));
+		printf("(Channel %s) \n", format_channel(e[i].channel));
 	}
 }
 
@@ -493,72 +948,703 @@ static void lookup_phy(const struct iwpaninfo_ops *iw, const char *section)
 }
 
 
-int main(int argc, char **argv)
+static void timespec_add_ms(struct timespec *ts, long ms)
 {
-	int i, rv = 0;
-	char *p;
-	const struct iwpaninfo_ops *iwpan;
-	glob_t globbuf;
+	ts->tv_sec  += ms / 1000;
+	ts->tv_nsec += (ms % 1000) * 1000000L;
 
-	if (argc > 1 && argc < 3)
+	if (ts->tv_nsec >= 1000000000L)
 	{
-		fprintf(stderr,
-			"Usage:\n"
-			"	iwpaninfo <device> info\n"
-			"	iwpaninfo <device> txpowerlist\n"
-			"	iwpaninfo <device> freqlist\n"
-			"	iwpaninfo <device> ccaedlvllist\n"
-			"	iwpaninfo <backend> phyname <section>\n"
-		);
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+/*
+ * Take a snapshot every interval and print the fields that changed since
+ * the previous one. The backend context stays open across samples, so a
+ * tick costs a single batched interface + phy request. JSON output is one
+ * object per line, a stream cut off by a signal stays parseable.
+ */
+static int run_sample(const struct iwpaninfo_ops *iw, const char *ifname,
+                      int argc, char **argv)
+{
+	int i, n;
+	long interval = 1000, count = 0;
+	uint32_t changed;
+	char ts[32];
+	struct iwpaninfo_info info[2];
+	struct timespec next, now;
+
+	for (i = 0; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-i") && i + 1 < argc)
+			interval = atol(argv[++i]);
+		else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+			count = atol(argv[++i]);
+		else
+		{
+			fprintf(stderr, "Unknown sample option: %s\n", argv[i]);
+			return 1;
+		}
+	}
 
+	if (interval <= 0 || count < 0)
+	{
+		fprintf(stderr, "Invalid sample interval or count\n");
 		return 1;
 	}
 
-	if (argc == 1)
+	if (!iw->info)
 	{
-		glob("/sys/class/net/*", 0, NULL, &globbuf);
+		fprintf(stderr, "Not supported\n");
+		return 1;
+	}
 
-		for (i = 0; i < globbuf.gl_pathc; i++)
+	memset(info, 0, sizeof(info));
+	clock_gettime(CLOCK_MONOTONIC, &next);
+
+	for (n = 0; !count || n < count; n++)
+	{
+		struct iwpaninfo_info *cur = &info[n & 1], *prev = &info[!(n & 1)];
+
+		/* served from the shared memory snapshot when one is published */
+		if (iwpaninfo_get_info(ifname, cur))
+			memset(cur, 0, sizeof(*cur));
+
+		changed = n ? iwpaninfo_info_changed(prev, cur) : cur->valid;
+
+		if (changed)
 		{
-			p = strrchr(globbuf.gl_pathv[i], '/');
+			clock_gettime(CLOCK_REALTIME, &now);
+			snprintf(ts, sizeof(ts), "%lld.%03ld",
+			         (long long)now.tv_sec, now.tv_nsec / 1000000L);
 
-			if (!p)
-				continue;
+			out_iface_begin(ifname);
 
-			iwpan = iwpaninfo_backend(++p);
+			if (output == OUTPUT_TEXT)
+			{
+				printf("%s %s", ts, ifname);
+				emit_info_fields(cur, changed);
+				printf("\n");
+			}
+			else
+			{
+				out_value("timestamp", ts, 0);
+				emit_info_fields(cur, changed);
+			}
 
-			if (!iwpan)
-				continue;
+			out_iface_end();
+			fflush(stdout);
+		}
 
-			print_info(iwpan, p);
-			printf("\n");
+		if (count && n + 1 >= count)
+			break;
+
+		timespec_add_ms(&next, interval);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR);
+	}
+
+	return 0;
+}
+
+static void print_topology_wpan(const struct iwpaninfo_topology *t,
+                                const struct iwpaninfo_topo_wpan *w)
+{
+	int i;
+
+	printf("  %-16s ifindex %u  %s", w->info.ifname, w->info.ifindex,
+	       (w->flags & IFF_UP) ? "up" : "down");
+
+	if (w->info.valid & IWPANINFO_FIELD_PANID)
+		printf("  PAN 0x%04x", w->info.panid);
+
+	if (w->info.valid & IWPANINFO_FIELD_SHORT_ADDR)
+		printf("  Short 0x%04x", w->info.short_address);
+
+	printf("\n");
+
+	for (i = 0; i < t->num_lowpans; i++)
+		if (t->lowpans[i].link == w->info.ifindex)
+			printf("    %-14s ifindex %u  %s\n", t->lowpans[i].ifname,
+			       t->lowpans[i].ifindex,
+			       (t->lowpans[i].flags & IFF_UP) ? "up" : "down");
+}
+
+static int run_topology(void)
+{
+	static struct iwpaninfo_topology t;
+	const struct iwpaninfo_topo_wpan *w;
+	int i, j;
+
+	if (iwpaninfo_topology_build(&t))
+	{
+		fprintf(stderr, "Unable to read interface topology\n");
+		return 1;
+	}
+
+	if (t.dropped)
+		fprintf(stderr, "Topology is full, %d entries not shown\n",
+		        t.dropped);
+
+	if (output != OUTPUT_TEXT)
+	{
+		out_begin();
+
+		for (i = 0; i < t.num_wpans; i++)
+		{
+			w = &t.wpans[i];
+
+			out_iface_begin(w->info.ifname);
+			out_str("phy", w->info.phyname);
+			out_int("ifindex", w->info.ifindex);
+			out_bool("up", w->flags & IFF_UP);
+			out_open("lowpan", 1);
+
+			for (j = 0; j < t.num_lowpans; j++)
+				if (t.lowpans[j].link == w->info.ifindex)
+					out_str(NULL, t.lowpans[j].ifname);
+
+			out_close();
+			out_iface_end();
 		}
 
-		globfree(&globbuf);
+		out_end();
 		return 0;
 	}
 
-	if (argc > 3)
+	for (i = 0; i < t.num_phys; i++)
 	{
-		iwpan = iwpaninfo_backend_by_name(argv[1]);
+		printf("%s\n", t.phys[i].phyname);
 
-		if (!iwpan)
+		for (j = 0; j < t.num_wpans; j++)
+			if ((t.wpans[j].info.valid & IWPANINFO_FIELD_PHY) &&
+			    t.wpans[j].info.phy == t.phys[i].phy)
+				print_topology_wpan(&t, &t.wpans[j]);
+	}
+
+	/* lowpan links whose wpan is gone or not visible to nl802154 */
+	for (i = 0; i < t.num_lowpans; i++)
+	{
+		for (j = 0; j < t.num_wpans; j++)
+			if (t.wpans[j].info.ifindex == t.lowpans[i].link)
+				break;
+
+		if (j == t.num_wpans)
+			printf("%s (unattached) ifindex %u\n",
+			       t.lowpans[i].ifname, t.lowpans[i].ifindex);
+	}
+
+	return 0;
+}
+
+static void warn_image_dropped(const void *buf, size_t len)
+{
+	struct iwpaninfo_image img;
+	uint32_t dropped;
+
+	if (iwpaninfo_image_open(&img, buf, len))
+		return;
+
+	dropped = iwpaninfo_image_dropped(&img);
+
+	if (dropped)
+		fprintf(stderr, "Image is full, %u interfaces left out\n", dropped);
+}
+
+static int run_dump_binary(void)
+{
+	size_t len;
+	void *buf;
+	int rv = 0;
+
+	if (isatty(STDOUT_FILENO))
+	{
+		fprintf(stderr, "Refusing to write a binary image to a terminal\n");
+		return 1;
+	}
+
+	buf = iwpaninfo_image_build(&len);
+
+	if (!buf || fwrite(buf, 1, len, stdout) != len || fflush(stdout))
+	{
+		fprintf(stderr, "Unable to write image\n");
+		rv = 1;
+	}
+	else
+	{
+		warn_image_dropped(buf, len);
+	}
+
+	free(buf);
+	return rv;
+}
+
+/* Write <dir>/<hostname>.iwpi, replaced atomically for collectors */
+static int run_export(const char *dir)
+{
+	char host[64] = { 0 }, path[PATH_MAX], tmp[PATH_MAX];
+	size_t len;
+	void *buf;
+	FILE *f;
+	int rv;
+
+	if (gethostname(host, sizeof(host) - 1) || !host[0])
+		strcpy(host, "localhost");
+
+	/* a cut off name would be written, and renamed, somewhere else */
+	if (snprintf(path, sizeof(path), "%s/%s" IWPANINFO_IMAGE_SUFFIX,
+	             dir, host) >= (int)sizeof(path) ||
+	    snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+	{
+		fprintf(stderr, "Export path too long: %s\n", dir);
+		return 1;
+	}
+
+	buf = iwpaninfo_image_build(&len);
+	if (!buf)
+	{
+		fprintf(stderr, "Unable to collect device state\n");
+		return 1;
+	}
+
+	f = fopen(tmp, "w");
+	if (!f)
+	{
+		fprintf(stderr, "Unable to create %s: %s\n", tmp, strerror(errno));
+		free(buf);
+		return 1;
+	}
+
+	rv = (fwrite(buf, 1, len, f) != len);
+	rv |= (fclose(f) != 0);
+
+	if (!rv)
+		rv = (rename(tmp, path) != 0);
+
+	if (rv)
+	{
+		fprintf(stderr, "Unable to write %s: %s\n", path, strerror(errno));
+		unlink(tmp);
+	}
+	else
+	{
+		warn_image_dropped(buf, len);
+	}
+
+	free(buf);
+	return rv;
+}
+
+static int run_dump(void)
+{
+	static struct iwpaninfo_snapshot s;
+
+	if (iwpaninfo_snapshot_take(&s) || iwpaninfo_snapshot_save(&s, stdout))
+	{
+		fprintf(stderr, "Unable to take snapshot\n");
+		return 1;
+	}
+
+	if (s.dropped)
+		fprintf(stderr, "Snapshot is full, %d interfaces not saved\n",
+		        s.dropped);
+
+	return 0;
+}
+
+/* Interfaces of an image, plus those it holds beyond the snapshot size */
+static int load_snapshot_image(const struct iwpaninfo_image *img,
+                               struct iwpaninfo_snapshot *s)
+{
+	uint32_t count, stride;
+
+	s->count = iwpaninfo_image_ifaces(img, s->info, IWPANINFO_MAX_IFACES);
+	if (s->count < 0)
+		return -1;
+
+	s->dropped = iwpaninfo_image_dropped(img);
+
+	if (iwpaninfo_image_section(img, IWPANINFO_IMAGE_IFACES, &count, &stride))
+		s->dropped += count - s->count;
+
+	return 0;
+}
+
+/* All of stdin in one malloc()ed buffer, aligned for an image */
+static void * read_stdin(size_t *len)
+{
+	size_t size = 0;
+	char *buf = NULL, *p;
+	ssize_t n;
+
+	*len = 0;
+
+	do {
+		if (*len == size)
 		{
-			fprintf(stderr, "No such wpan backend: %s\n", argv[1]);
-			rv = 1;
+			size = size ? size * 2 : 65536;
+			p = realloc(buf, size);
+			if (!p)
+			{
+				free(buf);
+				return NULL;
+			}
+
+			buf = p;
+		}
+
+		n = read(STDIN_FILENO, buf + *len, size - *len);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+
+		if (n < 0)
+		{
+			free(buf);
+			return NULL;
+		}
+
+		*len += n;
+	} while (n > 0);
+
+	return buf;
+}
+
+static int load_snapshot(const char *path, struct iwpaninfo_snapshot *s)
+{
+	struct iwpaninfo_image img;
+	void *buf = NULL;
+	size_t len;
+	FILE *f;
+	int rv;
+
+	if (!strcmp(path, "live"))
+	{
+		rv = iwpaninfo_snapshot_take(s);
+
+		if (!rv && s->dropped)
+			fprintf(stderr, "Snapshot is full, %d interfaces not compared\n",
+			        s->dropped);
+
+		return rv;
+	}
+
+	/*
+	 * binary images from dump --binary are mapped, not parsed. A pipe
+	 * cannot be mapped, stdin is read whole and tried as an image first.
+	 */
+	if (!strcmp(path, "-"))
+	{
+		buf = read_stdin(&len);
+		if (!buf)
+		{
+			fprintf(stderr, "Unable to read stdin: %s\n", strerror(errno));
+			return -1;
+		}
+
+		if (!iwpaninfo_image_open(&img, buf, len))
+		{
+			rv = load_snapshot_image(&img, s);
+			iwpaninfo_image_close(&img);
+			free(buf);
+
+			goto out;
+		}
+
+		if (!len)
+		{
+			free(buf);
+			s->count = s->dropped = 0;
+			return 0;
 		}
+
+		f = fmemopen(buf, len, "r");
+	}
+	else if (!iwpaninfo_image_map(&img, path))
+	{
+		rv = load_snapshot_image(&img, s);
+		iwpaninfo_image_close(&img);
+
+		goto out;
+	}
+	else
+	{
+		f = fopen(path, "r");
+	}
+
+	if (!f)
+	{
+		fprintf(stderr, "Unable to open %s: %s\n", path, strerror(errno));
+		free(buf);
+		return -1;
+	}
+
+	rv = iwpaninfo_snapshot_load(s, f);
+
+	fclose(f);
+	free(buf);
+
+out:
+	if (rv)
+		fprintf(stderr, "Malformed snapshot: %s\n", path);
+	else if (s->dropped)
+		fprintf(stderr, "Snapshot %s is full, %d interfaces not compared\n",
+		        path, s->dropped);
+
+	return rv;
+}
+
+static void print_change_value(uint32_t field, int valid, int64_t val)
+{
+	char buf[32];
+
+	if (!valid)
+	{
+		printf("-");
+		return;
+	}
+
+	iwpaninfo_info_field_format(field, val, buf, sizeof(buf));
+	printf("%s", buf);
+}
+
+/* Exit status follows diff(1): 0 if equal, 1 if different, 2 on error */
+static int run_diff(const char *from, const char *to)
+{
+	static struct iwpaninfo_snapshot a, b;
+	static struct iwpaninfo_change changes[IWPANINFO_MAX_IFACES * (IWPANINFO_FIELD_COUNT + 2)];
+	struct iwpaninfo_info old, new;
+	const struct iwpaninfo_change *c;
+	const char *kind;
+	uint32_t mask;
+	int i, j, n;
+
+	if (load_snapshot(from, &a) || load_snapshot(to, &b))
+		return 2;
+
+	n = iwpaninfo_snapshot_diff(&a, &b, changes, ARRAY_SIZE(changes));
+	if (n < 0)
+		return 2;
+
+	if (n > (int)ARRAY_SIZE(changes))
+	{
+		fprintf(stderr, "Too many changes, %d of %d shown\n",
+		        (int)ARRAY_SIZE(changes), n);
+		n = ARRAY_SIZE(changes);
+	}
+
+	if (output != OUTPUT_TEXT)
+		out_begin();
+
+	/* records of one interface are adjacent, print them as a group */
+	for (i = 0; i < n; i = j)
+	{
+		if (changes[i].type == IWPANINFO_CHANGE_ADDED)
+			kind = "added";
+		else if (changes[i].type == IWPANINFO_CHANGE_REMOVED)
+			kind = "removed";
 		else
+			kind = "changed";
+
+		memset(&old, 0, sizeof(old));
+		memset(&new, 0, sizeof(new));
+		mask = 0;
+
+		if (output == OUTPUT_TEXT)
+			printf("%s: %s\n", changes[i].ifname, kind);
+
+		for (j = i; j < n && !strcmp(changes[j].ifname, changes[i].ifname); j++)
+		{
+			c = &changes[j];
+
+			if (c->type != IWPANINFO_CHANGE_FIELD)
+				continue;
+
+			mask |= c->field;
+
+			if (c->old_valid)
+				iwpaninfo_info_field_set(&old, c->field, c->old_value);
+
+			if (c->new_valid)
+				iwpaninfo_info_field_set(&new, c->field, c->new_value);
+
+			if (output == OUTPUT_TEXT)
+			{
+				printf("	%s: ", IWPANINFO_FIELD_NAMES[__builtin_ctz(c->field)]);
+				print_change_value(c->field, c->old_valid, c->old_value);
+				printf(" -> ");
+				print_change_value(c->field, c->new_valid, c->new_value);
+				printf("\n");
+			}
+		}
+
+		if (output == OUTPUT_TEXT)
+			continue;
+
+		out_iface_begin(changes[i].ifname);
+		out_str("change", kind);
+
+		if (mask)
 		{
-			switch (argv[2][0])
+			if (changes[i].type != IWPANINFO_CHANGE_ADDED)
 			{
-			case 'p':
-				lookup_phy(iwpan, argv[3]);
-				break;
+				out_open("old", 0);
+				emit_info_fields(&old, mask);
+				out_close();
+			}
+
+			out_open("new", 0);
+			emit_info_fields(&new, mask);
+			out_close();
+		}
+
+		out_iface_end();
+	}
+
+	if (output != OUTPUT_TEXT)
+		out_end();
+
+	return n ? 1 : 0;
+}
+
+#define HISTORY_DEFAULT_LAST	20
+#define HISTORY_MAX_SAMPLES	1024
+
+static void print_history_time(int64_t ms)
+{
+	char buf[32];
+	time_t t = ms / 1000;
+	struct tm tm;
+
+	strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", localtime_r(&t, &tm));
+	printf("%s.%03d", buf, (int)(ms % 1000));
+}
+
+static int run_history(int argc, char **argv)
+{
+	static struct iwpaninfo_sample s[HISTORY_MAX_SAMPLES];
+	const char *ifname = argv[2];
+	int64_t from = INT64_MIN;
+	int i, j, n, metric = -1, last = 0, shown = 0;
+	struct timespec ts;
+
+	for (i = 3; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			last = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+		{
+			clock_gettime(CLOCK_REALTIME, &ts);
+			from = ((int64_t)ts.tv_sec - atoi(argv[++i])) * 1000;
+		}
+		else if (metric < 0 && (metric = iwpaninfo_metric_by_name(argv[i])) >= 0)
+			continue;
+		else
+		{
+			fprintf(stderr, "Unknown history argument: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (!last && from == INT64_MIN)
+		last = HISTORY_DEFAULT_LAST;
+
+	if (output != OUTPUT_TEXT)
+	{
+		out_begin();
+		out_iface_begin(ifname);
+	}
+
+	for (i = 0; i < IWPANINFO_METRIC_COUNT; i++)
+	{
+		if (metric >= 0 && i != metric)
+			continue;
+
+		n = iwpaninfo_history_query(ifname, i, from, INT64_MAX, last,
+		                            s, HISTORY_MAX_SAMPLES);
+
+		if (n <= 0)
+			continue;
+
+		shown++;
 
-			default:
-				fprintf(stderr, "Unknown command: %s\n", argv[2]);
-				rv = 1;
+		if (output != OUTPUT_TEXT)
+		{
+			out_open(IWPANINFO_METRIC_NAMES[i], 1);
+
+			for (j = 0; j < n; j++)
+			{
+				out_open(NULL, 0);
+				out_int("time", s[j].ts);
+				out_int("value", s[j].value);
+				out_close();
 			}
+
+			out_close();
+			continue;
+		}
+
+		printf("%s %s\n", ifname, IWPANINFO_METRIC_NAMES[i]);
+
+		for (j = 0; j < n; j++)
+		{
+			printf("	");
+			print_history_time(s[j].ts);
+			printf("  %" PRId64 "\n", s[j].value);
+		}
+	}
+
+	if (output != OUTPUT_TEXT)
+	{
+		out_iface_end();
+		out_end();
+	}
+
+	if (!shown)
+	{
+		fprintf(stderr, "No history for %s, is iwpaninfo-shmd running?\n",
+		        ifname);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int run_query(int argc, char **argv)
+{
+	int i, rv = 0;
+	const struct iwpaninfo_ops *iwpan;
+
+	if (argc > 2 && !strcmp(argv[2], "sample"))
+	{
+		iwpan = iwpaninfo_backend(argv[1]);
+
+		if (!iwpan)
+		{
+			fprintf(stderr, "No such wpan device: %s\n", argv[1]);
+			return 1;
+		}
+
+		return run_sample(iwpan, argv[1], argc - 3, argv + 3);
+	}
+
+	/*
+	 * "<backend> phyname <section>" only when argv[1] names a backend,
+	 * otherwise argv[1] is a device and every remaining argument is a
+	 * command, so "wpan0 info txpowerlist" works here and in -batch.
+	 */
+	if (argc > 3 && (iwpan = iwpaninfo_backend_by_name(argv[1])) != NULL)
+	{
+		switch (argv[2][0])
+		{
+		case 'p':
+			lookup_phy(iwpan, argv[3]);
+			break;
+
+		default:
+			fprintf(stderr, "Unknown command: %s\n", argv[2]);
+			rv = 1;
 		}
 	}
 	else
@@ -570,6 +1656,37 @@ int main(int argc, char **argv)
 			fprintf(stderr, "No such wpan device: %s\n", argv[1]);
 			rv = 1;
 		}
+		else if (output != OUTPUT_TEXT)
+		{
+			out_iface_begin(argv[1]);
+
+			for (i = 2; i < argc; i++)
+			{
+				switch(argv[i][0])
+				{
+				case 'i':
+					emit_info(iwpan, argv[1]);
+					break;
+				case 't':
+					emit_txpwrlist(iwpan, argv[1]);
+					break;
+				case 'f':
+					emit_freqlist(iwpan, argv[1]);
+					break;
+				case 'c':
+					emit_cca_ed_lvl_list(iwpan, argv[1]);
+					break;
+				case 's':
+					emit_supported(iwpan, argv[1]);
+					break;
+				default:
+					fprintf(stderr, "Unknown command: %s\n", argv[i]);
+					rv = 1;
+				}
+			}
+
+			out_iface_end();
+		}
 		else
 		{
 			for (i = 2; i < argc; i++)
@@ -588,6 +1705,9 @@ int main(int argc, char **argv)
 				case 'c':
 					print_cca_ed_lvl_list(iwpan, argv[1]);
 					break;
+				case 's':
+					print_supported(iwpan, argv[1]);
+					break;
 				default:
 					fprintf(stderr, "Unknown command: %s\n", argv[i]);
 					rv = 1;
@@ -596,6 +1716,260 @@ int main(int argc, char **argv)
 		}
 	}
 
+	return rv;
+}
+
+static int run_batch(const char *path)
+{
+	int argc, line = 0, rv = 0;
+	char buf[512], *argv[16], *p;
+	FILE *f;
+
+	if (!strcmp(path, "-"))
+		f = stdin;
+	else if (!(f = fopen(path, "r")))
+	{
+		fprintf(stderr, "Cannot open batch file %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	if (output != OUTPUT_TEXT)
+		out_begin();
+
+	while (fgets(buf, sizeof(buf), f))
+	{
+		line++;
+		argc = 0;
+		argv[argc++] = "iwpaninfo";
+
+		if (!strchr(buf, '\n') && !feof(f))
+		{
+			fprintf(stderr, "%s:%d: line too long\n", path, line);
+			rv = 1;
+
+			while (fgets(buf, sizeof(buf), f) && !strchr(buf, '\n'))
+				;
+
+			continue;
+		}
+
+		for (p = strtok(buf, " \t\r\n"); p; p = strtok(NULL, " \t\r\n"))
+		{
+			if (*p == '#')
+				break;
+
+			if (argc == ARRAY_SIZE(argv))
+			{
+				argc = -1;
+				break;
+			}
+
+			argv[argc++] = p;
+		}
+
+		if (argc < 0)
+		{
+			fprintf(stderr, "%s:%d: too many commands\n", path, line);
+			rv = 1;
+			continue;
+		}
+
+		if (argc == 1)
+			continue;
+
+		if (argc < 3)
+		{
+			fprintf(stderr, "%s:%d: missing command for %s\n", path, line, argv[1]);
+			rv = 1;
+			continue;
+		}
+
+		if (run_query(argc, argv))
+			rv = 1;
+	}
+
+	if (output != OUTPUT_TEXT)
+		out_end();
+
+	if (f != stdin)
+		fclose(f);
+
+	return rv;
+}
+
+int main(int argc, char **argv)
+{
+	int i, rv = 0;
+	char *p;
+	const struct iwpaninfo_ops *iwpan;
+	glob_t globbuf;
+
+	if (argc > 2 && !strcmp(argv[1], "-o"))
+	{
+		if (!strcmp(argv[2], "json"))
+			output = OUTPUT_JSON;
+		else if (!strcmp(argv[2], "kv"))
+			output = OUTPUT_KV;
+		else if (!strcmp(argv[2], "csv"))
+			output = OUTPUT_CSV;
+		else if (strcmp(argv[2], "text"))
+		{
+			fprintf(stderr, "Unknown output format: %s\n", argv[2]);
+			return 1;
+		}
+
+		argv += 2;
+		argc -= 2;
+	}
+
+	if (argc > 1 && !strcmp(argv[1], "exporter"))
+	{
+		const char *addr = IWPANINFO_EXPORTER_LISTEN;
+		int interval = 0;
+
+		for (i = 2; i < argc; i++)
+		{
+			if (!strcmp(argv[i], "--listen") && i + 1 < argc)
+				addr = argv[++i];
+			else if (!strcmp(argv[i], "--interval") && i + 1 < argc)
+				interval = atoi(argv[++i]);
+			else
+			{
+				fprintf(stderr, "Unknown exporter option: %s\n", argv[i]);
+				return 1;
+			}
+		}
+
+		rv = iwpaninfo_exporter_run(addr, interval);
+		iwpaninfo_finish();
+
+		return rv;
+	}
+
+	if (argc == 2 && !strcmp(argv[1], "topology"))
+	{
+		rv = run_topology();
+		iwpaninfo_finish();
+
+		return rv;
+	}
+
+	if (argc > 1 && argc < 4 && !strcmp(argv[1], "dump"))
+	{
+		if (argc == 3 && strcmp(argv[2], "--binary"))
+		{
+			fprintf(stderr, "Unknown dump option: %s\n", argv[2]);
+			return 1;
+		}
+
+		rv = (argc == 3) ? run_dump_binary() : run_dump();
+		iwpaninfo_finish();
+
+		return rv;
+	}
+
+	if (argc == 3 && !strcmp(argv[1], "export"))
+	{
+		rv = run_export(argv[2]);
+		iwpaninfo_finish();
+
+		return rv;
+	}
+
+	if (argc > 2 && !strcmp(argv[1], "history"))
+	{
+		rv = run_history(argc, argv);
+		iwpaninfo_finish();
+
+		return rv;
+	}
+
+	if ((argc == 3 || argc == 4) && !strcmp(argv[1], "diff"))
+	{
+		rv = run_diff(argv[2], (argc == 4) ? argv[3] : "live");
+		iwpaninfo_finish();
+
+		return rv;
+	}
+
+	if (argc > 1 && argc < 3)
+	{
+		fprintf(stderr,
+			"Usage:\n"
+			"	iwpaninfo [-o json|kv|csv]\n"
+			"	iwpaninfo [-o json|kv|csv] <device> <command> [<command> ...]\n"
+			"	iwpaninfo [-o json|kv|csv] -batch <file|->\n"
+			"	iwpaninfo [-o json|kv|csv] <device> sample [-i <ms>] [-c <count>]\n"
+			"	iwpaninfo exporter [--listen <addr:port>] [--interval <s>]\n"
+			"	iwpaninfo [-o json|kv|csv] topology\n"
+			"	iwpaninfo dump [--binary]\n"
+			"	iwpaninfo export <directory>\n"
+			"	iwpaninfo [-o json|kv|csv] diff <file|-> [<file>|live]\n"
+			"	iwpaninfo [-o json|kv|csv] history <device> [<metric>] [-n <count>] [-s <seconds>]\n"
+			"	iwpaninfo <device> info\n"
+			"	iwpaninfo <device> txpowerlist\n"
+			"	iwpaninfo <device> freqlist\n"
+			"	iwpaninfo <device> ccaedlvllist\n"
+			"	iwpaninfo <device> supported\n"
+			"	iwpaninfo <backend> phyname <section>\n"
+		);
+
+		return 1;
+	}
+
+	if (argc == 1)
+	{
+		glob("/sys/class/net/*", 0, NULL, &globbuf);
+
+		if (output != OUTPUT_TEXT)
+			out_begin();
+
+		for (i = 0; i < globbuf.gl_pathc; i++)
+		{
+			p = strrchr(globbuf.gl_pathv[i], '/');
+
+			if (!p)
+				continue;
+
+			iwpan = iwpaninfo_backend(++p);
+
+			if (!iwpan)
+				continue;
+
+			if (output != OUTPUT_TEXT)
+			{
+				emit_all(iwpan, p);
+				continue;
+			}
+
+			print_info(iwpan, p);
+			printf("\n");
+		}
+
+		if (output != OUTPUT_TEXT)
+			out_end();
+
+		globfree(&globbuf);
+		return 0;
+	}
+
+	if (!strcmp(argv[1], "-batch"))
+	{
+		rv = run_batch(argv[2]);
+	}
+	else
+	{
+		output_lines = (argc > 2 && !strcmp(argv[2], "sample"));
+
+		if (output != OUTPUT_TEXT)
+			out_begin();
+
+		rv = run_query(argc, argv);
+
+		if (output != OUTPUT_TEXT)
+			out_end();
+	}
+
 	iwpaninfo_finish();
 
 	return rv;
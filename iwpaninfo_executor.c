@@ -0,0 +1,239 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Parallel query executor
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ *
+ *
+ * Interfaces are resolved to device handles up front in the calling
+ * thread, workers only query through the handles and never resolve a
+ * name. The handles are split into one contiguous range per worker. A worker takes
+ * from the front of its own range and, once that is empty, steals from
+ * the back of the others, so a few slow radios do not hold up the rest.
+ * The backend state is thread local, every worker talks to the kernel
+ * over its own socket.
+ */
+
+#include <pthread.h>
+
+#include "iwpaninfo/executor.h"
+
+struct exec_queue {
+	pthread_mutex_t lock;
+	int head;
+	int tail;
+};
+
+struct exec_job {
+	const char **ifnames;
+	struct iwpaninfo_dev *devs;
+	int *resolved;
+	uint32_t mask;
+	int nthreads;
+	struct exec_queue queues[IWPANINFO_EXEC_MAX_THREADS];
+	pthread_mutex_t cb_lock;
+	iwpaninfo_exec_cb cb;
+	void *priv;
+	int ok;
+};
+
+struct exec_worker {
+	struct exec_job *job;
+	int id;
+	pthread_t thread;
+};
+
+struct exec_gather {
+	struct iwpaninfo_info *out;
+};
+
+static int exec_take(struct exec_job *job, int id)
+{
+	struct exec_queue *q;
+	int i, idx = -1;
+
+	for (i = 0; i < job->nthreads && idx < 0; i++)
+	{
+		q = &job->queues[(id + i) % job->nthreads];
+
+		pthread_mutex_lock(&q->lock);
+
+		if (q->head < q->tail)
+			idx = i ? --q->tail : q->head++;
+
+		pthread_mutex_unlock(&q->lock);
+	}
+
+	return idx;
+}
+
+static void exec_run(struct exec_job *job, int id)
+{
+	struct iwpaninfo_info info;
+	struct iwpaninfo_dev *dev;
+	int idx, rv;
+
+	while ((idx = exec_take(job, id)) >= 0)
+	{
+		dev = &job->devs[idx];
+		memset(&info, 0, sizeof(info));
+
+		/* planned by the backend, only the exchanges mask needs */
+		rv = job->resolved[idx]
+			? iwpaninfo_dev_query(dev, job->mask, &info) : -1;
+
+		pthread_mutex_lock(&job->cb_lock);
+
+		if (!rv)
+			job->ok++;
+
+		job->cb(idx, job->ifnames[idx], rv, &info, job->priv);
+
+		pthread_mutex_unlock(&job->cb_lock);
+	}
+}
+
+static void * exec_worker_main(void *arg)
+{
+	struct exec_worker *w = arg;
+
+	exec_run(w->job, w->id);
+	iwpaninfo_thread_finish();
+
+	return NULL;
+}
+
+/*
+ * Resolve in the calling thread, so only its interface registry is ever
+ * opened. A registry hit only costs a lookup, unknown names take the full
+ * open.
+ */
+static int exec_resolve(const char *ifname, struct iwpaninfo_dev *dev)
+{
+	const struct iwpaninfo_netdev *nd;
+
+	memset(dev, 0, sizeof(*dev));
+
+	if (iwpaninfo_registry_update() >= 0 &&
+	    (nd = iwpaninfo_registry_find(ifname)) != NULL)
+	{
+		if (!IWPANINFO_ARPHRD_WPAN(nd->type))
+			return -1;
+
+		dev->ops = iwpaninfo_backend(ifname);
+		if (!dev->ops)
+			return -1;
+
+		snprintf(dev->ifname, sizeof(dev->ifname), "%s", ifname);
+		dev->ifindex = nd->ifindex;
+		dev->phy = -1;
+
+		return 0;
+	}
+
+	return iwpaninfo_dev_open(ifname, dev);
+}
+
+int iwpaninfo_exec(const char **ifnames, int count, uint32_t mask, int threads,
+                   iwpaninfo_exec_cb cb, void *priv)
+{
+	struct exec_job job = { 0 };
+	struct exec_worker workers[IWPANINFO_EXEC_MAX_THREADS];
+	int started[IWPANINFO_EXEC_MAX_THREADS];
+	int i;
+
+	if (count <= 0)
+		return 0;
+
+	if (threads <= 0)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (threads > IWPANINFO_EXEC_MAX_THREADS)
+		threads = IWPANINFO_EXEC_MAX_THREADS;
+
+	if (threads > count)
+		threads = count;
+
+	if (threads < 1)
+		threads = 1;
+
+	job.devs = calloc(count, sizeof(*job.devs));
+	job.resolved = calloc(count, sizeof(*job.resolved));
+
+	if (!job.devs || !job.resolved)
+	{
+		free(job.devs);
+		free(job.resolved);
+		return -1;
+	}
+
+	for (i = 0; i < count; i++)
+		job.resolved[i] = !exec_resolve(ifnames[i], &job.devs[i]);
+
+	job.ifnames = ifnames;
+	job.mask = mask;
+	job.nthreads = threads;
+	job.cb = cb;
+	job.priv = priv;
+	pthread_mutex_init(&job.cb_lock, NULL);
+
+	for (i = 0; i < threads; i++)
+	{
+		pthread_mutex_init(&job.queues[i].lock, NULL);
+		job.queues[i].head = count * i / threads;
+		job.queues[i].tail = count * (i + 1) / threads;
+	}
+
+	/* the caller works as worker 0 and keeps its own context */
+	for (i = 1; i < threads; i++)
+	{
+		workers[i].job = &job;
+		workers[i].id = i;
+
+		/* a range without a thread is stolen by the others */
+		started[i] = !pthread_create(&workers[i].thread, NULL,
+		                             exec_worker_main, &workers[i]);
+	}
+
+	exec_run(&job, 0);
+
+	for (i = 1; i < threads; i++)
+		if (started[i])
+			pthread_join(workers[i].thread, NULL);
+
+	for (i = 0; i < threads; i++)
+		pthread_mutex_destroy(&job.queues[i].lock);
+
+	pthread_mutex_destroy(&job.cb_lock);
+	free(job.devs);
+	free(job.resolved);
+
+	return job.ok;
+}
+
+static void exec_gather_cb(int idx, const char *ifname, int rv,
+                           const struct iwpaninfo_info *info, void *priv)
+{
+	struct exec_gather *g = priv;
+
+	memcpy(&g->out[idx], info, sizeof(*info));
+}
+
+int iwpaninfo_exec_gather(const char **ifnames, int count, uint32_t mask,
+                          int threads, struct iwpaninfo_info *out)
+{
+	struct exec_gather g = { .out = out };
+
+	return iwpaninfo_exec(ifnames, count, mask, threads, exec_gather_cb, &g);
+}
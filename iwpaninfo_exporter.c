@@ -0,0 +1,625 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Prometheus exporter
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ *
+ *
+ * Serves the WPAN state in the Prometheus text exposition format. The
+ * body is rendered once per refresh, either on an nl802154 notification
+ * or on the counter interval, and every scrape only writes out the
+ * cached buffer.
+ */
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include <libubox/uloop.h>
+#include <libubox/usock.h>
+
+#include "iwpaninfo.h"
+#include "iwpaninfo/exporter.h"
+#include "iwpaninfo/watch.h"
+
+#define EXPORTER_REQ_SIZE	1024
+#define EXPORTER_SEND_TIMEOUT	2	/* s */
+
+struct exporter_buf {
+	char *data;
+	size_t len;
+	size_t size;
+};
+
+struct exporter_client {
+	struct uloop_fd fd;
+	struct uloop_timeout timeout;
+	size_t len;
+	char req[EXPORTER_REQ_SIZE];
+	struct exporter_buf resp;	/* own copy, body may be re-rendered */
+	size_t sent;
+};
+
+/* phy capabilities only change with the phy, refetched after events */
+struct exporter_caps {
+	int phy;
+	int valid;
+	struct iwpaninfo_phy_caps caps;
+};
+
+static struct exporter_buf body;
+static struct uloop_fd server_fd;
+static struct iwpaninfo_watch watch;
+static struct exporter_caps caps_cache[IWPANINFO_MAX_IFACES];
+
+/* link statistics exported as <name>_total counters */
+static const struct {
+	const char *name;
+	const char *help;
+	size_t offset;
+} counters[] = {
+#define COUNTER(n, h) { #n, h, offsetof(struct iwpaninfo_link_stats, n) }
+	COUNTER(rx_bytes,   "Received bytes"),
+	COUNTER(tx_bytes,   "Transmitted bytes"),
+	COUNTER(rx_packets, "Received packets"),
+	COUNTER(tx_packets, "Transmitted packets"),
+	COUNTER(rx_errors,  "Receive errors"),
+	COUNTER(tx_errors,  "Transmit errors"),
+	COUNTER(rx_dropped, "Dropped received packets"),
+	COUNTER(tx_dropped, "Dropped transmit packets"),
+#undef COUNTER
+};
+
+
+static void buf_printf(struct exporter_buf *b, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+	char *p;
+
+	while (1)
+	{
+		va_start(ap, fmt);
+		n = vsnprintf(b->data + b->len, b->size - b->len, fmt, ap);
+		va_end(ap);
+
+		if (n < 0)
+			return;
+
+		if (b->len + n < b->size)
+		{
+			b->len += n;
+			return;
+		}
+
+		p = realloc(b->data, b->size * 2 + n);
+		if (!p)
+			return;
+
+		b->data = p;
+		b->size = b->size * 2 + n;
+	}
+}
+
+/* mBm as decimal dBm without going through floating point */
+static void buf_mbm(struct exporter_buf *b, int32_t mbm)
+{
+	char num[24];
+
+	buf_printf(b, "%s\n", iwpaninfo_format_fixed(num, sizeof(num), mbm, 2));
+}
+
+/* Label values with backslash, double quote and newline escaped */
+static const char * label_escape(const char *in, char *out, size_t size)
+{
+	size_t n = 0;
+
+	for (; *in && n + 2 < size; in++)
+	{
+		if (*in == '\\' || *in == '"')
+		{
+			out[n++] = '\\';
+			out[n++] = *in;
+		}
+		else if (*in == '\n')
+		{
+			out[n++] = '\\';
+			out[n++] = 'n';
+		}
+		else
+		{
+			out[n++] = *in;
+		}
+	}
+
+	out[n] = 0;
+
+	return out;
+}
+
+static void metric_help(const char *name, const char *type, const char *help)
+{
+	buf_printf(&body, "# HELP iwpaninfo_%s %s\n", name, help);
+	buf_printf(&body, "# TYPE iwpaninfo_%s %s\n", name, type);
+}
+
+/*
+ * Interface gauges, one metric family per field. Labels are kept to
+ * ifname and phy so series stay stable across reconfiguration.
+ */
+static const struct {
+	uint32_t field;
+	const char *name;
+	const char *help;
+} info_metrics[] = {
+	{ IWPANINFO_FIELD_PAGE,         "page",             "Current channel page" },
+	{ IWPANINFO_FIELD_CHANNEL,      "channel",          "Current channel" },
+	{ IWPANINFO_FIELD_FREQUENCY,    "frequency_hertz",  "Current channel center frequency" },
+	{ IWPANINFO_FIELD_TXPOWER,      "txpower_dbm",      "Transmit power" },
+	{ IWPANINFO_FIELD_CCA_ED_LEVEL, "cca_ed_level_dbm", "CCA energy detection level" },
+	{ IWPANINFO_FIELD_CCA_MODE,     "cca_mode",         "CCA mode" },
+	{ IWPANINFO_FIELD_MIN_BE,       "min_be",           "CSMA minimum backoff exponent" },
+	{ IWPANINFO_FIELD_MAX_BE,       "max_be",           "CSMA maximum backoff exponent" },
+	{ IWPANINFO_FIELD_CSMA_BACKOFF, "csma_backoffs",    "CSMA maximum number of backoffs" },
+	{ IWPANINFO_FIELD_FRAME_RETRY,  "frame_retries",    "Maximum number of frame retries" },
+	{ IWPANINFO_FIELD_LBT_MODE,     "lbt_mode",         "Listen before talk enabled" },
+};
+
+static void render_info_value(const struct iwpaninfo_info *info, uint32_t field)
+{
+	switch (field)
+	{
+	case IWPANINFO_FIELD_PAGE:
+		buf_printf(&body, "%u\n", info->page);
+		break;
+	case IWPANINFO_FIELD_CHANNEL:
+		buf_printf(&body, "%u\n", info->channel);
+		break;
+	case IWPANINFO_FIELD_FREQUENCY:
+		buf_printf(&body, "%" PRIu64 "\n", (uint64_t)info->frequency * 1000);
+		break;
+	case IWPANINFO_FIELD_TXPOWER:
+		buf_mbm(&body, info->txpower);
+		break;
+	case IWPANINFO_FIELD_CCA_ED_LEVEL:
+		buf_mbm(&body, info->cca_ed_level);
+		break;
+	case IWPANINFO_FIELD_CCA_MODE:
+		buf_printf(&body, "%u\n", info->cca_mode);
+		break;
+	case IWPANINFO_FIELD_MIN_BE:
+		buf_printf(&body, "%u\n", info->min_be);
+		break;
+	case IWPANINFO_FIELD_MAX_BE:
+		buf_printf(&body, "%u\n", info->max_be);
+		break;
+	case IWPANINFO_FIELD_CSMA_BACKOFF:
+		buf_printf(&body, "%u\n", info->csma_backoff);
+		break;
+	case IWPANINFO_FIELD_FRAME_RETRY:
+		buf_printf(&body, "%d\n", info->frame_retry);
+		break;
+	case IWPANINFO_FIELD_LBT_MODE:
+		buf_printf(&body, "%u\n", info->lbt_mode);
+		break;
+	}
+}
+
+/* Capability ranges, rendered once per phy */
+static const struct {
+	const char *name;
+	const char *help;
+	size_t min, max;
+	int is_signed;
+} caps_metrics[] = {
+#define CAPS_RANGE(n, h, lo, hi, s) \
+	{ n, h, offsetof(struct iwpaninfo_phy_caps, lo), \
+	  offsetof(struct iwpaninfo_phy_caps, hi), s }
+	CAPS_RANGE("phy_min_be", "Supported minimum backoff exponent range", min_minbe, max_minbe, 0),
+	CAPS_RANGE("phy_max_be", "Supported maximum backoff exponent range", min_maxbe, max_maxbe, 0),
+	CAPS_RANGE("phy_csma_backoffs", "Supported CSMA backoffs range", min_csma_backoffs, max_csma_backoffs, 0),
+	CAPS_RANGE("phy_frame_retries", "Supported frame retries range", min_frame_retries, max_frame_retries, 1),
+#undef CAPS_RANGE
+};
+
+/* ifname and phyname as label values, escaped once per refresh */
+struct exporter_labels {
+	char ifname[IFNAMSIZ * 2];
+	char phy[IFNAMSIZ * 2];
+};
+
+static void render(const struct iwpaninfo_info *info, int n, int dropped,
+                   const struct iwpaninfo_phy_caps **caps,
+                   const struct iwpaninfo_link_stats *links, int num_links)
+{
+	static struct exporter_labels l[IWPANINFO_MAX_IFACES];
+	char link[IFNAMSIZ * 2];
+	const uint8_t *c;
+	int i, j, k, bound, total;
+	struct timespec now;
+
+	body.len = 0;
+	body.data[0] = 0;
+
+	for (i = 0; i < n; i++)
+	{
+		label_escape(info[i].ifname, l[i].ifname, sizeof(l[i].ifname));
+		label_escape(info[i].phyname, l[i].phy, sizeof(l[i].phy));
+	}
+
+	metric_help("interface_info", "gauge", "WPAN interface addressing and mode");
+	for (i = 0; i < n; i++)
+		buf_printf(&body,
+		           "iwpaninfo_interface_info{ifname=\"%s\",phy=\"%s\",mode=\"%s\","
+		           "panid=\"0x%04x\",short_address=\"0x%04x\","
+		           "extended_address=\"0x%016" PRIx64 "\"} 1\n",
+		           l[i].ifname, l[i].phy,
+		           IWPANINFO_OPMODE_NAMES[info[i].mode < IWPANINFO_OPMODE_UNKNOWN
+		               ? info[i].mode : IWPANINFO_OPMODE_UNKNOWN],
+		           info[i].panid, info[i].short_address,
+		           info[i].extended_address);
+
+	metric_help("interfaces_dropped", "gauge",
+	            "WPAN interfaces left out because the table is full");
+	buf_printf(&body, "iwpaninfo_interfaces_dropped %d\n", dropped);
+
+	for (j = 0; j < ARRAY_SIZE(info_metrics); j++)
+	{
+		metric_help(info_metrics[j].name, "gauge", info_metrics[j].help);
+
+		for (i = 0; i < n; i++)
+		{
+			if (!(info[i].valid & info_metrics[j].field))
+				continue;
+
+			buf_printf(&body, "iwpaninfo_%s{ifname=\"%s\",phy=\"%s\"} ",
+			           info_metrics[j].name, l[i].ifname, l[i].phy);
+			render_info_value(&info[i], info_metrics[j].field);
+		}
+	}
+
+	for (k = 0; k < ARRAY_SIZE(counters); k++)
+	{
+		buf_printf(&body, "# HELP iwpaninfo_%s_total %s\n",
+		           counters[k].name, counters[k].help);
+		buf_printf(&body, "# TYPE iwpaninfo_%s_total counter\n",
+		           counters[k].name);
+
+		for (i = 0; i < num_links; i++)
+			buf_printf(&body, "iwpaninfo_%s_total{ifname=\"%s\"} %" PRIu64 "\n",
+			           counters[k].name,
+			           label_escape(links[i].ifname, link, sizeof(link)),
+			           *(const uint64_t *)((const char *)&links[i] + counters[k].offset));
+	}
+
+	metric_help("phy_channels", "gauge", "Number of supported channels");
+	for (i = 0; i < n; i++)
+	{
+		if (!caps[i])
+			continue;
+
+		for (total = 0, k = 0; k < IWPANINFO_MAX_PAGES; k++)
+			total += __builtin_popcount(caps[i]->channels[k]);
+
+		buf_printf(&body, "iwpaninfo_phy_channels{phy=\"%s\"} %d\n",
+		           l[i].phy, total);
+	}
+
+	metric_help("phy_txpower_dbm", "gauge", "Supported transmit power range");
+	for (i = 0; i < n; i++)
+	{
+		if (!caps[i] || !caps[i]->num_txpowers)
+			continue;
+
+		/* the kernel reports the levels in ascending order */
+		buf_printf(&body, "iwpaninfo_phy_txpower_dbm{phy=\"%s\",bound=\"min\"} ",
+		           l[i].phy);
+		buf_mbm(&body, caps[i]->txpowers[0]);
+		buf_printf(&body, "iwpaninfo_phy_txpower_dbm{phy=\"%s\",bound=\"max\"} ",
+		           l[i].phy);
+		buf_mbm(&body, caps[i]->txpowers[caps[i]->num_txpowers - 1]);
+	}
+
+	for (j = 0; j < ARRAY_SIZE(caps_metrics); j++)
+	{
+		metric_help(caps_metrics[j].name, "gauge", caps_metrics[j].help);
+
+		for (i = 0; i < n; i++)
+		{
+			if (!caps[i])
+				continue;
+
+			c = (const uint8_t *)caps[i];
+
+			for (bound = 0; bound < 2; bound++)
+			{
+				k = *(c + (bound ? caps_metrics[j].max : caps_metrics[j].min));
+
+				buf_printf(&body, "iwpaninfo_%s{phy=\"%s\",bound=\"%s\"} %d\n",
+				           caps_metrics[j].name, l[i].phy,
+				           bound ? "max" : "min",
+				           caps_metrics[j].is_signed ? (int8_t)k : (uint8_t)k);
+			}
+		}
+	}
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	metric_help("last_refresh_timestamp_seconds", "gauge",
+	            "Time the metrics were last refreshed");
+	buf_printf(&body, "iwpaninfo_last_refresh_timestamp_seconds %lld\n",
+	           (long long)now.tv_sec);
+}
+
+static const struct iwpaninfo_phy_caps * exporter_caps(const struct iwpaninfo_info *info)
+{
+	struct exporter_caps *slot = NULL;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(caps_cache); i++)
+	{
+		if (caps_cache[i].valid && caps_cache[i].phy == info->phy)
+			return &caps_cache[i].caps;
+
+		if (!caps_cache[i].valid && !slot)
+			slot = &caps_cache[i];
+	}
+
+	if (!slot || !watch.ops->caps || watch.ops->caps(info->ifname, &slot->caps))
+		return NULL;
+
+	slot->phy = info->phy;
+	slot->valid = 1;
+
+	return &slot->caps;
+}
+
+static void exporter_refresh(struct iwpaninfo_watch *w)
+{
+	static struct iwpaninfo_info info[IWPANINFO_MAX_IFACES];
+	static const struct iwpaninfo_phy_caps *caps[IWPANINFO_MAX_IFACES];
+	static struct iwpaninfo_link_stats links[IWPANINFO_MAX_LINKS];
+	int i, j, n, num_links;
+
+	n = iwpaninfo_get_dump_live(info, IWPANINFO_MAX_IFACES);
+	if (n < 0)
+		n = 0;
+
+	/* phys may have come, gone or been replaced under the same index */
+	if (w->changed)
+		memset(caps_cache, 0, sizeof(caps_cache));
+
+	for (i = 0; i < n; i++)
+	{
+		caps[i] = NULL;
+
+		if (!(info[i].valid & IWPANINFO_FIELD_PHY))
+			continue;
+
+		/* render each phy only once, it is shared by its interfaces */
+		for (j = 0; j < i; j++)
+			if (caps[j] && info[j].phy == info[i].phy)
+				break;
+
+		if (j == i)
+			caps[i] = exporter_caps(&info[i]);
+	}
+
+	/* one RTM_GETLINK dump covers the counters of every wpan and lowpan link */
+	num_links = iwpaninfo_link_stats(links, IWPANINFO_MAX_LINKS);
+	if (num_links < 0)
+		num_links = 0;
+
+	render(info, n, iwpaninfo_dump_total() - n, caps, links, num_links);
+}
+
+
+static void client_close(struct exporter_client *cl)
+{
+	uloop_timeout_cancel(&cl->timeout);
+	uloop_fd_delete(&cl->fd);
+	close(cl->fd.fd);
+	free(cl->resp.data);
+	free(cl);
+}
+
+static void client_write_cb(struct uloop_fd *fd, unsigned int events)
+{
+	struct exporter_client *cl = container_of(fd, struct exporter_client, fd);
+	ssize_t n;
+
+	while (cl->sent < cl->resp.len)
+	{
+		n = write(fd->fd, cl->resp.data + cl->sent, cl->resp.len - cl->sent);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+
+		/* the socket buffer is full, uloop calls back once it drains */
+		if (n < 0 && errno == EAGAIN)
+			return;
+
+		if (n <= 0)
+			break;
+
+		cl->sent += n;
+	}
+
+	client_close(cl);
+}
+
+/*
+ * Queue the response and write it as the socket accepts it, a slow
+ * scraper is dropped by the client timeout without stalling the loop.
+ */
+static void client_send(struct exporter_client *cl, const char *status,
+                        const char *type, const char *data, size_t len)
+{
+	cl->resp.size = 256 + len;
+	cl->resp.len = 0;
+	cl->resp.data = malloc(cl->resp.size);
+
+	if (!cl->resp.data)
+	{
+		client_close(cl);
+		return;
+	}
+
+	buf_printf(&cl->resp,
+	           "HTTP/1.0 %s\r\n"
+	           "Content-Type: %s\r\n"
+	           "Content-Length: %zu\r\n"
+	           "Connection: close\r\n\r\n",
+	           status, type, len);
+
+	memcpy(cl->resp.data + cl->resp.len, data, len);
+	cl->resp.len += len;
+
+	uloop_fd_delete(&cl->fd);
+	cl->fd.cb = client_write_cb;
+	uloop_fd_add(&cl->fd, ULOOP_WRITE);
+	uloop_timeout_set(&cl->timeout, EXPORTER_SEND_TIMEOUT * 1000);
+
+	client_write_cb(&cl->fd, ULOOP_WRITE);
+}
+
+static void client_read_cb(struct uloop_fd *fd, unsigned int events)
+{
+	struct exporter_client *cl = container_of(fd, struct exporter_client, fd);
+	int n;
+
+	n = read(fd->fd, cl->req + cl->len, sizeof(cl->req) - cl->len - 1);
+
+	if (n < 0 && (errno == EAGAIN || errno == EINTR))
+		return;
+
+	if (n <= 0)
+	{
+		client_close(cl);
+		return;
+	}
+
+	cl->len += n;
+	cl->req[cl->len] = 0;
+
+	/* wait for the complete request line */
+	if (!strstr(cl->req, "\r\n") && cl->len < sizeof(cl->req) - 1)
+		return;
+
+	if (strncmp(cl->req, "GET ", 4))
+		client_send(cl, "405 Method Not Allowed", "text/plain", "", 0);
+	else if (!strncmp(cl->req + 4, "/metrics ", 9) || !strncmp(cl->req + 4, "/ ", 2))
+		client_send(cl, "200 OK", "text/plain; version=0.0.4",
+		            body.data, body.len);
+	else
+		client_send(cl, "404 Not Found", "text/plain", "", 0);
+}
+
+static void client_timeout_cb(struct uloop_timeout *t)
+{
+	client_close(container_of(t, struct exporter_client, timeout));
+}
+
+static void server_cb(struct uloop_fd *fd, unsigned int events)
+{
+	struct exporter_client *cl;
+	int sfd;
+
+	while ((sfd = accept(fd->fd, NULL, NULL)) >= 0)
+	{
+		cl = calloc(1, sizeof(*cl));
+		if (!cl)
+		{
+			close(sfd);
+			continue;
+		}
+
+		fcntl(sfd, F_SETFD, fcntl(sfd, F_GETFD) | FD_CLOEXEC);
+		fcntl(sfd, F_SETFL, fcntl(sfd, F_GETFL) | O_NONBLOCK);
+
+		cl->fd.fd = sfd;
+		cl->fd.cb = client_read_cb;
+		cl->timeout.cb = client_timeout_cb;
+
+		uloop_fd_add(&cl->fd, ULOOP_READ);
+		uloop_timeout_set(&cl->timeout, EXPORTER_SEND_TIMEOUT * 1000);
+	}
+}
+
+
+int iwpaninfo_exporter_run(const char *addr, int interval)
+{
+	char host[64], *port;
+	int fd;
+
+	snprintf(host, sizeof(host), "%s", addr);
+
+	port = strrchr(host, ':');
+	if (!port)
+	{
+		fprintf(stderr, "Invalid listen address: %s\n", addr);
+		return 1;
+	}
+
+	*port++ = 0;
+
+	/* [addr]:port for IPv6 */
+	if (host[0] == '[' && port[-2] == ']')
+	{
+		port[-2] = 0;
+		memmove(host, host + 1, strlen(host));
+	}
+
+	watch.ops = iwpaninfo_backend_by_name("nl802154");
+	if (!watch.ops)
+	{
+		fprintf(stderr, "No nl802154 backend available\n");
+		return 1;
+	}
+
+	body.size = 4096;
+	body.data = malloc(body.size);
+	if (!body.data)
+		return 1;
+
+	watch.interval = (interval > 0) ? interval : IWPANINFO_EXPORTER_INTERVAL;
+	watch.refresh = exporter_refresh;
+
+	uloop_init();
+
+	fd = usock(USOCK_TCP | USOCK_SERVER | USOCK_NONBLOCK | USOCK_NUMERIC,
+	           host, port);
+	if (fd < 0)
+	{
+		fprintf(stderr, "Cannot listen on %s: %s\n", addr, strerror(errno));
+		free(body.data);
+		return 1;
+	}
+
+	server_fd.fd = fd;
+	server_fd.cb = server_cb;
+	uloop_fd_add(&server_fd, ULOOP_READ);
+
+	iwpaninfo_watch_start(&watch);
+
+	uloop_run();
+
+	iwpaninfo_watch_stop(&watch);
+	uloop_done();
+
+	close(server_fd.fd);
+	free(body.data);
+
+	return 0;
+}
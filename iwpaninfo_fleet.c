@@ -0,0 +1,770 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Fleet aggregation
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ *
+ *
+ * Offline summary over state images written by "iwpaninfo export". The
+ * images are mapped and decoded by a pool of threads, each with private
+ * accumulators that are merged once all files are read:
+ *
+ *  - channel occupancy per page
+ *  - tx power distribution
+ *  - interfaces whose CSMA/CA parameters differ from the fleet's mode
+ *  - phys whose capabilities differ from the most common set, with the
+ *    fields that differ
+ */
+
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "iwpaninfo.h"
+
+#define FLEET_MAX_THREADS	64
+#define FLEET_TXPOWER_MIN	-40	/* dBm, lowest histogram bucket */
+#define FLEET_TXPOWER_MAX	30	/* dBm, highest histogram bucket */
+#define FLEET_TXPOWER_BUCKETS	(FLEET_TXPOWER_MAX - FLEET_TXPOWER_MIN + 1)
+
+enum fleet_param {
+	FLEET_MIN_BE,
+	FLEET_MAX_BE,
+	FLEET_CSMA_BACKOFF,
+	FLEET_FRAME_RETRY,
+	FLEET_NUM_PARAMS,
+};
+
+static const char *fleet_param_names[FLEET_NUM_PARAMS] = {
+	"min_be", "max_be", "csma_backoff", "frame_retry",
+};
+
+static const uint32_t fleet_param_fields[FLEET_NUM_PARAMS] = {
+	IWPANINFO_FIELD_MIN_BE, IWPANINFO_FIELD_MAX_BE,
+	IWPANINFO_FIELD_CSMA_BACKOFF, IWPANINFO_FIELD_FRAME_RETRY,
+};
+
+struct fleet_file {
+	const char *path;
+	char host[64];
+};
+
+/* What the report needs of an interface, kept for the outlier pass */
+struct fleet_iface {
+	uint32_t file;
+	uint32_t valid;
+	int16_t params[FLEET_NUM_PARAMS];
+	char ifname[IFNAMSIZ];
+};
+
+struct fleet_phy {
+	uint32_t file;
+	uint32_t hash;
+	char phyname[32];
+	struct iwpaninfo_phy_caps caps;
+};
+
+struct fleet_acc {
+	uint32_t files;
+	uint32_t skipped;
+	uint32_t dropped;		/* interfaces of full images */
+	uint32_t channels[IWPANINFO_MAX_PAGES][32];
+	uint32_t txpower[FLEET_TXPOWER_BUCKETS];
+	int32_t txpower_min;
+	int32_t txpower_max;
+	int64_t txpower_sum;
+	uint32_t txpower_count;
+	uint32_t params[FLEET_NUM_PARAMS][256];
+	struct fleet_iface *ifaces;
+	int num_ifaces;
+	int max_ifaces;
+	struct fleet_phy *phys;
+	int num_phys;
+	int max_phys;
+};
+
+struct fleet_worker {
+	pthread_t thread;
+	struct fleet_acc acc;
+};
+
+static struct fleet_file *files;
+static int num_files;
+static int next_file;
+
+static void * fleet_grow(void *p, int *max, size_t size)
+{
+	int n = *max ? *max * 2 : 256;
+
+	p = realloc(p, n * size);
+	if (p)
+		*max = n;
+
+	return p;
+}
+
+/* FNV-1a, the capability structs are zero filled before decoding */
+static uint32_t fleet_hash(const void *buf, size_t len)
+{
+	const uint8_t *p = buf;
+	uint32_t h = 2166136261u;
+
+	while (len--)
+		h = (h ^ *p++) * 16777619u;
+
+	return h;
+}
+
+static void fleet_add_iface(struct fleet_acc *a, uint32_t file,
+                            const struct iwpaninfo_info *info)
+{
+	struct fleet_iface *fi;
+	int i, dbm;
+
+	if ((info->valid & IWPANINFO_FIELD_PAGE) &&
+	    (info->valid & IWPANINFO_FIELD_CHANNEL) &&
+	    info->page < IWPANINFO_MAX_PAGES && info->channel < 32)
+		a->channels[info->page][info->channel]++;
+
+	if (info->valid & IWPANINFO_FIELD_TXPOWER)
+	{
+		dbm = iwpaninfo_mbm2dbm(info->txpower);
+		dbm = (dbm < FLEET_TXPOWER_MIN) ? FLEET_TXPOWER_MIN : dbm;
+		dbm = (dbm > FLEET_TXPOWER_MAX) ? FLEET_TXPOWER_MAX : dbm;
+		a->txpower[dbm - FLEET_TXPOWER_MIN]++;
+
+		if (!a->txpower_count || info->txpower < a->txpower_min)
+			a->txpower_min = info->txpower;
+
+		if (!a->txpower_count || info->txpower > a->txpower_max)
+			a->txpower_max = info->txpower;
+
+		a->txpower_sum += info->txpower;
+		a->txpower_count++;
+	}
+
+	if (a->num_ifaces == a->max_ifaces)
+	{
+		fi = fleet_grow(a->ifaces, &a->max_ifaces, sizeof(*fi));
+		if (!fi)
+			return;
+
+		a->ifaces = fi;
+	}
+
+	fi = &a->ifaces[a->num_ifaces++];
+	fi->file = file;
+	fi->valid = info->valid;
+	fi->params[FLEET_MIN_BE] = info->min_be;
+	fi->params[FLEET_MAX_BE] = info->max_be;
+	fi->params[FLEET_CSMA_BACKOFF] = info->csma_backoff;
+	fi->params[FLEET_FRAME_RETRY] = (uint8_t)info->frame_retry;
+	memcpy(fi->ifname, info->ifname, sizeof(fi->ifname));
+
+	for (i = 0; i < FLEET_NUM_PARAMS; i++)
+		if (info->valid & fleet_param_fields[i])
+			a->params[i][fi->params[i]]++;
+}
+
+static void fleet_add_phy(struct fleet_acc *a, uint32_t file,
+                          const char *phyname,
+                          const struct iwpaninfo_phy_caps *caps)
+{
+	struct fleet_phy *fp;
+
+	if (a->num_phys == a->max_phys)
+	{
+		fp = fleet_grow(a->phys, &a->max_phys, sizeof(*fp));
+		if (!fp)
+			return;
+
+		a->phys = fp;
+	}
+
+	fp = &a->phys[a->num_phys++];
+	fp->file = file;
+	fp->hash = fleet_hash(caps, sizeof(*caps));
+	fp->caps = *caps;
+	memcpy(fp->phyname, phyname, sizeof(fp->phyname));
+}
+
+static void fleet_process(struct fleet_acc *a, uint32_t idx)
+{
+	struct iwpaninfo_info info[IWPANINFO_MAX_IFACES];
+	struct iwpaninfo_phy_caps caps;
+	struct iwpaninfo_image img;
+	uint32_t count, stride;
+	char phyname[32];
+	int i, n;
+
+	if (iwpaninfo_image_map(&img, files[idx].path))
+	{
+		a->skipped++;
+		return;
+	}
+
+	memcpy(files[idx].host, iwpaninfo_image_header(&img)->hostname,
+	       sizeof(files[idx].host) - 1);
+
+	n = iwpaninfo_image_ifaces(&img, info, IWPANINFO_MAX_IFACES);
+
+	for (i = 0; i < n; i++)
+		fleet_add_iface(a, idx, &info[i]);
+
+	/* left out by the writer or beyond what a snapshot holds here */
+	a->dropped += iwpaninfo_image_dropped(&img);
+
+	if (n >= 0 &&
+	    iwpaninfo_image_section(&img, IWPANINFO_IMAGE_IFACES, &count, &stride))
+		a->dropped += count - n;
+
+	for (i = 0; iwpaninfo_image_caps(&img, i, phyname, &caps) >= 0; i++)
+		fleet_add_phy(a, idx, phyname, &caps);
+
+	iwpaninfo_image_close(&img);
+	a->files++;
+}
+
+static void * fleet_worker_main(void *arg)
+{
+	struct fleet_worker *w = arg;
+	int idx;
+
+	while ((idx = __atomic_fetch_add(&next_file, 1, __ATOMIC_RELAXED)) < num_files)
+		fleet_process(&w->acc, idx);
+
+	return NULL;
+}
+
+static void fleet_merge(struct fleet_acc *dst, struct fleet_acc *src)
+{
+	int i, j;
+
+	dst->files += src->files;
+	dst->skipped += src->skipped;
+	dst->dropped += src->dropped;
+
+	for (i = 0; i < IWPANINFO_MAX_PAGES; i++)
+		for (j = 0; j < 32; j++)
+			dst->channels[i][j] += src->channels[i][j];
+
+	for (i = 0; i < FLEET_TXPOWER_BUCKETS; i++)
+		dst->txpower[i] += src->txpower[i];
+
+	if (src->txpower_count)
+	{
+		if (!dst->txpower_count || src->txpower_min < dst->txpower_min)
+			dst->txpower_min = src->txpower_min;
+
+		if (!dst->txpower_count || src->txpower_max > dst->txpower_max)
+			dst->txpower_max = src->txpower_max;
+	}
+
+	dst->txpower_sum += src->txpower_sum;
+	dst->txpower_count += src->txpower_count;
+
+	for (i = 0; i < FLEET_NUM_PARAMS; i++)
+		for (j = 0; j < 256; j++)
+			dst->params[i][j] += src->params[i][j];
+
+	for (i = 0; i < src->num_ifaces; i++)
+	{
+		if (dst->num_ifaces == dst->max_ifaces)
+		{
+			struct fleet_iface *p = fleet_grow(dst->ifaces, &dst->max_ifaces,
+			                                   sizeof(*p));
+			if (!p)
+				break;
+
+			dst->ifaces = p;
+		}
+
+		dst->ifaces[dst->num_ifaces++] = src->ifaces[i];
+	}
+
+	for (i = 0; i < src->num_phys; i++)
+	{
+		if (dst->num_phys == dst->max_phys)
+		{
+			struct fleet_phy *p = fleet_grow(dst->phys, &dst->max_phys,
+			                                 sizeof(*p));
+			if (!p)
+				break;
+
+			dst->phys = p;
+		}
+
+		dst->phys[dst->num_phys++] = src->phys[i];
+	}
+
+	free(src->ifaces);
+	free(src->phys);
+}
+
+static int fleet_cmp_path(const void *a, const void *b)
+{
+	return strcmp(((const struct fleet_file *)a)->path,
+	              ((const struct fleet_file *)b)->path);
+}
+
+/* record order depends on scheduling, sort by file for stable reports */
+static int fleet_cmp_iface(const void *a, const void *b)
+{
+	const struct fleet_iface *x = a, *y = b;
+
+	if (x->file != y->file)
+		return (x->file > y->file) - (x->file < y->file);
+
+	return strcmp(x->ifname, y->ifname);
+}
+
+static int fleet_cmp_phy(const void *a, const void *b)
+{
+	const struct fleet_phy *x = a, *y = b;
+
+	if (x->file != y->file)
+		return (x->file > y->file) - (x->file < y->file);
+
+	return strcmp(x->phyname, y->phyname);
+}
+
+static const char * fleet_host(uint32_t file)
+{
+	return files[file].host[0] ? files[file].host : files[file].path;
+}
+
+static void fleet_report_channels(const struct fleet_acc *a)
+{
+	uint32_t total = 0;
+	int page, ch;
+
+	for (page = 0; page < IWPANINFO_MAX_PAGES; page++)
+		for (ch = 0; ch < 32; ch++)
+			total += a->channels[page][ch];
+
+	printf("Channel occupancy (%u interfaces)\n", total);
+
+	for (page = 0; page < IWPANINFO_MAX_PAGES; page++)
+	{
+		for (ch = 0; ch < 32; ch++)
+		{
+			if (!a->channels[page][ch])
+				continue;
+
+			printf("	page %2d channel %2d  %8u  %5.1f%%\n", page, ch,
+			       a->channels[page][ch],
+			       100.0 * a->channels[page][ch] / total);
+		}
+	}
+
+	printf("\n");
+}
+
+static void fleet_report_txpower(const struct fleet_acc *a)
+{
+	uint32_t seen = 0, median = 0;
+	int i;
+
+	printf("Tx power distribution (%u interfaces)\n", a->txpower_count);
+
+	if (!a->txpower_count)
+	{
+		printf("\n");
+		return;
+	}
+
+	for (i = 0; i < FLEET_TXPOWER_BUCKETS; i++)
+	{
+		if (seen <= a->txpower_count / 2 &&
+		    seen + a->txpower[i] > a->txpower_count / 2)
+			median = i;
+
+		seen += a->txpower[i];
+	}
+
+	printf("	min %.2f dBm, max %.2f dBm, mean %.2f dBm, median %d dBm\n",
+	       a->txpower_min / 100.0, a->txpower_max / 100.0,
+	       a->txpower_sum / 100.0 / a->txpower_count,
+	       (int)median + FLEET_TXPOWER_MIN);
+
+	for (i = 0; i < FLEET_TXPOWER_BUCKETS; i++)
+		if (a->txpower[i])
+			printf("	%3d dBm  %8u  %5.1f%%\n", i + FLEET_TXPOWER_MIN,
+			       a->txpower[i], 100.0 * a->txpower[i] / a->txpower_count);
+
+	printf("\n");
+}
+
+static void fleet_report_csma(const struct fleet_acc *a, int limit)
+{
+	const struct fleet_iface *fi;
+	int mode[FLEET_NUM_PARAMS];
+	int i, j, n = 0, odd;
+
+	for (i = 0; i < FLEET_NUM_PARAMS; i++)
+		for (j = mode[i] = 0; j < 256; j++)
+			if (a->params[i][j] > a->params[i][mode[i]])
+				mode[i] = j;
+
+	printf("CSMA/CA parameters (fleet mode:");
+
+	for (i = 0; i < FLEET_NUM_PARAMS; i++)
+		printf(" %s=%d", fleet_param_names[i],
+		       (i == FLEET_FRAME_RETRY) ? (int8_t)mode[i] : mode[i]);
+
+	printf(")\n");
+
+	for (i = 0; i < a->num_ifaces; i++)
+	{
+		fi = &a->ifaces[i];
+
+		for (j = odd = 0; j < FLEET_NUM_PARAMS; j++)
+			if ((fi->valid & fleet_param_fields[j]) &&
+			    fi->params[j] != mode[j])
+				odd = 1;
+
+		if (!odd)
+			continue;
+
+		if (limit <= 0 || n < limit)
+		{
+			printf("	%s %s:", fleet_host(fi->file), fi->ifname);
+
+			for (j = 0; j < FLEET_NUM_PARAMS; j++)
+				if ((fi->valid & fleet_param_fields[j]) &&
+				    fi->params[j] != mode[j])
+					printf(" %s=%d", fleet_param_names[j],
+					       (j == FLEET_FRAME_RETRY)
+					       ? (int8_t)fi->params[j] : fi->params[j]);
+
+			printf("\n");
+		}
+
+		n++;
+	}
+
+	if (limit > 0 && n > limit)
+		printf("	... %d more\n", n - limit);
+
+	printf("	%d outliers\n\n", n);
+}
+
+static int fleet_cmp_hash(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void fleet_print_bits(const char *name, uint32_t val, uint32_t norm)
+{
+	if (val != norm)
+		printf(" %s=0x%x (0x%x)", name, val, norm);
+}
+
+static void fleet_print_range(const char *name, int lo, int hi,
+                              int norm_lo, int norm_hi)
+{
+	if (lo != norm_lo || hi != norm_hi)
+		printf(" %s=%d..%d (%d..%d)", name, lo, hi, norm_lo, norm_hi);
+}
+
+static void fleet_print_levels(const char *name,
+                               const int32_t *val, uint32_t n,
+                               const int32_t *norm, uint32_t norm_n)
+{
+	char num[24];
+	uint32_t i;
+
+	if (n == norm_n && !memcmp(val, norm, n * sizeof(*val)))
+		return;
+
+	printf(" %s=", name);
+
+	for (i = 0; i < n; i++)
+		printf("%s%s", i ? "," : "",
+		       iwpaninfo_format_fixed(num, sizeof(num), val[i], 2));
+
+	printf(" (");
+
+	for (i = 0; i < norm_n; i++)
+		printf("%s%s", i ? "," : "",
+		       iwpaninfo_format_fixed(num, sizeof(num), norm[i], 2));
+
+	printf(")");
+}
+
+/* The members of c that differ from the norm, as value (norm value) */
+static void fleet_print_caps(const struct iwpaninfo_phy_caps *c,
+                             const struct iwpaninfo_phy_caps *norm)
+{
+	char name[16];
+	int i;
+
+	for (i = 0; i < IWPANINFO_MAX_PAGES; i++)
+	{
+		snprintf(name, sizeof(name), "page%d", i);
+		fleet_print_bits(name, c->channels[i], norm->channels[i]);
+	}
+
+	fleet_print_levels("txpowers", c->txpowers, c->num_txpowers,
+	                   norm->txpowers, norm->num_txpowers);
+	fleet_print_levels("cca_ed_levels", c->cca_ed_levels,
+	                   c->num_cca_ed_levels, norm->cca_ed_levels,
+	                   norm->num_cca_ed_levels);
+
+	fleet_print_bits("iftypes", c->iftypes, norm->iftypes);
+	fleet_print_bits("cca_modes", c->cca_modes, norm->cca_modes);
+	fleet_print_bits("cca_opts", c->cca_opts, norm->cca_opts);
+	fleet_print_bits("lbt", c->lbt, norm->lbt);
+	for (i = 0; i < IWPANINFO_COMMAND_WORDS; i++)
+	{
+		snprintf(name, sizeof(name), "commands%d", i);
+		fleet_print_bits(name, c->commands[i], norm->commands[i]);
+	}
+
+	fleet_print_range("min_be", c->min_minbe, c->max_minbe,
+	                  norm->min_minbe, norm->max_minbe);
+	fleet_print_range("max_be", c->min_maxbe, c->max_maxbe,
+	                  norm->min_maxbe, norm->max_maxbe);
+	fleet_print_range("csma_backoffs", c->min_csma_backoffs,
+	                  c->max_csma_backoffs, norm->min_csma_backoffs,
+	                  norm->max_csma_backoffs);
+	fleet_print_range("frame_retries", c->min_frame_retries,
+	                  c->max_frame_retries, norm->min_frame_retries,
+	                  norm->max_frame_retries);
+}
+
+static void fleet_report_caps(const struct fleet_acc *a, int limit)
+{
+	const struct iwpaninfo_phy_caps *norm_caps = NULL;
+	uint32_t *hashes, norm = 0;
+	int i, run, best = 0, variants = 0, n = 0;
+
+	if (!a->num_phys)
+		return;
+
+	hashes = malloc(a->num_phys * sizeof(*hashes));
+	if (!hashes)
+		return;
+
+	for (i = 0; i < a->num_phys; i++)
+		hashes[i] = a->phys[i].hash;
+
+	/* the most common capability set is taken as the norm */
+	qsort(hashes, a->num_phys, sizeof(*hashes), fleet_cmp_hash);
+
+	for (i = 0; i < a->num_phys; i += run)
+	{
+		for (run = 1; i + run < a->num_phys && hashes[i + run] == hashes[i]; run++)
+			;
+
+		if (run > best)
+		{
+			best = run;
+			norm = hashes[i];
+		}
+
+		variants++;
+	}
+
+	free(hashes);
+
+	printf("Phy capabilities (%d phys, %d variants, norm %08x shared by %d)\n",
+	       a->num_phys, variants, norm, best);
+
+	for (i = 0; i < a->num_phys && !norm_caps; i++)
+		if (a->phys[i].hash == norm)
+			norm_caps = &a->phys[i].caps;
+
+	/* the hash only groups, a colliding phy still has to match in full */
+	for (i = 0; i < a->num_phys; i++)
+	{
+		if (a->phys[i].hash == norm &&
+		    !memcmp(&a->phys[i].caps, norm_caps, sizeof(*norm_caps)))
+			continue;
+
+		if (limit <= 0 || n < limit)
+		{
+			printf("	%s %s: caps %08x", fleet_host(a->phys[i].file),
+			       a->phys[i].phyname, a->phys[i].hash);
+			fleet_print_caps(&a->phys[i].caps, norm_caps);
+			printf("\n");
+		}
+
+		n++;
+	}
+
+	if (limit > 0 && n > limit)
+		printf("	... %d more\n", n - limit);
+
+	printf("	%d outliers\n\n", n);
+}
+
+static int fleet_add_path(const char *path)
+{
+	struct fleet_file *f;
+	static int max;
+
+	if (num_files == max)
+	{
+		f = fleet_grow(files, &max, sizeof(*f));
+		if (!f)
+			return -1;
+
+		files = f;
+	}
+
+	memset(&files[num_files], 0, sizeof(files[num_files]));
+	files[num_files++].path = path;
+
+	return 0;
+}
+
+/* Add a file, or every exported image inside a directory */
+static int fleet_scan(const char *path)
+{
+	size_t len, slen = strlen(IWPANINFO_IMAGE_SUFFIX);
+	struct dirent *e;
+	struct stat st;
+	char *p;
+	DIR *d;
+
+	if (stat(path, &st))
+	{
+		fprintf(stderr, "Unable to stat %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if (!S_ISDIR(st.st_mode))
+		return fleet_add_path(path);
+
+	d = opendir(path);
+	if (!d)
+		return -1;
+
+	while ((e = readdir(d)) != NULL)
+	{
+		len = strlen(e->d_name);
+
+		if (len <= slen ||
+		    strcmp(e->d_name + len - slen, IWPANINFO_IMAGE_SUFFIX))
+			continue;
+
+		p = malloc(strlen(path) + len + 2);
+		if (p)
+			sprintf(p, "%s/%s", path, e->d_name);
+
+		if (!p || fleet_add_path(p))
+		{
+			free(p);
+			closedir(d);
+			return -1;
+		}
+	}
+
+	closedir(d);
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage:\n"
+		"	%s [-j <threads>] [-l <limit>] <file|directory> ...\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	static struct fleet_worker workers[FLEET_MAX_THREADS];
+	static struct fleet_acc total;
+	int ch, i, threads = 0, limit = 50;
+
+	while ((ch = getopt(argc, argv, "j:l:")) != -1)
+	{
+		switch (ch)
+		{
+		case 'j':
+			threads = atoi(optarg);
+			break;
+
+		case 'l':
+			limit = atoi(optarg);
+			break;
+
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind >= argc)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	for (i = optind; i < argc; i++)
+		if (fleet_scan(argv[i]))
+			return 1;
+
+	qsort(files, num_files, sizeof(*files), fleet_cmp_path);
+
+	if (threads <= 0)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (threads > FLEET_MAX_THREADS)
+		threads = FLEET_MAX_THREADS;
+
+	if (threads > num_files)
+		threads = num_files;
+
+	if (threads < 1)
+		threads = 1;
+
+	for (i = 1; i < threads; i++)
+		if (pthread_create(&workers[i].thread, NULL, fleet_worker_main,
+		                   &workers[i]))
+			break;
+
+	/* the main thread takes part, files are handed out one at a time */
+	threads = i;
+	fleet_worker_main(&workers[0]);
+
+	for (i = 1; i < threads; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	for (i = 0; i < threads; i++)
+		fleet_merge(&total, &workers[i].acc);
+
+	qsort(total.ifaces, total.num_ifaces, sizeof(*total.ifaces),
+	      fleet_cmp_iface);
+	qsort(total.phys, total.num_phys, sizeof(*total.phys), fleet_cmp_phy);
+
+	printf("%u images read, %u skipped\n", total.files, total.skipped);
+
+	if (total.dropped)
+		printf("%u interfaces missing from full images\n", total.dropped);
+
+	printf("\n");
+
+	fleet_report_channels(&total);
+	fleet_report_txpower(&total);
+	fleet_report_csma(&total, limit);
+	fleet_report_caps(&total, limit);
+
+	return 0;
+}
@@ -0,0 +1,565 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Metric history
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <sys/stat.h>
+#include <limits.h>
+#include <time.h>
+
+#include "iwpaninfo/history.h"
+
+/* give up on a segment whose writer keeps it odd, e.g. died mid-update */
+#define IWPANINFO_HISTORY_RETRIES	64
+
+/* two varints of at most ten bytes each */
+#define RING_RECORD_MAX		20
+
+const char *IWPANINFO_METRIC_NAMES[] = {
+	"txpower",
+	"channel",
+	"cca_mode",
+	"cca_opt",
+	"cca_ed_level",
+	"rx_packets",
+	"tx_packets",
+	"rx_bytes",
+	"tx_bytes",
+	"rx_errors",
+	"tx_errors",
+	"rx_dropped",
+	"tx_dropped",
+};
+
+static inline uint64_t ring_zigzag(int64_t v)
+{
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t ring_unzigzag(uint64_t v)
+{
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static int ring_put_varint(uint8_t *p, uint64_t v)
+{
+	int n = 0;
+
+	while (v >= 0x80)
+	{
+		p[n++] = v | 0x80;
+		v >>= 7;
+	}
+
+	p[n++] = v;
+
+	return n;
+}
+
+static int64_t ring_get_varint(const struct iwpaninfo_ring *r,
+                               const uint8_t *buf, uint32_t *pos)
+{
+	uint64_t v = 0;
+	int shift = 0;
+	uint8_t b;
+
+	do {
+		b = buf[*pos];
+		*pos = (*pos + 1) % r->size;
+		v |= (uint64_t)(b & 0x7f) << shift;
+		shift += 7;
+	} while ((b & 0x80) && shift < 64);
+
+	return ring_unzigzag(v);
+}
+
+void iwpaninfo_ring_init(struct iwpaninfo_ring *r, uint32_t size)
+{
+	memset(r, 0, sizeof(*r));
+	r->size = size;
+}
+
+/* Drop the oldest sample, the second oldest becomes the stored base */
+static void ring_evict(struct iwpaninfo_ring *r, const uint8_t *buf)
+{
+	uint32_t pos = r->head;
+
+	r->first_dt += ring_get_varint(r, buf, &pos);
+	r->first_ts += r->first_dt;
+	r->first_val += ring_get_varint(r, buf, &pos);
+
+	r->len -= (pos + r->size - r->head) % r->size;
+	r->head = pos;
+	r->count--;
+}
+
+int iwpaninfo_ring_push(struct iwpaninfo_ring *r, uint8_t *buf,
+                        int64_t ts, int64_t val)
+{
+	uint8_t rec[RING_RECORD_MAX];
+	uint32_t i, pos;
+	int64_t dt;
+	int n;
+
+	if (!r->size)
+		return -1;
+
+	if (!r->count)
+	{
+		r->first_ts = r->last_ts = ts;
+		r->first_val = r->last_val = val;
+		r->first_dt = r->last_dt = 0;
+		r->head = r->len = 0;
+		r->count = 1;
+		return 0;
+	}
+
+	dt = ts - r->last_ts;
+	n = ring_put_varint(rec, ring_zigzag(dt - r->last_dt));
+	n += ring_put_varint(rec + n, ring_zigzag(val - r->last_val));
+
+	if (n >= r->size)
+		return -1;
+
+	while (r->size - r->len < n)
+		ring_evict(r, buf);
+
+	pos = (r->head + r->len) % r->size;
+
+	for (i = 0; i < n; i++)
+		buf[(pos + i) % r->size] = rec[i];
+
+	r->len += n;
+	r->count++;
+	r->last_ts = ts;
+	r->last_val = val;
+	r->last_dt = dt;
+
+	return 0;
+}
+
+/* Decode all samples, skip the first skip matches and copy up to max */
+static int ring_walk(const struct iwpaninfo_ring *r, const uint8_t *buf,
+                     int64_t from, int64_t to, int skip,
+                     struct iwpaninfo_sample *out, int max)
+{
+	int64_t ts = r->first_ts, val = r->first_val, dt = r->first_dt;
+	uint32_t i, pos = r->head;
+	int n = 0;
+
+	for (i = 0; i < r->count; i++)
+	{
+		if (i)
+		{
+			dt += ring_get_varint(r, buf, &pos);
+			ts += dt;
+			val += ring_get_varint(r, buf, &pos);
+		}
+
+		if (ts < from || ts > to || skip-- > 0)
+			continue;
+
+		if (out && n < max)
+		{
+			out[n].ts = ts;
+			out[n].value = val;
+		}
+
+		n++;
+	}
+
+	return (n < max) ? n : max;
+}
+
+int iwpaninfo_ring_query(const struct iwpaninfo_ring *r, const uint8_t *buf,
+                         int64_t from, int64_t to, int last,
+                         struct iwpaninfo_sample *out, int max)
+{
+	int total, keep;
+
+	if (!r->size || max <= 0)
+		return 0;
+
+	/* count first so that the newest matches are the ones kept */
+	total = ring_walk(r, buf, from, to, 0, NULL, INT_MAX);
+	keep = total;
+
+	if (last > 0 && keep > last)
+		keep = last;
+
+	if (keep > max)
+		keep = max;
+
+	return ring_walk(r, buf, from, to, total - keep, out, keep);
+}
+
+int iwpaninfo_metric_by_name(const char *name)
+{
+	int i;
+
+	for (i = 0; i < IWPANINFO_METRIC_COUNT; i++)
+		if (!strcmp(IWPANINFO_METRIC_NAMES[i], name))
+			return i;
+
+	return -1;
+}
+
+static inline int history_is_counter(int metric)
+{
+	return metric >= IWPANINFO_METRIC_RX_PACKETS;
+}
+
+static uint32_t history_iface_size(const uint32_t *sizes)
+{
+	uint32_t i, size = 0;
+
+	for (i = 0; i < IWPANINFO_METRIC_COUNT; i++)
+		size += sizes[i];
+
+	return size;
+}
+
+/* Offset of a ring buffer in the pool, from the sizes of its neighbours */
+static uint32_t history_ring_offset(const struct iwpaninfo_history *h,
+                                    const struct iwpaninfo_history_iface *hi,
+                                    int metric)
+{
+	uint32_t i, off = hi->offset;
+
+	for (i = 0; i < metric; i++)
+		off += h->sizes[i];
+
+	return off;
+}
+
+static int64_t history_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+struct iwpaninfo_history * iwpaninfo_history_create(const uint32_t *sizes)
+{
+	struct iwpaninfo_history *h;
+	uint32_t i, sz[IWPANINFO_METRIC_COUNT];
+	size_t total;
+	int fd;
+
+	for (i = 0; i < IWPANINFO_METRIC_COUNT; i++)
+	{
+		if (sizes)
+			sz[i] = sizes[i];
+		else if (history_is_counter(i))
+			sz[i] = IWPANINFO_HISTORY_COUNTER_SIZE;
+		else
+			sz[i] = IWPANINFO_HISTORY_SETTING_SIZE;
+
+		if (sz[i] > IWPANINFO_HISTORY_MAX_RING)
+		{
+			errno = EINVAL;
+			return NULL;
+		}
+	}
+
+	total = sizeof(*h) + history_iface_size(sz) * IWPANINFO_MAX_IFACES;
+
+	/* the size may differ from a previous run, start from a new object */
+	shm_unlink(IWPANINFO_HISTORY_NAME);
+
+	fd = shm_open(IWPANINFO_HISTORY_NAME, O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+		return NULL;
+
+	if (ftruncate(fd, total))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	h = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (h == MAP_FAILED)
+		return NULL;
+
+	/* pool pages are only backed once a ring writes to them */
+	h->version = IWPANINFO_HISTORY_VERSION;
+	h->pool_size = total - sizeof(*h);
+	memcpy(h->sizes, sz, sizeof(h->sizes));
+
+	__atomic_store_n(&h->magic, IWPANINFO_HISTORY_MAGIC, __ATOMIC_RELEASE);
+
+	return h;
+}
+
+static struct iwpaninfo_history_iface *
+history_find(struct iwpaninfo_history *h, const char *ifname)
+{
+	int i;
+
+	for (i = 0; i < h->count; i++)
+		if (!strncmp(h->ifaces[i].ifname, ifname, IFNAMSIZ))
+			return &h->ifaces[i];
+
+	return NULL;
+}
+
+/*
+ * The slot of ifname, a new one while the table has room and otherwise
+ * the one of the interface not seen for the longest time. Slots seen at
+ * ts belong to interfaces of the current record and are never taken.
+ */
+static struct iwpaninfo_history_iface *
+history_iface(struct iwpaninfo_history *h, const char *ifname, int64_t ts)
+{
+	struct iwpaninfo_history_iface *hi;
+	uint32_t offset;
+	int i;
+
+	if (!ifname[0])
+		return NULL;
+
+	hi = history_find(h, ifname);
+	if (hi)
+	{
+		hi->seen = ts;
+		return hi;
+	}
+
+	if (h->count < IWPANINFO_MAX_IFACES)
+	{
+		hi = &h->ifaces[h->count];
+		offset = h->count * history_iface_size(h->sizes);
+		h->count++;
+	}
+	else
+	{
+		for (i = 0; i < h->count; i++)
+			if (h->ifaces[i].seen < ts &&
+			    (!hi || h->ifaces[i].seen < hi->seen))
+				hi = &h->ifaces[i];
+
+		if (!hi)
+			return NULL;
+
+		offset = hi->offset;
+	}
+
+	memset(hi, 0, sizeof(*hi));
+	strncpy(hi->ifname, ifname, IFNAMSIZ - 1);
+	hi->offset = offset;
+	hi->seen = ts;
+
+	for (i = 0; i < IWPANINFO_METRIC_COUNT; i++)
+		iwpaninfo_ring_init(&hi->rings[i], h->sizes[i]);
+
+	return hi;
+}
+
+static void history_push(struct iwpaninfo_history *h,
+                         struct iwpaninfo_history_iface *hi,
+                         int metric, int64_t ts, int64_t val)
+{
+	struct iwpaninfo_ring *r = &hi->rings[metric];
+
+	/* configuration changes rarely, only the steps are kept */
+	if (!history_is_counter(metric) && r->count && r->last_val == val)
+		return;
+
+	iwpaninfo_ring_push(r, h->pool + history_ring_offset(h, hi, metric),
+	                    ts, val);
+}
+
+void iwpaninfo_history_record(struct iwpaninfo_history *h,
+                              const struct iwpaninfo_info *info, int n,
+                              const struct iwpaninfo_link_stats *links, int m)
+{
+	struct iwpaninfo_history_iface *hi;
+	const struct iwpaninfo_link_stats *s;
+	int64_t ts = history_now();
+	uint32_t seq = h->seq, dropped = 0;
+	int i;
+
+	__atomic_store_n(&h->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	/* claim the slots of present interfaces before any is handed out */
+	for (i = 0; i < n; i++)
+		if ((hi = history_find(h, info[i].ifname)) != NULL)
+			hi->seen = ts;
+
+	for (i = 0; i < m; i++)
+		if ((hi = history_find(h, links[i].ifname)) != NULL)
+			hi->seen = ts;
+
+	for (i = 0; i < n; i++)
+	{
+		hi = history_iface(h, info[i].ifname, ts);
+		if (!hi)
+		{
+			dropped++;
+			continue;
+		}
+
+		if (info[i].valid & IWPANINFO_FIELD_TXPOWER)
+			history_push(h, hi, IWPANINFO_METRIC_TXPOWER, ts, info[i].txpower);
+
+		if (info[i].valid & IWPANINFO_FIELD_CHANNEL)
+			history_push(h, hi, IWPANINFO_METRIC_CHANNEL, ts, info[i].channel);
+
+		if (info[i].valid & IWPANINFO_FIELD_CCA_MODE)
+			history_push(h, hi, IWPANINFO_METRIC_CCA_MODE, ts, info[i].cca_mode);
+
+		if (info[i].valid & IWPANINFO_FIELD_CCA_OPT)
+			history_push(h, hi, IWPANINFO_METRIC_CCA_OPT, ts, info[i].cca_opt);
+
+		if (info[i].valid & IWPANINFO_FIELD_CCA_ED_LEVEL)
+			history_push(h, hi, IWPANINFO_METRIC_CCA_ED_LEVEL, ts,
+			             info[i].cca_ed_level);
+	}
+
+	for (i = 0; i < m; i++)
+	{
+		s = &links[i];
+
+		/* a wpan without a slot was counted with the info above */
+		hi = history_iface(h, s->ifname, ts);
+		if (!hi)
+		{
+			if (s->type != IWPANINFO_LINK_WPAN)
+				dropped++;
+			continue;
+		}
+
+		history_push(h, hi, IWPANINFO_METRIC_RX_PACKETS, ts, s->rx_packets);
+		history_push(h, hi, IWPANINFO_METRIC_TX_PACKETS, ts, s->tx_packets);
+		history_push(h, hi, IWPANINFO_METRIC_RX_BYTES, ts, s->rx_bytes);
+		history_push(h, hi, IWPANINFO_METRIC_TX_BYTES, ts, s->tx_bytes);
+		history_push(h, hi, IWPANINFO_METRIC_RX_ERRORS, ts, s->rx_errors);
+		history_push(h, hi, IWPANINFO_METRIC_TX_ERRORS, ts, s->tx_errors);
+		history_push(h, hi, IWPANINFO_METRIC_RX_DROPPED, ts, s->rx_dropped);
+		history_push(h, hi, IWPANINFO_METRIC_TX_DROPPED, ts, s->tx_dropped);
+	}
+
+	h->dropped = dropped;
+
+	__atomic_store_n(&h->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void iwpaninfo_history_destroy(struct iwpaninfo_history *h)
+{
+	shm_unlink(IWPANINFO_HISTORY_NAME);
+	munmap(h, sizeof(*h) + h->pool_size);
+}
+
+/*
+ * Copy one ring and its buffer out of the segment under the seqlock and
+ * decode the private copy, the writer is never held up by a reader.
+ */
+static int history_copy(const struct iwpaninfo_history *h, const char *ifname,
+                        int metric, struct iwpaninfo_ring *ring, uint8_t *buf)
+{
+	const struct iwpaninfo_history_iface *hi;
+	uint32_t seq, count, off;
+	int i, tries;
+
+	for (tries = 0; tries < IWPANINFO_HISTORY_RETRIES; tries++)
+	{
+		seq = __atomic_load_n(&h->seq, __ATOMIC_ACQUIRE);
+
+		if (seq & 1)
+			continue;
+
+		count = h->count;
+		if (count > IWPANINFO_MAX_IFACES)
+			count = IWPANINFO_MAX_IFACES;
+
+		for (i = 0, hi = NULL; i < count && !hi; i++)
+			if (!strncmp(h->ifaces[i].ifname, ifname, IFNAMSIZ))
+				hi = &h->ifaces[i];
+
+		if (hi)
+		{
+			memcpy(ring, &hi->rings[metric], sizeof(*ring));
+			off = history_ring_offset(h, hi, metric);
+
+			if (ring->size != h->sizes[metric] ||
+			    off + ring->size > h->pool_size)
+				return -1;
+
+			memcpy(buf, h->pool + off, ring->size);
+		}
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (__atomic_load_n(&h->seq, __ATOMIC_RELAXED) == seq)
+			return hi ? 0 : -1;
+	}
+
+	return -1;
+}
+
+int iwpaninfo_history_query(const char *ifname, int metric,
+                            int64_t from, int64_t to, int last,
+                            struct iwpaninfo_sample *out, int max)
+{
+	const struct iwpaninfo_history *h;
+	struct iwpaninfo_ring ring;
+	struct stat st;
+	uint8_t *buf;
+	int fd, n = -1;
+
+	if (metric < 0 || metric >= IWPANINFO_METRIC_COUNT)
+		return -1;
+
+	fd = shm_open(IWPANINFO_HISTORY_NAME, O_RDONLY, 0);
+	if (fd < 0)
+		return -1;
+
+	if (fstat(fd, &st) || st.st_size < sizeof(*h))
+	{
+		close(fd);
+		return -1;
+	}
+
+	h = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (h == MAP_FAILED)
+		return -1;
+
+	if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != IWPANINFO_HISTORY_MAGIC ||
+	    h->version != IWPANINFO_HISTORY_VERSION ||
+	    sizeof(*h) + h->pool_size > st.st_size ||
+	    h->sizes[metric] > IWPANINFO_HISTORY_MAX_RING)
+		goto out;
+
+	buf = malloc(h->sizes[metric] + 1);
+	if (!buf)
+		goto out;
+
+	if (!history_copy(h, ifname, metric, &ring, buf))
+		n = iwpaninfo_ring_query(&ring, buf, from, to, last, out, max);
+
+	free(buf);
+
+out:
+	munmap((void *)h, st.st_size);
+	return n;
+}
@@ -0,0 +1,578 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Binary state images
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <endian.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "iwpaninfo/image.h"
+
+#define IMAGE_NUM_SECTIONS	4
+
+/* sections start on an 8 byte boundary so records can be read in place */
+#define IMAGE_ALIGN(x)		(((x) + 7) & ~7UL)
+
+struct image_builder {
+	struct iwpaninfo_info info[IWPANINFO_MAX_IFACES];
+	struct iwpaninfo_link_stats links[IWPANINFO_MAX_LINKS];
+	/* every phy carries an interface, so phys never outnumber them */
+	struct iwpaninfo_phy_caps caps[IWPANINFO_MAX_IFACES];
+	int phy_iface[IWPANINFO_MAX_IFACES];	/* info index naming the phy */
+	int num_info;
+	int num_links;
+	int num_phys;
+	int dropped;
+	uint32_t num_values;
+};
+
+static uint32_t image_num_pages(const struct iwpaninfo_phy_caps *caps)
+{
+	uint32_t n = IWPANINFO_MAX_PAGES;
+
+	while (n > 0 && !caps->channels[n - 1])
+		n--;
+
+	return n;
+}
+
+static void image_collect(struct image_builder *b)
+{
+	const struct iwpaninfo_info *info;
+	int i, j;
+
+	b->num_info = iwpaninfo_get_dump(b->info, IWPANINFO_MAX_IFACES);
+	if (b->num_info < 0)
+		b->num_info = 0;
+	else
+		b->dropped = iwpaninfo_dump_total() - b->num_info;
+
+	b->num_links = iwpaninfo_link_stats(b->links, IWPANINFO_MAX_LINKS);
+	if (b->num_links < 0)
+		b->num_links = 0;
+
+	/* one capability record per phy, queried through its first wpan */
+	for (i = 0; i < b->num_info; i++)
+	{
+		info = &b->info[i];
+
+		if (!(info->valid & IWPANINFO_FIELD_PHY))
+			continue;
+
+		for (j = 0; j < b->num_phys; j++)
+			if (b->info[b->phy_iface[j]].phy == info->phy)
+				break;
+
+		if (j < b->num_phys ||
+		    iwpaninfo_get_caps(info->ifname, &b->caps[b->num_phys]))
+			continue;
+
+		b->phy_iface[b->num_phys] = i;
+		b->num_values += image_num_pages(&b->caps[b->num_phys]) +
+		                 b->caps[b->num_phys].num_txpowers +
+		                 b->caps[b->num_phys].num_cca_ed_levels;
+		b->num_phys++;
+	}
+}
+
+static void image_put_iface(struct iwpaninfo_image_iface *r,
+                            const struct iwpaninfo_info *info)
+{
+	r->wpan_dev = htole64(info->wpan_dev);
+	r->extended_address = htole64(info->extended_address);
+	r->valid = htole32(info->valid);
+	r->ifindex = htole32(info->ifindex);
+	r->phy = htole32(info->phy);
+	r->txpower = htole32(info->txpower);
+	r->cca_ed_level = htole32(info->cca_ed_level);
+	r->frequency = htole32(info->frequency);
+	r->panid = htole16(info->panid);
+	r->short_address = htole16(info->short_address);
+	r->mode = info->mode;
+	r->page = info->page;
+	r->channel = info->channel;
+	r->min_be = info->min_be;
+	r->max_be = info->max_be;
+	r->csma_backoff = info->csma_backoff;
+	r->frame_retry = info->frame_retry;
+	r->lbt_mode = info->lbt_mode;
+	r->cca_mode = info->cca_mode;
+	r->cca_opt = info->cca_opt;
+	memcpy(r->ifname, info->ifname, sizeof(r->ifname));
+	memcpy(r->phyname, info->phyname, sizeof(r->phyname));
+}
+
+static uint32_t image_put_values(uint32_t *values, uint32_t *pos,
+                                 const void *src, uint32_t n)
+{
+	const uint32_t *v = src;
+	uint32_t i, start = *pos;
+
+	for (i = 0; i < n; i++)
+		values[(*pos)++] = htole32(v[i]);
+
+	return htole32(start);
+}
+
+static void image_put_phy(struct iwpaninfo_image_phy *r,
+                          const struct iwpaninfo_info *info,
+                          const struct iwpaninfo_phy_caps *caps,
+                          uint32_t *values, uint32_t *pos)
+{
+	uint32_t pages = image_num_pages(caps);
+	int i;
+
+	r->phy = htole32(info->phy);
+	r->iftypes = htole32(caps->iftypes);
+	r->cca_modes = htole32(caps->cca_modes);
+	r->cca_opts = htole32(caps->cca_opts);
+	r->lbt = htole32(caps->lbt);
+	r->commands = htole32(caps->commands[0]);
+
+	for (i = 1; i < IWPANINFO_COMMAND_WORDS; i++)
+		r->commands_hi[i - 1] = htole32(caps->commands[i]);
+	r->channels = image_put_values(values, pos, caps->channels, pages);
+	r->num_pages = htole32(pages);
+	r->txpowers = image_put_values(values, pos, caps->txpowers,
+	                               caps->num_txpowers);
+	r->num_txpowers = htole32(caps->num_txpowers);
+	r->cca_ed_levels = image_put_values(values, pos, caps->cca_ed_levels,
+	                                    caps->num_cca_ed_levels);
+	r->num_cca_ed_levels = htole32(caps->num_cca_ed_levels);
+	r->min_minbe = caps->min_minbe;
+	r->max_minbe = caps->max_minbe;
+	r->min_maxbe = caps->min_maxbe;
+	r->max_maxbe = caps->max_maxbe;
+	r->min_csma_backoffs = caps->min_csma_backoffs;
+	r->max_csma_backoffs = caps->max_csma_backoffs;
+	r->min_frame_retries = caps->min_frame_retries;
+	r->max_frame_retries = caps->max_frame_retries;
+	memcpy(r->phyname, info->phyname, sizeof(r->phyname));
+}
+
+static void image_put_link(struct iwpaninfo_image_link *r,
+                           const struct iwpaninfo_link_stats *s)
+{
+	memcpy(r->ifname, s->ifname, sizeof(r->ifname));
+	r->ifindex = htole32(s->ifindex);
+	r->link = htole32(s->link);
+	r->flags = htole32(s->flags);
+	r->type = htole32(s->type);
+	r->rx_packets = htole64(s->rx_packets);
+	r->tx_packets = htole64(s->tx_packets);
+	r->rx_bytes = htole64(s->rx_bytes);
+	r->tx_bytes = htole64(s->tx_bytes);
+	r->rx_errors = htole64(s->rx_errors);
+	r->tx_errors = htole64(s->tx_errors);
+	r->rx_dropped = htole64(s->rx_dropped);
+	r->tx_dropped = htole64(s->tx_dropped);
+}
+
+static size_t image_add_section(struct iwpaninfo_image_section *sec,
+                                uint32_t type, size_t off,
+                                uint32_t count, uint32_t stride)
+{
+	sec->type = htole32(type);
+	sec->offset = htole32(off);
+	sec->count = htole32(count);
+	sec->stride = htole32(stride);
+
+	return IMAGE_ALIGN(off + (size_t)count * stride);
+}
+
+void * iwpaninfo_image_build(size_t *len)
+{
+	struct image_builder *b;
+	struct iwpaninfo_image_header *hdr;
+	struct iwpaninfo_image_section *sec;
+	struct iwpaninfo_image_iface *ifaces;
+	struct iwpaninfo_image_phy *phys;
+	struct iwpaninfo_image_link *links;
+	struct timespec ts;
+	uint32_t *values, pos = 0;
+	uint8_t *buf = NULL;
+	size_t off;
+	int i;
+
+	b = calloc(1, sizeof(*b));
+	if (!b)
+		return NULL;
+
+	image_collect(b);
+
+	/* lay out the sections first, then fill them in one allocation */
+	off = IMAGE_ALIGN(sizeof(*hdr) + IMAGE_NUM_SECTIONS * sizeof(*sec));
+	buf = calloc(1, off + b->num_info * sizeof(*ifaces) +
+	                b->num_phys * sizeof(*phys) +
+	                b->num_links * sizeof(*links) +
+	                b->num_values * sizeof(*values) + 8 * IMAGE_NUM_SECTIONS);
+	if (!buf)
+		goto out;
+
+	hdr = (struct iwpaninfo_image_header *)buf;
+	sec = (struct iwpaninfo_image_section *)(buf + sizeof(*hdr));
+
+	ifaces = (struct iwpaninfo_image_iface *)(buf + off);
+	off = image_add_section(&sec[0], IWPANINFO_IMAGE_IFACES, off,
+	                        b->num_info, sizeof(*ifaces));
+
+	phys = (struct iwpaninfo_image_phy *)(buf + off);
+	off = image_add_section(&sec[1], IWPANINFO_IMAGE_PHYS, off,
+	                        b->num_phys, sizeof(*phys));
+
+	links = (struct iwpaninfo_image_link *)(buf + off);
+	off = image_add_section(&sec[2], IWPANINFO_IMAGE_LINKS, off,
+	                        b->num_links, sizeof(*links));
+
+	values = (uint32_t *)(buf + off);
+	off = image_add_section(&sec[3], IWPANINFO_IMAGE_VALUES, off,
+	                        b->num_values, sizeof(*values));
+
+	for (i = 0; i < b->num_info; i++)
+		image_put_iface(&ifaces[i], &b->info[i]);
+
+	for (i = 0; i < b->num_phys; i++)
+		image_put_phy(&phys[i], &b->info[b->phy_iface[i]], &b->caps[i],
+		              values, &pos);
+
+	for (i = 0; i < b->num_links; i++)
+		image_put_link(&links[i], &b->links[i]);
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	hdr->magic = htole32(IWPANINFO_IMAGE_MAGIC);
+	hdr->version = htole16(IWPANINFO_IMAGE_VERSION);
+	hdr->header_size = htole16(sizeof(*hdr));
+	hdr->size = htole32(off);
+	hdr->num_sections = htole32(IMAGE_NUM_SECTIONS);
+	hdr->timestamp = htole64((uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+	gethostname(hdr->hostname, sizeof(hdr->hostname) - 1);
+	hdr->dropped = htole32((b->dropped > 0) ? b->dropped : 0);
+
+	*len = off;
+
+out:
+	free(b);
+	return buf;
+}
+
+/*
+ * Check the header and that every section lies within the image, after
+ * this the accessors only need to bound their indexes by count.
+ */
+int iwpaninfo_image_open(struct iwpaninfo_image *img, const void *buf, size_t len)
+{
+	const struct iwpaninfo_image_header *hdr = buf;
+	const struct iwpaninfo_image_section *sec;
+	uint64_t end;
+	uint32_t i, n, hlen, off;
+
+	memset(img, 0, sizeof(*img));
+
+	if (len < IWPANINFO_IMAGE_HEADER_MIN || ((uintptr_t)buf & 7) ||
+	    le32toh(hdr->magic) != IWPANINFO_IMAGE_MAGIC ||
+	    le16toh(hdr->version) != IWPANINFO_IMAGE_VERSION)
+		return -1;
+
+	hlen = le16toh(hdr->header_size);
+	n = le32toh(hdr->num_sections);
+
+	if (hlen < IWPANINFO_IMAGE_HEADER_MIN || (hlen & 3) ||
+	    le32toh(hdr->size) > len ||
+	    (uint64_t)hlen + (uint64_t)n * sizeof(*sec) > le32toh(hdr->size))
+		return -1;
+
+	sec = (const struct iwpaninfo_image_section *)((const uint8_t *)buf + hlen);
+
+	for (i = 0; i < n; i++)
+	{
+		off = le32toh(sec[i].offset);
+		end = off + (uint64_t)le32toh(sec[i].count) * le32toh(sec[i].stride);
+
+		if ((off & 7) || end > le32toh(hdr->size))
+			return -1;
+	}
+
+	img->data = buf;
+	img->len = le32toh(hdr->size);
+
+	return 0;
+}
+
+int iwpaninfo_image_map(struct iwpaninfo_image *img, const char *path)
+{
+	struct stat st;
+	void *buf;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	if (fstat(fd, &st) || st.st_size < IWPANINFO_IMAGE_HEADER_MIN)
+	{
+		close(fd);
+		return -1;
+	}
+
+	buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (buf == MAP_FAILED)
+		return -1;
+
+	if (iwpaninfo_image_open(img, buf, st.st_size))
+	{
+		munmap(buf, st.st_size);
+		return -1;
+	}
+
+	/* unmap the whole file, not just the part the header claims */
+	img->len = st.st_size;
+	img->mapped = 1;
+
+	return 0;
+}
+
+void iwpaninfo_image_close(struct iwpaninfo_image *img)
+{
+	if (img->mapped)
+		munmap((void *)img->data, img->len);
+
+	memset(img, 0, sizeof(*img));
+}
+
+const struct iwpaninfo_image_header *
+iwpaninfo_image_header(const struct iwpaninfo_image *img)
+{
+	return (const struct iwpaninfo_image_header *)img->data;
+}
+
+uint32_t iwpaninfo_image_dropped(const struct iwpaninfo_image *img)
+{
+	const struct iwpaninfo_image_header *hdr = iwpaninfo_image_header(img);
+
+	if (!hdr || le16toh(hdr->header_size) < sizeof(*hdr))
+		return 0;
+
+	return le32toh(hdr->dropped);
+}
+
+const void * iwpaninfo_image_section(const struct iwpaninfo_image *img,
+                                     uint32_t type, uint32_t *count,
+                                     uint32_t *stride)
+{
+	const struct iwpaninfo_image_header *hdr = iwpaninfo_image_header(img);
+	const struct iwpaninfo_image_section *sec;
+	uint32_t i;
+
+	if (!hdr)
+		return NULL;
+
+	sec = (const struct iwpaninfo_image_section *)
+		(img->data + le16toh(hdr->header_size));
+
+	for (i = 0; i < le32toh(hdr->num_sections); i++)
+	{
+		if (le32toh(sec[i].type) != type)
+			continue;
+
+		*count = le32toh(sec[i].count);
+		*stride = le32toh(sec[i].stride);
+
+		return img->data + le32toh(sec[i].offset);
+	}
+
+	return NULL;
+}
+
+/* Records of a section, NULL unless they are at least min bytes each */
+static const uint8_t * image_records(const struct iwpaninfo_image *img,
+                                     uint32_t type, size_t min,
+                                     uint32_t *count, uint32_t *stride)
+{
+	const uint8_t *p = iwpaninfo_image_section(img, type, count, stride);
+
+	if (p && *stride < min)
+		return NULL;
+
+	if (!p)
+		*count = 0;
+
+	return p;
+}
+
+int iwpaninfo_image_ifaces(const struct iwpaninfo_image *img,
+                           struct iwpaninfo_info *info, int max)
+{
+	const struct iwpaninfo_image_iface *r;
+	const uint8_t *p;
+	uint32_t i, count, stride;
+
+	p = image_records(img, IWPANINFO_IMAGE_IFACES, sizeof(*r), &count, &stride);
+	if (!p && count)
+		return -1;
+
+	for (i = 0; i < count && i < max; i++)
+	{
+		r = (const struct iwpaninfo_image_iface *)(p + i * stride);
+
+		memset(&info[i], 0, sizeof(info[i]));
+		info[i].wpan_dev = le64toh(r->wpan_dev);
+		info[i].extended_address = le64toh(r->extended_address);
+		info[i].valid = le32toh(r->valid) & IWPANINFO_FIELD_ALL;
+		info[i].ifindex = le32toh(r->ifindex);
+		info[i].phy = le32toh(r->phy);
+		info[i].txpower = le32toh(r->txpower);
+		info[i].cca_ed_level = le32toh(r->cca_ed_level);
+		info[i].frequency = le32toh(r->frequency);
+		info[i].panid = le16toh(r->panid);
+		info[i].short_address = le16toh(r->short_address);
+		info[i].mode = (r->mode < IWPANINFO_OPMODE_UNKNOWN)
+			? r->mode : IWPANINFO_OPMODE_UNKNOWN;
+		info[i].page = r->page;
+		info[i].channel = r->channel;
+		info[i].min_be = r->min_be;
+		info[i].max_be = r->max_be;
+		info[i].csma_backoff = r->csma_backoff;
+		info[i].frame_retry = r->frame_retry;
+		info[i].lbt_mode = r->lbt_mode;
+		info[i].cca_mode = r->cca_mode;
+		info[i].cca_opt = r->cca_opt;
+		memcpy(info[i].ifname, r->ifname, sizeof(info[i].ifname) - 1);
+		memcpy(info[i].phyname, r->phyname, sizeof(info[i].phyname) - 1);
+	}
+
+	return i;
+}
+
+int iwpaninfo_image_links(const struct iwpaninfo_image *img,
+                          struct iwpaninfo_link_stats *links, int max)
+{
+	const struct iwpaninfo_image_link *r;
+	const uint8_t *p;
+	uint32_t i, count, stride;
+
+	p = image_records(img, IWPANINFO_IMAGE_LINKS, sizeof(*r), &count, &stride);
+	if (!p && count)
+		return -1;
+
+	for (i = 0; i < count && i < max; i++)
+	{
+		r = (const struct iwpaninfo_image_link *)(p + i * stride);
+
+		memset(&links[i], 0, sizeof(links[i]));
+		memcpy(links[i].ifname, r->ifname, sizeof(links[i].ifname) - 1);
+		links[i].ifindex = le32toh(r->ifindex);
+		links[i].link = le32toh(r->link);
+		links[i].flags = le32toh(r->flags);
+		links[i].type = le32toh(r->type);
+		links[i].rx_packets = le64toh(r->rx_packets);
+		links[i].tx_packets = le64toh(r->tx_packets);
+		links[i].rx_bytes = le64toh(r->rx_bytes);
+		links[i].tx_bytes = le64toh(r->tx_bytes);
+		links[i].rx_errors = le64toh(r->rx_errors);
+		links[i].tx_errors = le64toh(r->tx_errors);
+		links[i].rx_dropped = le64toh(r->rx_dropped);
+		links[i].tx_dropped = le64toh(r->tx_dropped);
+	}
+
+	return i;
+}
+
+/* Copy a run of the VALUES section, clamped to the section and to max */
+static uint32_t image_get_values(const uint32_t *values, uint32_t num_values,
+                                 uint32_t start, uint32_t n,
+                                 void *dst, uint32_t max)
+{
+	uint32_t *d = dst;
+	uint32_t i;
+
+	if (start > num_values)
+		return 0;
+
+	if (n > num_values - start)
+		n = num_values - start;
+
+	if (n > max)
+		n = max;
+
+	for (i = 0; i < n; i++)
+		d[i] = le32toh(values[start + i]);
+
+	return n;
+}
+
+int iwpaninfo_image_caps(const struct iwpaninfo_image *img, int idx,
+                         char *phyname, struct iwpaninfo_phy_caps *caps)
+{
+	const struct iwpaninfo_image_phy *r;
+	const uint32_t *values;
+	const uint8_t *p;
+	uint32_t count, stride, num_values = 0, vstride;
+	int i;
+
+	p = image_records(img, IWPANINFO_IMAGE_PHYS, IWPANINFO_IMAGE_PHY_MIN,
+	                  &count, &stride);
+	if (!p || idx < 0 || idx >= count)
+		return -1;
+
+	values = iwpaninfo_image_section(img, IWPANINFO_IMAGE_VALUES,
+	                                 &num_values, &vstride);
+	if (!values || vstride != sizeof(*values))
+		num_values = 0;
+
+	r = (const struct iwpaninfo_image_phy *)(p + idx * stride);
+
+	memset(caps, 0, sizeof(*caps));
+	caps->iftypes = le32toh(r->iftypes);
+	caps->cca_modes = le32toh(r->cca_modes);
+	caps->cca_opts = le32toh(r->cca_opts);
+	caps->lbt = le32toh(r->lbt);
+	caps->commands[0] = le32toh(r->commands);
+
+	if (stride >= sizeof(*r))
+		for (i = 1; i < IWPANINFO_COMMAND_WORDS; i++)
+			caps->commands[i] = le32toh(r->commands_hi[i - 1]);
+	image_get_values(values, num_values, le32toh(r->channels),
+	                 le32toh(r->num_pages), caps->channels,
+	                 IWPANINFO_MAX_PAGES);
+	caps->num_txpowers =
+		image_get_values(values, num_values, le32toh(r->txpowers),
+		                 le32toh(r->num_txpowers), caps->txpowers,
+		                 IWPANINFO_MAX_TXPOWERS);
+	caps->num_cca_ed_levels =
+		image_get_values(values, num_values, le32toh(r->cca_ed_levels),
+		                 le32toh(r->num_cca_ed_levels), caps->cca_ed_levels,
+		                 IWPANINFO_MAX_CCA_ED_LEVELS);
+	caps->min_minbe = r->min_minbe;
+	caps->max_minbe = r->max_minbe;
+	caps->min_maxbe = r->min_maxbe;
+	caps->max_maxbe = r->max_maxbe;
+	caps->min_csma_backoffs = r->min_csma_backoffs;
+	caps->max_csma_backoffs = r->max_csma_backoffs;
+	caps->min_frame_retries = r->min_frame_retries;
+	caps->max_frame_retries = r->max_frame_retries;
+
+	if (phyname)
+	{
+		memcpy(phyname, r->phyname, sizeof(r->phyname) - 1);
+		phyname[sizeof(r->phyname) - 1] = 0;
+	}
+
+	return le32toh(r->phy);
+}
@@ -19,6 +19,8 @@
  * The framework of code is derived from the iwinfo library.
  */
 
+#include <pthread.h>
+
 #include "iwpaninfo.h"
 
 const char *IWPANINFO_OPMODE_NAMES[] = {
@@ -28,6 +30,28 @@ const char *IWPANINFO_OPMODE_NAMES[] = {
 	"Unknown",
 };
 
+const char *IWPANINFO_FIELD_NAMES[] = {
+	"ifindex",
+	"phy",
+	"wpan_dev",
+	"mode",
+	"page",
+	"channel",
+	"frequency",
+	"txpower",
+	"panid",
+	"short_address",
+	"extended_address",
+	"min_be",
+	"max_be",
+	"csma_backoff",
+	"frame_retry",
+	"lbt_mode",
+	"cca_mode",
+	"cca_opt",
+	"cca_ed_level",
+};
+
 static const struct iwpaninfo_ops *backends[] = {
 #ifdef USE_NL802154
 	&nl802154_ops,
@@ -65,12 +89,566 @@ const struct iwpaninfo_ops * iwpaninfo_backend_by_name(const char *name)
 	return NULL;
 }
 
-void iwpaninfo_finish(void)
+/*
+ * Resolve ifname once into a handle that carries the backend, ifindex and
+ * phy index, so that later dev_* calls can skip name resolution.
+ */
+int iwpaninfo_dev_open(const char *ifname, struct iwpaninfo_dev *dev)
+{
+	const struct iwpaninfo_ops *ops = iwpaninfo_backend(ifname);
+
+	memset(dev, 0, sizeof(*dev));
+
+	if (!ops || !ops->lookup)
+		return -1;
+
+	if (ops->lookup(ifname, dev))
+		return -1;
+
+	dev->ops = ops;
+	return 0;
+}
+
+/*
+ * Fetch only the fields in mask through a handle. Backends without a
+ * planned query answer with everything, which is masked down here.
+ */
+int iwpaninfo_dev_query(const struct iwpaninfo_dev *dev, uint32_t mask,
+                        struct iwpaninfo_info *info)
+{
+	int rv;
+
+	memset(info, 0, sizeof(*info));
+
+	if (!dev->ops)
+		return -1;
+
+	mask &= IWPANINFO_FIELD_ALL;
+
+	if (dev->ops->dev_query)
+		rv = dev->ops->dev_query(dev, mask, info);
+	else if (dev->ops->dev_info)
+		rv = dev->ops->dev_info(dev, info);
+	else
+		return -1;
+
+	info->valid &= mask;
+
+	return (!rv && info->valid) ? 0 : -1;
+}
+
+unsigned int iwpaninfo_abi_version(void)
+{
+	return IWPANINFO_ABI_VERSION;
+}
+
+/*
+ * Backend independent entry points with plain struct arguments, these are
+ * what the LuaJIT FFI binding calls into.
+ */
+static int backend_info(const char *ifname, struct iwpaninfo_info *info)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(backends); i++)
+		if (backends[i]->info && !backends[i]->info(ifname, info))
+			return 0;
+
+	return -1;
+}
+
+static int backend_caps(const char *ifname, struct iwpaninfo_phy_caps *caps)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(backends); i++)
+		if (backends[i]->caps && !backends[i]->caps(ifname, caps))
+			return 0;
+
+	return -1;
+}
+
+/*
+ * Returns the number of interfaces the backends reported, which may be
+ * more than the max that were copied. A backend dump buffer holds more
+ * than IWPANINFO_MAX_IFACES entries, so a cut at that size shows up here.
+ */
+static int backend_dump(struct iwpaninfo_info *info, int max)
+{
+	int i, len, n = 0, total = 0;
+	char buf[IWPANINFO_BUFSIZE];
+
+	for (i = 0; i < ARRAY_SIZE(backends); i++)
+	{
+		if (!backends[i]->dump || backends[i]->dump(buf, &len))
+			continue;
+
+		len /= sizeof(struct iwpaninfo_info);
+		total += len;
+
+		if (len > max - n)
+			len = max - n;
+
+		memcpy(&info[n], buf, len * sizeof(struct iwpaninfo_info));
+		n += len;
+	}
+
+	return total;
+}
+
+/*
+ * Backends that cannot plan a masked query answer it with a full one.
+ * A backend that fails leaves the query to the next, like the others.
+ */
+static int backend_query(const char *ifname, uint32_t mask,
+                         struct iwpaninfo_info *info)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(backends); i++)
+	{
+		if (backends[i]->query)
+		{
+			if (!backends[i]->query(ifname, mask, info))
+				return 0;
+		}
+		else if (backends[i]->info && !backends[i]->info(ifname, info))
+		{
+			info->valid &= mask;
+
+			if (info->valid)
+				return 0;
+		}
+	}
+
+	return -1;
+}
+
+
+/*
+ * Single-flight coalescing. Backends keep their netlink state per thread,
+ * so different queries run concurrently and flight_lock only guards the
+ * table of queries in flight. A query that arrives while an identical one
+ * is in flight waits for its result instead, so a burst of N readers
+ * costs one request instead of N.
+ */
+
+enum flight_cmd {
+	FLIGHT_INFO,
+	FLIGHT_CAPS,
+	FLIGHT_DUMP,
+	FLIGHT_QUERY,
+};
+
+#define FLIGHT_MAX_DUMP		IWPANINFO_MAX_IFACES
+
+struct flight {
+	struct flight *next;
+	enum flight_cmd cmd;
+	uint32_t mask;			/* FLIGHT_QUERY fields */
+	char key[64];
+	int waiters;
+	int done;
+	int rv;
+	pthread_cond_t cond;
+	void *res;			/* sized by flight_size(cmd) */
+};
+
+static pthread_mutex_t flight_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct flight *flights = NULL;
+
+/* set while this thread runs backend code, nested queries go straight in */
+static __thread int in_backend = 0;
+
+/* interfaces found by the last dump of this thread, filled or not */
+static __thread int dump_total = 0;
+
+static int flight_exec(enum flight_cmd cmd, const char *key, uint32_t mask,
+                       void *out, int max)
+{
+	switch (cmd)
+	{
+	case FLIGHT_INFO:
+		return backend_info(key, out);
+	case FLIGHT_QUERY:
+		return backend_query(key, mask, out);
+	case FLIGHT_CAPS:
+		return backend_caps(key, out);
+	case FLIGHT_DUMP:
+		return backend_dump(out, max);
+	}
+
+	return -1;
+}
+
+/*
+ * A query issued from backend code must not wait for a flight, it may be
+ * the one its own thread started.
+ */
+static int flight_run(enum flight_cmd cmd, const char *key, uint32_t mask,
+                      void *out, int max)
+{
+	int rv;
+
+	in_backend = 1;
+	rv = flight_exec(cmd, key, mask, out, max);
+	in_backend = 0;
+
+	return rv;
+}
+
+static size_t flight_size(enum flight_cmd cmd)
+{
+	switch (cmd)
+	{
+	case FLIGHT_INFO:
+	case FLIGHT_QUERY:
+		return sizeof(struct iwpaninfo_info);
+	case FLIGHT_CAPS:
+		return sizeof(struct iwpaninfo_phy_caps);
+	case FLIGHT_DUMP:
+		return FLIGHT_MAX_DUMP * sizeof(struct iwpaninfo_info);
+	}
+
+	return 0;
+}
+
+static int flight_copy(struct flight *f, void *out, int max)
+{
+	switch (f->cmd)
+	{
+	case FLIGHT_INFO:
+	case FLIGHT_CAPS:
+	case FLIGHT_QUERY:
+		if (!f->rv)
+			memcpy(out, f->res, flight_size(f->cmd));
+		return f->rv;
+
+	case FLIGHT_DUMP:
+		if (f->rv < max)
+			max = f->rv;
+		if (max > 0)
+			memcpy(out, f->res, max * sizeof(struct iwpaninfo_info));
+		return f->rv;
+	}
+
+	return -1;
+}
+
+static int flight_query(enum flight_cmd cmd, const char *key, uint32_t mask,
+                        void *out, int max)
+{
+	struct flight *f, **pp;
+	int rv;
+
+	if (in_backend)
+		return flight_exec(cmd, key, mask, out, max);
+
+	/* a larger dump than a flight can carry is not shared */
+	if ((cmd == FLIGHT_DUMP && max > FLIGHT_MAX_DUMP) ||
+	    strlen(key) >= sizeof(f->key))
+		return flight_run(cmd, key, mask, out, max);
+
+	pthread_mutex_lock(&flight_lock);
+
+	for (f = flights; f; f = f->next)
+		if (f->cmd == cmd && f->mask == mask &&
+		    !strncmp(f->key, key, sizeof(f->key)))
+			break;
+
+	if (f)
+	{
+		f->waiters++;
+
+		while (!f->done)
+			pthread_cond_wait(&f->cond, &flight_lock);
+	}
+	else
+	{
+		/* the result lives right behind the flight, aligned like it */
+		f = calloc(1, sizeof(*f) + flight_size(cmd));
+		if (!f)
+		{
+			pthread_mutex_unlock(&flight_lock);
+			return flight_run(cmd, key, mask, out, max);
+		}
+
+		f->res = f + 1;
+		f->cmd = cmd;
+		f->mask = mask;
+		f->waiters = 1;
+		strncpy(f->key, key, sizeof(f->key) - 1);
+		pthread_cond_init(&f->cond, NULL);
+
+		f->next = flights;
+		flights = f;
+
+		pthread_mutex_unlock(&flight_lock);
+
+		f->rv = flight_run(cmd, key, mask, f->res,
+		                   (cmd == FLIGHT_DUMP) ? FLIGHT_MAX_DUMP : 1);
+
+		pthread_mutex_lock(&flight_lock);
+
+		/* later callers must start a new query, not reuse this result */
+		for (pp = &flights; *pp != f; pp = &(*pp)->next);
+		*pp = f->next;
+
+		f->done = 1;
+		pthread_cond_broadcast(&f->cond);
+	}
+
+	rv = flight_copy(f, out, max);
+
+	if (--f->waiters == 0)
+	{
+		pthread_cond_destroy(&f->cond);
+		free(f);
+	}
+
+	pthread_mutex_unlock(&flight_lock);
+
+	return rv;
+}
+
+/* Query the backends directly, bypassing the shared memory snapshot */
+int iwpaninfo_get_info_live(const char *ifname, struct iwpaninfo_info *info)
+{
+	return flight_query(FLIGHT_INFO, ifname, 0, info, 1);
+}
+
+int iwpaninfo_get_caps(const char *ifname, struct iwpaninfo_phy_caps *caps)
+{
+	return flight_query(FLIGHT_CAPS, ifname, 0, caps, 1);
+}
+
+/*
+ * Bitmap of the nl802154 commands the phy behind ifname supports, served
+ * from the backend cache so callers can skip requests doomed to fail.
+ */
+int iwpaninfo_get_commands(const char *ifname,
+                           uint32_t commands[IWPANINFO_COMMAND_WORDS])
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(backends); i++)
+		if (backends[i]->commands && !backends[i]->commands(ifname, commands))
+			return 0;
+
+	return -1;
+}
+
+/* 1 if cmd is supported, 0 if not and -1 if the phy cannot tell */
+int iwpaninfo_cmd_supported(const char *ifname, int cmd)
+{
+	uint32_t commands[IWPANINFO_COMMAND_WORDS];
+
+	if (cmd < 0 || cmd >= IWPANINFO_MAX_COMMANDS ||
+	    iwpaninfo_get_commands(ifname, commands) ||
+	    iwpaninfo_commands_empty(commands))
+		return -1;
+
+	return iwpaninfo_command_isset(commands, cmd);
+}
+
+int iwpaninfo_get_dump_live(struct iwpaninfo_info *info, int max)
+{
+	int n = flight_query(FLIGHT_DUMP, "", 0, info, max);
+
+	dump_total = (n > 0) ? n : 0;
+
+	return (n > max) ? max : n;
+}
+
+/*
+ * Number of interfaces seen by the last dump of the calling thread, more
+ * than it returned when the caller's array was too small.
+ */
+int iwpaninfo_dump_total(void)
+{
+	return dump_total;
+}
+
+/*
+ * Fetch only the fields in mask, backends that can plan their requests
+ * skip the exchanges none of those fields come from. Always live.
+ */
+int iwpaninfo_query(const char *ifname, uint32_t mask,
+                    struct iwpaninfo_info *info)
+{
+	mask &= IWPANINFO_FIELD_ALL;
+
+	if (mask == IWPANINFO_FIELD_ALL)
+		return iwpaninfo_get_info_live(ifname, info);
+
+	return flight_query(FLIGHT_QUERY, ifname, mask, info, 1);
+}
+
+/*
+ * Fixed point lists derived from the phy capabilities, each returns the
+ * number of entries filled or -1. The float lists of the ops table stay
+ * for existing users.
+ */
+int iwpaninfo_get_txpwrlist(const char *ifname,
+                            struct iwpaninfo_txpwrlist_entry_mbm *e, int max)
+{
+	struct iwpaninfo_phy_caps caps;
+	int i;
+
+	if (iwpaninfo_get_caps(ifname, &caps))
+		return -1;
+
+	for (i = 0; i < caps.num_txpowers && i < max; i++)
+	{
+		e[i].mbm = caps.txpowers[i];
+		e[i].uw = iwpaninfo_mbm2uw(caps.txpowers[i]);
+	}
+
+	return i;
+}
+
+int iwpaninfo_get_cca_ed_lvl_list(const char *ifname,
+                                  struct iwpaninfo_cca_ed_lvl_list_entry_mbm *e,
+                                  int max)
+{
+	struct iwpaninfo_phy_caps caps;
+	int i;
+
+	if (iwpaninfo_get_caps(ifname, &caps))
+		return -1;
+
+	for (i = 0; i < caps.num_cca_ed_levels && i < max; i++)
+		e[i].mbm = caps.cca_ed_levels[i];
+
+	return i;
+}
+
+int iwpaninfo_get_freqlist(const char *ifname,
+                           struct iwpaninfo_freqlist_entry_khz *e, int max)
+{
+	struct iwpaninfo_phy_caps caps;
+	int page, ch, n = 0;
+
+	if (iwpaninfo_get_caps(ifname, &caps))
+		return -1;
+
+	for (page = 0; page < IWPANINFO_MAX_PAGES; page++)
+	{
+		for (ch = 0; ch < 32 && n < max; ch++)
+		{
+			if (!(caps.channels[page] & (1U << ch)))
+				continue;
+
+			e[n].page = page;
+			e[n].channel = ch;
+			e[n].khz = iwpaninfo_channel2khz(page, ch);
+			n++;
+		}
+	}
+
+	return n;
+}
+
+/* Prefer a fresh shared memory snapshot and fall back to the backends */
+int iwpaninfo_get_info(const char *ifname, struct iwpaninfo_info *info)
+{
+	if (!iwpaninfo_shm_get_info(ifname, info))
+		return 0;
+
+	return iwpaninfo_get_info_live(ifname, info);
+}
+
+/* Fill up to max snapshots of all interfaces, returns the number filled */
+int iwpaninfo_get_dump(struct iwpaninfo_info *info, int max)
+{
+	int n = iwpaninfo_shm_read(info, max);
+
+	if (n >= 0)
+	{
+		dump_total = n;
+		return (n > max) ? max : n;
+	}
+
+	return iwpaninfo_get_dump_live(info, max);
+}
+
+/* Release the calling thread's backend contexts, process state is kept */
+void iwpaninfo_thread_finish(void)
 {
 	int i;
 
 	for (i = 0; i < ARRAY_SIZE(backends); i++)
 		backends[i]->close();
 
+	iwpaninfo_shm_detach();
+	iwpaninfo_rtnl_close();
+}
+
+void iwpaninfo_finish(void)
+{
+	iwpaninfo_thread_finish();
 	iwpaninfo_close();
 }
+
+static int iwpaninfo_info_field_eq(const struct iwpaninfo_info *a,
+                                   const struct iwpaninfo_info *b,
+                                   uint32_t field)
+{
+	switch (field)
+	{
+	case IWPANINFO_FIELD_IFINDEX:
+		return a->ifindex == b->ifindex;
+	case IWPANINFO_FIELD_PHY:
+		return a->phy == b->phy && !strcmp(a->phyname, b->phyname);
+	case IWPANINFO_FIELD_WPAN_DEV:
+		return a->wpan_dev == b->wpan_dev;
+	case IWPANINFO_FIELD_MODE:
+		return a->mode == b->mode;
+	case IWPANINFO_FIELD_PAGE:
+		return a->page == b->page;
+	case IWPANINFO_FIELD_CHANNEL:
+		return a->channel == b->channel;
+	case IWPANINFO_FIELD_FREQUENCY:
+		return a->frequency == b->frequency;
+	case IWPANINFO_FIELD_TXPOWER:
+		return a->txpower == b->txpower;
+	case IWPANINFO_FIELD_PANID:
+		return a->panid == b->panid;
+	case IWPANINFO_FIELD_SHORT_ADDR:
+		return a->short_address == b->short_address;
+	case IWPANINFO_FIELD_EXTENDED_ADDR:
+		return a->extended_address == b->extended_address;
+	case IWPANINFO_FIELD_MIN_BE:
+		return a->min_be == b->min_be;
+	case IWPANINFO_FIELD_MAX_BE:
+		return a->max_be == b->max_be;
+	case IWPANINFO_FIELD_CSMA_BACKOFF:
+		return a->csma_backoff == b->csma_backoff;
+	case IWPANINFO_FIELD_FRAME_RETRY:
+		return a->frame_retry == b->frame_retry;
+	case IWPANINFO_FIELD_LBT_MODE:
+		return a->lbt_mode == b->lbt_mode;
+	case IWPANINFO_FIELD_CCA_MODE:
+		return a->cca_mode == b->cca_mode;
+	case IWPANINFO_FIELD_CCA_OPT:
+		return a->cca_opt == b->cca_opt;
+	case IWPANINFO_FIELD_CCA_ED_LEVEL:
+		return a->cca_ed_level == b->cca_ed_level;
+	}
+
+	return 1;
+}
+
+/* Return the fields whose value or availability differs between a and b */
+uint32_t iwpaninfo_info_changed(const struct iwpaninfo_info *a,
+                                const struct iwpaninfo_info *b)
+{
+	uint32_t field, changed = a->valid ^ b->valid;
+	uint32_t both = a->valid & b->valid;
+
+	for (field = 1; field & IWPANINFO_FIELD_ALL; field <<= 1)
+		if ((both & field) && !iwpaninfo_info_field_eq(a, b, field))
+			changed |= field;
+
+	return changed;
+}
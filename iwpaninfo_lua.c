@@ -82,6 +82,12 @@ static int iwinfo_L_txpwrlist(lua_State *L, int (*func)(const char *, char *, in
 			lua_pushnumber(L, e->dbm);
 			lua_setfield(L, -2, "dbm");
 
+			lua_pushinteger(L, e->mbm);
+			lua_setfield(L, -2, "mbm");
+
+			lua_pushinteger(L, e->uw);
+			lua_setfield(L, -2, "uw");
+
 			lua_rawseti(L, -2, x);
 		}
 
@@ -114,6 +120,9 @@ static int iwinfo_L_cca_ed_lvl_list(lua_State *L, int (*func)(const char *, char
 			lua_pushnumber(L, e->dbm);
 			lua_setfield(L, -2, "dbm");
 
+			lua_pushinteger(L, e->mbm);
+			lua_setfield(L, -2, "mbm");
+
 			lua_rawseti(L, -2, x);
 		}
 
@@ -146,6 +155,9 @@ static int iwinfo_L_freqlist(lua_State *L,
 			lua_pushnumber(L, e->mhz);
 			lua_setfield(L, -2, "mhz");
 
+			lua_pushinteger(L, e->khz);
+			lua_setfield(L, -2, "khz");
+
 			/* Channel */
 			lua_pushinteger(L, e->channel);
 			lua_setfield(L, -2, "channel");
@@ -157,6 +169,530 @@ static int iwinfo_L_freqlist(lua_State *L,
 	return 1;
 }
 
+/* Push a single snapshot field, returns 0 if it is not available */
+static int iwinfo_L_push_field(lua_State *L, const struct iwpaninfo_info *info,
+		uint32_t field)
+{
+	if (!(info->valid & field))
+		return 0;
+
+	switch (field)
+	{
+	case IWPANINFO_FIELD_IFINDEX:
+		lua_pushinteger(L, info->ifindex);
+		break;
+	case IWPANINFO_FIELD_PHY:
+		lua_pushstring(L, info->phyname);
+		break;
+	case IWPANINFO_FIELD_WPAN_DEV:
+		lua_pushnumber(L, info->wpan_dev);
+		break;
+	case IWPANINFO_FIELD_MODE:
+		lua_pushstring(L, IWPANINFO_OPMODE_NAMES[info->mode]);
+		break;
+	case IWPANINFO_FIELD_PAGE:
+		lua_pushinteger(L, info->page);
+		break;
+	case IWPANINFO_FIELD_CHANNEL:
+		lua_pushinteger(L, info->channel);
+		break;
+	case IWPANINFO_FIELD_FREQUENCY:
+		lua_pushnumber(L, info->frequency / 1000.0);
+		break;
+	case IWPANINFO_FIELD_TXPOWER:
+		lua_pushinteger(L, info->txpower);
+		break;
+	case IWPANINFO_FIELD_PANID:
+		lua_pushinteger(L, info->panid);
+		break;
+	case IWPANINFO_FIELD_SHORT_ADDR:
+		lua_pushinteger(L, info->short_address);
+		break;
+	case IWPANINFO_FIELD_EXTENDED_ADDR:
+		lua_pushnumber(L, info->extended_address);
+		break;
+	case IWPANINFO_FIELD_MIN_BE:
+		lua_pushinteger(L, info->min_be);
+		break;
+	case IWPANINFO_FIELD_MAX_BE:
+		lua_pushinteger(L, info->max_be);
+		break;
+	case IWPANINFO_FIELD_CSMA_BACKOFF:
+		lua_pushinteger(L, info->csma_backoff);
+		break;
+	case IWPANINFO_FIELD_FRAME_RETRY:
+		lua_pushinteger(L, info->frame_retry);
+		break;
+	case IWPANINFO_FIELD_LBT_MODE:
+		lua_pushboolean(L, info->lbt_mode);
+		break;
+	case IWPANINFO_FIELD_CCA_MODE:
+		lua_pushinteger(L, info->cca_mode);
+		break;
+	case IWPANINFO_FIELD_CCA_OPT:
+		lua_pushinteger(L, info->cca_opt);
+		break;
+	case IWPANINFO_FIELD_CCA_ED_LEVEL:
+		lua_pushinteger(L, info->cca_ed_level);
+		break;
+	default:
+		return 0;
+	}
+
+	return 1;
+}
+
+/* Push one info snapshot as a table, unavailable fields are left out */
+static void iwinfo_L_push_info(lua_State *L, const struct iwpaninfo_info *info)
+{
+	uint32_t field;
+
+	lua_newtable(L);
+
+	if (info->ifname[0])
+	{
+		lua_pushstring(L, info->ifname);
+		lua_setfield(L, -2, "ifname");
+	}
+
+	for (field = 1; field & IWPANINFO_FIELD_ALL; field <<= 1)
+		if (iwinfo_L_push_field(L, info, field))
+			lua_setfield(L, -2, IWPANINFO_FIELD_NAMES[__builtin_ctz(field)]);
+}
+
+/* Push the set bits of a bitmap as a list of numbers */
+static void iwinfo_L_push_bitmap(lua_State *L, uint32_t bitmap)
+{
+	int i, x;
+
+	lua_newtable(L);
+
+	for (i = 0, x = 1; i < 32; i++)
+	{
+		if (bitmap & (1U << i))
+		{
+			lua_pushinteger(L, i);
+			lua_rawseti(L, -2, x++);
+		}
+	}
+}
+
+static void iwinfo_L_push_caps(lua_State *L, const struct iwpaninfo_phy_caps *caps)
+{
+	int i;
+
+	lua_newtable(L);
+
+	/* channels, keyed by page */
+	lua_newtable(L);
+	for (i = 0; i < IWPANINFO_MAX_PAGES; i++)
+	{
+		if (!caps->channels[i])
+			continue;
+
+		iwinfo_L_push_bitmap(L, caps->channels[i]);
+		lua_rawseti(L, -2, i);
+	}
+	lua_setfield(L, -2, "channels");
+
+	/* tx powers in mBm */
+	lua_newtable(L);
+	for (i = 0; i < caps->num_txpowers; i++)
+	{
+		lua_pushinteger(L, caps->txpowers[i]);
+		lua_rawseti(L, -2, i + 1);
+	}
+	lua_setfield(L, -2, "txpowers");
+
+	/* CCA ED levels in mBm */
+	lua_newtable(L);
+	for (i = 0; i < caps->num_cca_ed_levels; i++)
+	{
+		lua_pushinteger(L, caps->cca_ed_levels[i]);
+		lua_rawseti(L, -2, i + 1);
+	}
+	lua_setfield(L, -2, "cca_ed_levels");
+
+	iwinfo_L_push_bitmap(L, caps->iftypes);
+	lua_setfield(L, -2, "iftypes");
+
+	iwinfo_L_push_bitmap(L, caps->cca_modes);
+	lua_setfield(L, -2, "cca_modes");
+
+	iwinfo_L_push_bitmap(L, caps->cca_opts);
+	lua_setfield(L, -2, "cca_opts");
+
+	lua_pushinteger(L, caps->lbt);
+	lua_setfield(L, -2, "lbt");
+
+	lua_pushinteger(L, caps->min_minbe);
+	lua_setfield(L, -2, "min_minbe");
+
+	lua_pushinteger(L, caps->max_minbe);
+	lua_setfield(L, -2, "max_minbe");
+
+	lua_pushinteger(L, caps->min_maxbe);
+	lua_setfield(L, -2, "min_maxbe");
+
+	lua_pushinteger(L, caps->max_maxbe);
+	lua_setfield(L, -2, "max_maxbe");
+
+	lua_pushinteger(L, caps->min_csma_backoffs);
+	lua_setfield(L, -2, "min_csma_backoffs");
+
+	lua_pushinteger(L, caps->max_csma_backoffs);
+	lua_setfield(L, -2, "max_csma_backoffs");
+
+	lua_pushinteger(L, caps->min_frame_retries);
+	lua_setfield(L, -2, "min_frame_retries");
+
+	lua_pushinteger(L, caps->max_frame_retries);
+	lua_setfield(L, -2, "max_frame_retries");
+}
+
+/* Wrapper for phy capabilities */
+static int iwinfo_L_caps(lua_State *L,
+		int (*func)(const char *, struct iwpaninfo_phy_caps *))
+{
+	struct iwpaninfo_phy_caps caps;
+	const char *ifname = luaL_checkstring(L, 1);
+
+	if ((*func)(ifname, &caps))
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	iwinfo_L_push_caps(L, &caps);
+	return 1;
+}
+
+/* Wrapper for the combined info snapshot */
+static int iwinfo_L_info(lua_State *L,
+		int (*func)(const char *, struct iwpaninfo_info *))
+{
+	struct iwpaninfo_info info;
+	const char *ifname = luaL_checkstring(L, 1);
+
+	if (iwpaninfo_shm_get_info(ifname, &info) && (*func)(ifname, &info))
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	iwinfo_L_push_info(L, &info);
+	return 1;
+}
+
+/* Wrapper for the info snapshot of all interfaces, keyed by ifname */
+static int iwinfo_L_dump(lua_State *L, int (*func)(char *, int *))
+{
+	int i, len;
+	char rv[IWPANINFO_BUFSIZE];
+	struct iwpaninfo_info *e;
+
+	lua_newtable(L);
+
+	len = iwpaninfo_shm_read((struct iwpaninfo_info *)rv,
+	                         sizeof(rv) / sizeof(struct iwpaninfo_info));
+
+	if (len > (int)(sizeof(rv) / sizeof(struct iwpaninfo_info)))
+		len = sizeof(rv) / sizeof(struct iwpaninfo_info);
+
+	if (len >= 0)
+		len *= sizeof(struct iwpaninfo_info);
+
+	if (len >= 0 || !(*func)(rv, &len))
+	{
+		for (i = 0; i < len; i += sizeof(struct iwpaninfo_info))
+		{
+			e = (struct iwpaninfo_info *) &rv[i];
+
+			iwinfo_L_push_info(L, e);
+			lua_setfield(L, -2, e->ifname);
+		}
+	}
+
+	return 1;
+}
+
+/* Lazily decoded snapshots */
+static int iwinfo_L_snapshot(lua_State *L, const struct iwpaninfo_ops *ops)
+{
+	int len;
+	char rv[IWPANINFO_BUFSIZE];
+	const char *ifname = luaL_checkstring(L, 1);
+	struct iwpaninfo_L_snapshot *s;
+
+	if (!ops->raw || !ops->decode || ops->raw(ifname, rv, &len))
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	s = lua_newuserdata(L, sizeof(*s) + len);
+	memset(s, 0, sizeof(*s));
+
+	s->ops = ops;
+	s->len = len;
+	strncpy(s->info.ifname, ifname, sizeof(s->info.ifname) - 1);
+	memcpy(s->raw, rv, len);
+
+	luaL_getmetatable(L, IWPANINFO_SNAPSHOT_META);
+	lua_setmetatable(L, -2);
+
+	return 1;
+}
+
+/* __index, upvalue 1 maps field names to IWPANINFO_FIELD_* bits */
+static int iwpaninfo_L_snapshot__index(lua_State *L)
+{
+	uint32_t field;
+	struct iwpaninfo_L_snapshot *s =
+		luaL_checkudata(L, 1, IWPANINFO_SNAPSHOT_META);
+
+	lua_pushvalue(L, 2);
+	lua_rawget(L, lua_upvalueindex(1));
+	field = lua_tointeger(L, -1);
+	lua_pop(L, 1);
+
+	if (!field)
+	{
+		if (lua_isstring(L, 2) && !strcmp(lua_tostring(L, 2), "ifname"))
+			lua_pushstring(L, s->info.ifname);
+		else
+			lua_pushnil(L);
+
+		return 1;
+	}
+
+	if (!(s->decoded & field))
+	{
+		s->ops->decode(s->raw, s->len, field, &s->info);
+		s->decoded |= field;
+	}
+
+	if (!iwinfo_L_push_field(L, &s->info, field))
+		lua_pushnil(L);
+
+	return 1;
+}
+
+/* Device handles */
+static struct iwpaninfo_L_dev * iwpaninfo_L_checkdev(lua_State *L)
+{
+	return luaL_checkudata(L, 1, IWPANINFO_DEVICE_META);
+}
+
+static int iwpaninfo_L_open(lua_State *L)
+{
+	const char *ifname = luaL_checkstring(L, 1);
+	struct iwpaninfo_L_dev *d = lua_newuserdata(L, sizeof(*d));
+
+	memset(d, 0, sizeof(*d));
+
+	if (iwpaninfo_dev_open(ifname, &d->dev) || !d->dev.ops->dev_info)
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	luaL_getmetatable(L, IWPANINFO_DEVICE_META);
+	lua_setmetatable(L, -2);
+
+	return 1;
+}
+
+#ifdef USE_NL802154
+/*
+ * Single field getters only ask the backend for the attributes they need,
+ * through the handle like dev:info() so renames do not break them.
+ */
+static int iwpaninfo_L_dev_field(lua_State *L, uint32_t field)
+{
+	struct iwpaninfo_info info;
+	struct iwpaninfo_L_dev *d = iwpaninfo_L_checkdev(L);
+
+	if (iwpaninfo_dev_query(&d->dev, field, &info) ||
+	    !iwinfo_L_push_field(L, &info, field))
+		lua_pushnil(L);
+
+	return 1;
+}
+#endif
+
+static int iwpaninfo_L_dev_info(lua_State *L)
+{
+	struct iwpaninfo_info info;
+	struct iwpaninfo_L_dev *d = iwpaninfo_L_checkdev(L);
+
+	if (d->dev.ops->dev_info(&d->dev, &info))
+		lua_pushnil(L);
+	else
+		iwinfo_L_push_info(L, &info);
+
+	return 1;
+}
+
+/* Capabilities do not change at runtime and are cached in the handle */
+static int iwpaninfo_L_dev_caps(lua_State *L)
+{
+	struct iwpaninfo_L_dev *d = iwpaninfo_L_checkdev(L);
+
+	if (!d->caps)
+	{
+		if (!d->dev.ops->dev_caps)
+			goto fail;
+
+		d->caps = malloc(sizeof(*d->caps));
+		if (!d->caps)
+			goto fail;
+
+		if (d->dev.ops->dev_caps(&d->dev, d->caps))
+		{
+			free(d->caps);
+			d->caps = NULL;
+			goto fail;
+		}
+	}
+
+	iwinfo_L_push_caps(L, d->caps);
+	return 1;
+
+fail:
+	lua_pushnil(L);
+	return 1;
+}
+
+/* Hand the result to the waiting coroutine and release the request */
+static void iwpaninfo_L_async_finish(struct iwpaninfo_L_async *a, int ok)
+{
+	lua_State *co = a->co;
+	int ref = a->ref, nres = 1;
+	int timed_out = !a->timeout.pending;
+
+	uloop_fd_delete(&a->fd);
+	uloop_timeout_cancel(&a->timeout);
+
+	if (ok)
+	{
+		iwinfo_L_push_info(co, &a->req.info);
+	}
+	else
+	{
+		lua_pushnil(co);
+		lua_pushstring(co, timed_out ? "timeout" : "error");
+		nres = 2;
+	}
+
+	a->ops->async_free(&a->req);
+	free(a);
+
+	if (lua_resume(co, nres) > LUA_YIELD)
+	{
+		fprintf(stderr, "iwpaninfo: %s\n", lua_tostring(co, -1));
+		lua_pop(co, 1);
+	}
+
+	/* the registry reference kept the coroutine alive while it waited */
+	luaL_unref(co, LUA_REGISTRYINDEX, ref);
+}
+
+static void iwpaninfo_L_async_fd_cb(struct uloop_fd *fd, unsigned int events)
+{
+	struct iwpaninfo_L_async *a = container_of(fd, struct iwpaninfo_L_async, fd);
+	int rv = a->ops->async_poll(&a->req);
+
+	if (rv)
+		iwpaninfo_L_async_finish(a, rv > 0);
+}
+
+static void iwpaninfo_L_async_timeout_cb(struct uloop_timeout *t)
+{
+	struct iwpaninfo_L_async *a = container_of(t, struct iwpaninfo_L_async, timeout);
+
+	iwpaninfo_L_async_finish(a, 0);
+}
+
+/*
+ * Non-blocking variant of info(), must be called from a coroutine which
+ * is resumed from uloop with the info table, or nil and an error string.
+ */
+static int iwpaninfo_L_dev_info_async(lua_State *L)
+{
+	struct iwpaninfo_L_dev *d = iwpaninfo_L_checkdev(L);
+	struct iwpaninfo_L_async *a;
+
+	if (lua_pushthread(L))
+		return luaL_error(L, "info_async() must be called from a coroutine");
+
+	if (!d->dev.ops->async_start)
+		return luaL_error(L, "backend does not support async requests");
+
+	a = calloc(1, sizeof(*a));
+	if (!a)
+		return luaL_error(L, "out of memory");
+
+	if (d->dev.ops->async_start(&d->dev, &a->req))
+	{
+		free(a);
+		lua_pushnil(L);
+		lua_pushstring(L, "error");
+		return 2;
+	}
+
+	a->ops = d->dev.ops;
+	a->co = L;
+	a->ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	a->fd.fd = a->req.fd;
+	a->fd.cb = iwpaninfo_L_async_fd_cb;
+	uloop_fd_add(&a->fd, ULOOP_READ);
+
+	a->timeout.cb = iwpaninfo_L_async_timeout_cb;
+	uloop_timeout_set(&a->timeout, IWPANINFO_ASYNC_TIMEOUT);
+
+	return lua_yield(L, 0);
+}
+
+static int iwpaninfo_L_dev_ifname(lua_State *L)
+{
+	struct iwpaninfo_L_dev *d = iwpaninfo_L_checkdev(L);
+
+	lua_pushstring(L, d->dev.ifname);
+	return 1;
+}
+
+static int iwpaninfo_L_dev__gc(lua_State *L)
+{
+	struct iwpaninfo_L_dev *d = iwpaninfo_L_checkdev(L);
+
+	free(d->caps);
+	d->caps = NULL;
+
+	return 0;
+}
+
+#ifdef USE_NL802154
+LUA_WRAP_DEV_FIELD(channel, IWPANINFO_FIELD_CHANNEL)
+LUA_WRAP_DEV_FIELD(page, IWPANINFO_FIELD_PAGE)
+LUA_WRAP_DEV_FIELD(frequency, IWPANINFO_FIELD_FREQUENCY)
+LUA_WRAP_DEV_FIELD(txpower, IWPANINFO_FIELD_TXPOWER)
+LUA_WRAP_DEV_FIELD(mode, IWPANINFO_FIELD_MODE)
+LUA_WRAP_DEV_FIELD(phyname, IWPANINFO_FIELD_PHY)
+LUA_WRAP_DEV_FIELD(panid, IWPANINFO_FIELD_PANID)
+LUA_WRAP_DEV_FIELD(short_address, IWPANINFO_FIELD_SHORT_ADDR)
+LUA_WRAP_DEV_FIELD(extended_address, IWPANINFO_FIELD_EXTENDED_ADDR)
+LUA_WRAP_DEV_FIELD(min_be, IWPANINFO_FIELD_MIN_BE)
+LUA_WRAP_DEV_FIELD(max_be, IWPANINFO_FIELD_MAX_BE)
+LUA_WRAP_DEV_FIELD(csma_backoff, IWPANINFO_FIELD_CSMA_BACKOFF)
+LUA_WRAP_DEV_FIELD(frame_retry, IWPANINFO_FIELD_FRAME_RETRY)
+LUA_WRAP_DEV_FIELD(lbt_mode, IWPANINFO_FIELD_LBT_MODE)
+LUA_WRAP_DEV_FIELD(cca_mode, IWPANINFO_FIELD_CCA_MODE)
+LUA_WRAP_DEV_FIELD(cca_opt, IWPANINFO_FIELD_CCA_OPT)
+LUA_WRAP_DEV_FIELD(cca_ed_level, IWPANINFO_FIELD_CCA_ED_LEVEL)
+#endif
+
 #ifdef USE_NL802154
 /* NL802154 */
 LUA_WRAP_INT_OP(nl802154, channel)
@@ -178,6 +714,14 @@ LUA_WRAP_INT_OP(nl802154, frame_retry)
 LUA_WRAP_INT_OP(nl802154, lbt_mode)
 LUA_WRAP_INT_OP(nl802154, cca_mode)
 LUA_WRAP_INT_OP(nl802154, cca_opt)
+LUA_WRAP_STRUCT_OP(nl802154, info)
+LUA_WRAP_STRUCT_OP(nl802154, dump)
+LUA_WRAP_STRUCT_OP(nl802154, caps)
+
+static int iwinfo_L_nl802154_snapshot(lua_State *L)
+{
+	return iwinfo_L_snapshot(L, &nl802154_ops);
+}
 #endif
 
 #ifdef USE_NL802154
@@ -202,10 +746,43 @@ static const luaL_reg R_nl802154[] = {
 	LUA_REG(nl802154, lbt_mode),
 	LUA_REG(nl802154, cca_mode),
 	LUA_REG(nl802154, cca_opt),
+	LUA_REG(nl802154, info),
+	LUA_REG(nl802154, caps),
+	LUA_REG(nl802154, snapshot),
+	{ "all", iwinfo_L_nl802154_dump },
 	{ NULL, NULL }
 };
 #endif
 
+/* Device handle methods */
+static const luaL_reg R_device[] = {
+#ifdef USE_NL802154
+	LUA_REG_DEV(channel),
+	LUA_REG_DEV(page),
+	LUA_REG_DEV(frequency),
+	LUA_REG_DEV(txpower),
+	LUA_REG_DEV(mode),
+	LUA_REG_DEV(phyname),
+	LUA_REG_DEV(panid),
+	LUA_REG_DEV(short_address),
+	LUA_REG_DEV(extended_address),
+	LUA_REG_DEV(min_be),
+	LUA_REG_DEV(max_be),
+	LUA_REG_DEV(csma_backoff),
+	LUA_REG_DEV(frame_retry),
+	LUA_REG_DEV(lbt_mode),
+	LUA_REG_DEV(cca_mode),
+	LUA_REG_DEV(cca_opt),
+	LUA_REG_DEV(cca_ed_level),
+#endif
+	LUA_REG_DEV(info),
+	LUA_REG_DEV(info_async),
+	LUA_REG_DEV(caps),
+	LUA_REG_DEV(ifname),
+	{ "__gc", iwpaninfo_L_dev__gc },
+	{ NULL, NULL }
+};
+
 /* Common */
 static const luaL_reg R_common[] = {
 	{ "type", iwpaninfo_L_type },
@@ -215,8 +792,30 @@ static const luaL_reg R_common[] = {
 
 
 LUALIB_API int luaopen_iwpaninfo(lua_State *L) {
+	int i;
+
 	luaL_register(L, IWPANINFO_META, R_common);
 
+	luaL_newmetatable(L, IWPANINFO_DEVICE_META);
+	luaL_register(L, NULL, R_device);
+	lua_pushvalue(L, -1);
+	lua_setfield(L, -2, "__index");
+	lua_pop(L, 1);
+
+	luaL_newmetatable(L, IWPANINFO_SNAPSHOT_META);
+	lua_newtable(L);
+	for (i = 0; i < IWPANINFO_FIELD_COUNT; i++)
+	{
+		lua_pushinteger(L, 1 << i);
+		lua_setfield(L, -2, IWPANINFO_FIELD_NAMES[i]);
+	}
+	lua_pushcclosure(L, iwpaninfo_L_snapshot__index, 1);
+	lua_setfield(L, -2, "__index");
+	lua_pop(L, 1);
+
+	lua_pushcfunction(L, iwpaninfo_L_open);
+	lua_setfield(L, -2, "open");
+
 #ifdef USE_NL802154
 	luaL_newmetatable(L, IWPANINFO_NL802154_META);
 	luaL_register(L, NULL, R_common);
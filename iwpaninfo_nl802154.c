@@ -24,6 +24,8 @@
 #include <fnmatch.h>
 #include <stdarg.h>
 #include <limits.h>
+#include <pthread.h>
+#include <linux/rtnetlink.h>
 
 #include "iwpaninfo_nl802154.h"
 #include "nl_extras.h"
@@ -32,12 +34,67 @@
 
 #define BIT(x) (1ULL<<(x))
 
-static struct nl802154_state *nls = NULL;
+/* per thread, so worker threads each get their own netlink context */
+static __thread struct nl802154_state *nls = NULL;
+
+/* per process, the kernel does not change under a running binary */
+static struct nl802154_features features;
+static pthread_mutex_t features_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void nl802154_features_probe(void);
+
+/*
+ * Renamed and removed interfaces take their learned wpan_dev id with them,
+ * lost notifications take all of them.
+ */
+static void nl802154_registry_cb(struct nlmsghdr *hdr, void *priv)
+{
+	struct nl802154_wdev_cache *w;
+	struct iwpaninfo_link_stats s;
+	int i, del, same_name, same_idx;
+
+	if (!nls)
+		return;
+
+	if (!hdr)
+	{
+		memset(nls->wdevs, 0, sizeof(nls->wdevs));
+		return;
+	}
+
+	if (iwpaninfo_rtnl_parse_link(hdr, &s) || s.type != IWPANINFO_LINK_WPAN)
+		return;
+
+	del = (hdr->nlmsg_type == RTM_DELLINK);
+
+	for (i = 0; i < NL802154_WDEV_CACHE_SIZE; i++)
+	{
+		w = &nls->wdevs[i];
+
+		if (!w->wpan_dev)
+			continue;
+
+		same_name = !strcmp(w->ifname, s.ifname);
+		same_idx = (w->ifindex == s.ifindex);
+
+		if (del ? (same_name || same_idx) : (same_name != same_idx))
+			memset(w, 0, sizeof(*w));
+	}
+}
 
 static void nl802154_close(void)
 {
 	if (nls)
 	{
+		if (nls->listening)
+			iwpaninfo_registry_unlisten(nl802154_registry_cb, NULL);
+
+		if (nls->ev_cb)
+			nl_cb_put(nls->ev_cb);
+
+		if (nls->ev_sock)
+			nl_socket_free(nls->ev_sock);
+
 		if (nls->nlctrl)
 			genl_family_put(nls->nlctrl);
 
@@ -53,6 +110,8 @@ static void nl802154_close(void)
 		free(nls);
 		nls = NULL;
 	}
+
+	iwpaninfo_uci_free();
 }
 
 static int nl802154_init(void)
@@ -102,6 +161,8 @@ static int nl802154_init(void)
 			err = -ENOENT;
 			goto err;
 		}
+
+		nl802154_features_probe();
 	}
 
 	return 0;
@@ -192,11 +253,9 @@ static void nl802154_free(struct nl802154_msg_conveyor *cv)
 	}
 }
 
-static struct nl802154_msg_conveyor * nl802154_new(struct genl_family *family,
-                                                 int cmd, int flags)
+static int nl802154_prepare(struct nl802154_msg_conveyor *cv,
+                            struct genl_family *family, int cmd, int flags)
 {
-	static struct nl802154_msg_conveyor cv;
-
 	struct nl_msg *req = NULL;
 	struct nl_cb *cb = NULL;
 
@@ -210,16 +269,35 @@ static struct nl802154_msg_conveyor * nl802154_new(struct genl_family *family,
 
 	genlmsg_put(req, 0, 0, genl_family_get_id(family), 0, flags, cmd, 0);
 
-	cv.msg = req;
-	cv.cb  = cb;
+	cv->msg = req;
+	cv->cb  = cb;
 
-	return &cv;
+	return 0;
 
 err:
 	if (req)
 		nlmsg_free(req);
 
-	return NULL;
+	return -1;
+}
+
+static struct nl802154_msg_conveyor * nl802154_new(struct genl_family *family,
+                                                 int cmd, int flags)
+{
+	static __thread struct nl802154_msg_conveyor cv;
+
+	if (nl802154_prepare(&cv, family, cmd, flags))
+		return NULL;
+
+	return &cv;
+}
+
+static struct nl802154_msg_conveyor * nl802154_ctl(int cmd, int flags)
+{
+	if (nl802154_init() < 0)
+		return NULL;
+
+	return nl802154_new(nls->nlctrl, cmd, flags);
 }
 
 static int nl802154_phy_idx_from_uci_phy(struct uci_section *s)
@@ -240,64 +318,180 @@ static int nl802154_phy_idx_from_uci(const char *name)
 	struct uci_section *s;
 	int idx = -1;
 
+	/* the parsed wireless config is kept until nl802154_close() so that
+	 * repeated lookups in one process only parse it once */
 	s = iwpaninfo_uci_get_radio(name, "mac802154");
-	if (!s)
-		goto free;
+	if (s)
+		idx = nl802154_phy_idx_from_uci_phy(s);
 
-	idx = nl802154_phy_idx_from_uci_phy(s);
-
-free:
-	iwpaninfo_uci_free();
 	return idx;
 }
 
-static struct nl802154_msg_conveyor * nl802154_msg(const char *ifname,
-                                                 int cmd, int flags)
+/* Resolve through the interface registry, falling back to an ioctl */
+static int nl802154_ifindex(const char *ifname)
 {
-	int ifidx = -1, phyidx = -1;
-	struct nl802154_msg_conveyor *cv;
+	const struct iwpaninfo_netdev *dev;
 
-	if (ifname == NULL)
-		return NULL;
+	if (iwpaninfo_registry_update() < 0)
+		return if_nametoindex(ifname);
 
-	if (nl802154_init() < 0)
-		return NULL;
+	dev = iwpaninfo_registry_find(ifname);
+
+	return dev ? dev->ifindex : 0;
+}
+
+static int nl802154_resolve(const char *ifname, int *ifidx, int *phyidx)
+{
+	*ifidx = -1;
+	*phyidx = -1;
+
+	if (ifname == NULL)
+		return -1;
 
 	if (!strncmp(ifname, "phy", 3))
-		phyidx = atoi(&ifname[3]);
+		*phyidx = atoi(&ifname[3]);
 	else if (!strncmp(ifname, "radio", 5))
-		phyidx = nl802154_phy_idx_from_uci(ifname);
+		*phyidx = nl802154_phy_idx_from_uci(ifname);
 	else if (!strncmp(ifname, "mon.", 4))
-		ifidx = if_nametoindex(&ifname[4]);
+		*ifidx = nl802154_ifindex(&ifname[4]);
 	else
-		ifidx = if_nametoindex(ifname);
+		*ifidx = nl802154_ifindex(ifname);
 
 	/* Valid ifidx must be greater than 0 */
-	if ((ifidx <= 0) && (phyidx < 0))
-		return NULL;
+	if ((*ifidx <= 0) && (*phyidx < 0))
+		return -1;
 
-	cv = nl802154_new(nls->nl802154, cmd, flags);
-	if (!cv)
-		return NULL;
+	return 0;
+}
 
-	if (ifidx > -1)
+static int nl802154_put_dev(struct nl802154_msg_conveyor *cv,
+                            int ifidx, int phyidx)
+{
+	if (ifidx > 0)
 		NLA_PUT_U32(cv->msg, NL802154_ATTR_IFINDEX, ifidx);
 
 	if (phyidx > -1)
 		NLA_PUT_U32(cv->msg, NL802154_ATTR_WPAN_PHY, phyidx);
 
-	return cv;
+	return 0;
 
 nla_put_failure:
-	nl802154_free(cv);
-	return NULL;
+	return -1;
+}
+
+/*
+ * Address the interface by its wpan_dev id when one is known. The kernel
+ * finds the wdev and its phy from the id alone, so neither an ifindex nor
+ * a phy index has to be resolved first.
+ */
+static int nl802154_put_iface(struct nl802154_msg_conveyor *cv,
+                              int ifidx, uint64_t wdev)
+{
+	if (!wdev)
+		return nl802154_put_dev(cv, ifidx, -1);
+
+	NLA_PUT_U64(cv->msg, NL802154_ATTR_WPAN_DEV, wdev);
+	return 0;
+
+nla_put_failure:
+	return -1;
+}
+
+/* wpan_dev id learned for ifname, 0 if there is none */
+static uint64_t nl802154_wdev_find(const char *ifname)
+{
+	int i;
+
+	for (i = 0; i < NL802154_WDEV_CACHE_SIZE; i++)
+		if (nls->wdevs[i].wpan_dev && !strcmp(nls->wdevs[i].ifname, ifname))
+			return nls->wdevs[i].wpan_dev;
+
+	return 0;
+}
+
+/*
+ * Apply pending renames and removals before the cache is consulted. Only
+ * name lookups get here, threads that query through handles never open
+ * the registry. Without it cached ids are still checked per query.
+ */
+static void nl802154_wdev_sync(void)
+{
+	if (!nls->listening)
+		nls->listening = !iwpaninfo_registry_listen(nl802154_registry_cb, NULL);
+
+	iwpaninfo_registry_update();
+}
+
+static void nl802154_wdev_forget(const char *ifname)
+{
+	int i;
+
+	for (i = 0; i < NL802154_WDEV_CACHE_SIZE; i++)
+		if (!strcmp(nls->wdevs[i].ifname, ifname))
+			memset(&nls->wdevs[i], 0, sizeof(nls->wdevs[i]));
+}
+
+/* Remember the wpan_dev id of an interface reply, a rename moves the name */
+static void nl802154_wdev_learn(const struct iwpaninfo_info *info)
+{
+	struct nl802154_wdev_cache *w = NULL;
+	int i;
+
+	if (!(info->valid & IWPANINFO_FIELD_WPAN_DEV) || !info->ifname[0])
+		return;
+
+	for (i = 0; i < NL802154_WDEV_CACHE_SIZE; i++)
+	{
+		if (nls->wdevs[i].wpan_dev == info->wpan_dev)
+			w = &nls->wdevs[i];
+		else if (!strcmp(nls->wdevs[i].ifname, info->ifname))
+			memset(&nls->wdevs[i], 0, sizeof(nls->wdevs[i]));
+	}
+
+	if (!w)
+	{
+		w = &nls->wdevs[nls->wdevs_next];
+		nls->wdevs_next = (nls->wdevs_next + 1) % NL802154_WDEV_CACHE_SIZE;
+	}
+
+	w->wpan_dev = info->wpan_dev;
+	w->ifindex = (info->valid & IWPANINFO_FIELD_IFINDEX) ? info->ifindex : 0;
+	snprintf(w->ifname, sizeof(w->ifname), "%s", info->ifname);
+}
+
+static struct nl802154_msg_conveyor * nl802154_msg(const char *ifname,
+                                                 int cmd, int flags)
+{
+	int ifidx, phyidx;
+	struct nl802154_msg_conveyor *cv;
+
+	if (ifname == NULL)
+		return NULL;
+
+	if (nl802154_init() < 0)
+		return NULL;
+
+	if (nl802154_resolve(ifname, &ifidx, &phyidx))
+		return NULL;
+
+	cv = nl802154_new(nls->nl802154, cmd, flags);
+	if (!cv)
+		return NULL;
+
+	if (nl802154_put_dev(cv, ifidx, phyidx))
+	{
+		nl802154_free(cv);
+		return NULL;
+	}
+
+	return cv;
 }
 
 static struct nl802154_msg_conveyor * nl802154_send(
 	struct nl802154_msg_conveyor *cv,
 	int (*cb_func)(struct nl_msg *, void *), void *cb_arg
 ) {
-	static struct nl802154_msg_conveyor rcv;
+	static __thread struct nl802154_msg_conveyor rcv;
 	int err = 1;
 
 	if (cb_func)
@@ -324,10 +518,56 @@ err:
 	return NULL;
 }
 
+static int nl802154_multi_done(struct nl_msg *msg, void *arg)
+{
+	int *pending = arg;
+	(*pending)--;
+	return NL_SKIP;
+}
+
+static int nl802154_multi_error(struct sockaddr_nl *nla,
+	struct nlmsgerr *err, void *arg)
+{
+	int *pending = arg;
+	(*pending)--;
+	return NL_SKIP;
+}
+
+/*
+ * Send several prepared requests back to back and collect all of their
+ * replies in a single receive loop. The kernel answers in order, cb_func
+ * sees every reply and can tell them apart by their genl command.
+ */
+static int nl802154_send_multi(struct nl802154_msg_conveyor *cv, int count,
+	int (*cb_func)(struct nl_msg *, void *), void *cb_arg)
+{
+	int i, pending = 0;
+	struct nl_cb *cb = cv[0].cb;
+
+	nl_cb_set(cb, NL_CB_VALID,  NL_CB_CUSTOM, cb_func, cb_arg);
+	nl_cb_err(cb,               NL_CB_CUSTOM, nl802154_multi_error, &pending);
+	nl_cb_set(cb, NL_CB_FINISH, NL_CB_CUSTOM, nl802154_multi_done,  &pending);
+	nl_cb_set(cb, NL_CB_ACK,    NL_CB_CUSTOM, nl802154_multi_done,  &pending);
+
+	for (i = 0; i < count; i++)
+	{
+		if (nl_send_auto_complete(nls->nl_sock, cv[i].msg) < 0)
+			break;
+
+		pending++;
+	}
+
+	while (pending > 0)
+		if (nl_recvmsgs(nls->nl_sock, cb) < 0)
+			return -1;
+
+	return (i == count) ? 0 : -1;
+}
+
 static struct nlattr ** nl802154_parse(struct nl_msg *msg)
 {
 	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
-	static struct nlattr *attr[NL802154_ATTR_MAX + 1];
+	static __thread struct nlattr *attr[NL802154_ATTR_MAX + 1];
 
 	nla_parse(attr, NL802154_ATTR_MAX, genlmsg_attrdata(gnlh, 0),
 	          genlmsg_attrlen(gnlh, 0), NULL);
@@ -335,119 +575,120 @@ static struct nlattr ** nl802154_parse(struct nl_msg *msg)
 	return attr;
 }
 
-static float nl802154_channel2freq(int channel_page, int channel) {
-	float freq = 0;
+/* Attributes each IWPANINFO_FIELD_* is decoded from, indexed by bit */
+static const uint8_t nl802154_field_attrs[IWPANINFO_FIELD_COUNT][2] = {
+	{ NL802154_ATTR_IFINDEX },
+	{ NL802154_ATTR_WPAN_PHY, NL802154_ATTR_WPAN_PHY_NAME },
+	{ NL802154_ATTR_WPAN_DEV },
+	{ NL802154_ATTR_IFTYPE },
+	{ NL802154_ATTR_PAGE },
+	{ NL802154_ATTR_CHANNEL },
+	{ NL802154_ATTR_PAGE, NL802154_ATTR_CHANNEL },
+	{ NL802154_ATTR_TX_POWER },
+	{ NL802154_ATTR_PAN_ID },
+	{ NL802154_ATTR_SHORT_ADDR },
+	{ NL802154_ATTR_EXTENDED_ADDR },
+	{ NL802154_ATTR_MIN_BE },
+	{ NL802154_ATTR_MAX_BE },
+	{ NL802154_ATTR_MAX_CSMA_BACKOFFS },
+	{ NL802154_ATTR_MAX_FRAME_RETRIES },
+	{ NL802154_ATTR_LBT_MODE },
+	{ NL802154_ATTR_CCA_MODE },
+	{ NL802154_ATTR_CCA_OPT },
+	{ NL802154_ATTR_CCA_ED_LEVEL },
+};
 
-	switch (channel_page) {
-	case 0:
-		if (channel == 0) {
-			freq = 868.3;
-			break;
-		} else if (channel > 0 && channel < 11) {
-			freq = 906 + 2 * (channel - 1);
-		} else {
-			freq = 2405 + 5 * (channel - 11);
-		}
-		break;
-	case 1:
-		if (channel == 0) {
-			freq = 868.3;
-			break;
-		} else if (channel >= 1 && channel <= 10) {
-			freq = 906 + 2 * (channel - 1);
-		}
-		break;
-	case 2:
-		if (channel == 0) {
-			freq = 868.3;
-			break;
-		} else if (channel >= 1 && channel <= 10) {
-			freq = 906 + 2 * (channel - 1);
-		}
-		break;
-	case 3:
-		if (channel >= 0 && channel <= 12) {
-			freq = 2412 + 5 * channel;
-		} else if (channel == 13) {
-			freq = 2484;
-		}
-		break;
-	case 4:
-		switch (channel) {
-		case 0:
-			freq = 499.2;
-			break;
-		case 1:
-			freq = 3494.4;
-			break;
-		case 2:
-			freq = 3993.6;
-			break;
-		case 3:
-			freq = 4492.8;
-			break;
-		case 4:
-			freq = 3993.6;
-			break;
-		case 5:
-			freq = 6489.6;
-			break;
-		case 6:
-			freq = 6988.8;
-			break;
-		case 7:
-			freq = 6489.6;
-			break;
-		case 8:
-			freq = 7488.0;
-			break;
-		case 9:
-			freq = 7987.2;
-			break;
-		case 10:
-			freq = 8486.4;
-			break;
-		case 11:
-			freq = 7987.2;
-			break;
-		case 12:
-			freq = 8985.6;
-			break;
-		case 13:
-			freq = 9484.8;
-			break;
-		case 14:
-			freq = 9984.0;
-			break;
-		case 15:
-			freq = 9484.8;
-			break;
-		}
-		break;
-	case 5:
-		if (channel >= 0 && channel <= 3) {
-			freq = 780 + 2 * channel;
-		} else if (channel >= 4 && channel <= 7) {
-			freq = 780 + 2 * (channel - 4);
-		}
-		break;
-	case 6:
-		if (channel >= 0 && channel <= 7) {
-			freq = 951.2 + 0.6 * channel;
-		} else if (channel >= 8 && channel <= 9) {
-			freq = 954.4 + 0.2 * (channel - 8);
-		} else if (channel >= 10 && channel <= 21) {
-			freq = 951.1 + 0.4 * (channel - 10);
+static int nl802154_features_cb(struct nl_msg *msg, void *arg)
+{
+	struct nl802154_features *f = arg;
+	struct nlattr **attr = nl802154_parse(msg);
+	struct nlattr *op[CTRL_ATTR_OP_MAX + 1];
+	struct nlattr *nla;
+	uint32_t id;
+	int rem;
+
+	if (attr[CTRL_ATTR_MAXATTR])
+		f->maxattr = nla_get_u32(attr[CTRL_ATTR_MAXATTR]);
+
+	if (!attr[CTRL_ATTR_OPS])
+		return NL_SKIP;
+
+	memset(f->cmds, 0, sizeof(f->cmds));
+	memset(f->dump_cmds, 0, sizeof(f->dump_cmds));
+
+	nla_for_each_nested(nla, attr[CTRL_ATTR_OPS], rem)
+	{
+		if (nla_parse_nested(op, CTRL_ATTR_OP_MAX, nla, NULL) ||
+		    !op[CTRL_ATTR_OP_ID])
+			continue;
+
+		id = nla_get_u32(op[CTRL_ATTR_OP_ID]);
+		if (id >= IWPANINFO_MAX_COMMANDS)
+			continue;
+
+		iwpaninfo_command_set(f->cmds, id);
+
+		if (op[CTRL_ATTR_OP_FLAGS] &&
+		    (nla_get_u32(op[CTRL_ATTR_OP_FLAGS]) & GENL_CMD_CAP_DUMP))
+			iwpaninfo_command_set(f->dump_cmds, id);
+	}
+
+	return NL_SKIP;
+}
+
+/*
+ * Ask the controller which commands the nl802154 family implements, which
+ * of them dump and how many attributes it knows. The first thread to get
+ * a netlink context does the exchange, the rest reuse its answer.
+ */
+static void nl802154_features_probe(void)
+{
+	struct nl802154_msg_conveyor *req;
+	int i;
+
+	pthread_mutex_lock(&features_lock);
+
+	if (!features.probed)
+	{
+		/* without an answer assume what the api header describes */
+		features.maxattr = genl_family_get_maxattr(nls->nl802154);
+		memset(features.cmds, 0xff, sizeof(features.cmds));
+		memset(features.dump_cmds, 0xff, sizeof(features.dump_cmds));
+
+		req = nl802154_new(nls->nlctrl, CTRL_CMD_GETFAMILY, 0);
+		if (req)
+		{
+			NLA_PUT_STRING(req->msg, CTRL_ATTR_FAMILY_NAME, "nl802154");
+			nl802154_send(req, nl802154_features_cb, &features);
+
+nla_put_failure:
+			nl802154_free(req);
 		}
-		break;
-	default:
-		freq = 0;
-		break;
+
+		if (!features.maxattr)
+			features.maxattr = NL802154_ATTR_MAX;
+
+		/* a field is only reported when all its attributes are known */
+		for (i = 0; i < IWPANINFO_FIELD_COUNT; i++)
+			if (nl802154_field_attrs[i][0] <= features.maxattr &&
+			    nl802154_field_attrs[i][1] <= features.maxattr)
+				features.fields |= (1U << i);
+
+		features.probed = 1;
 	}
 
-	return freq;
+	pthread_mutex_unlock(&features_lock);
 }
 
+static int nl802154_has_cmd(int cmd)
+{
+	return iwpaninfo_command_isset(features.cmds, cmd);
+}
+
+static int nl802154_has_attr(int attr)
+{
+	return attr <= features.maxattr;
+}
 
 static int nl802154_ifname2phy_cb(struct nl_msg *msg, void *arg)
 {
@@ -464,7 +705,7 @@ static int nl802154_ifname2phy_cb(struct nl_msg *msg, void *arg)
 
 static char * nl802154_ifname2phy(const char *ifname)
 {
-	static char phy[32] = { 0 };
+	static __thread char phy[32] = { 0 };
 	struct nl802154_msg_conveyor *req;
 
 	memset(phy, 0, sizeof(phy));
@@ -483,7 +724,8 @@ static char * nl802154_phy2ifname(const char *ifname)
 {
 	int ifidx = -1, cifidx = -1, phyidx = -1;
 	char buffer[64];
-	static char nif[IFNAMSIZ] = { 0 };
+	static __thread char nif[IFNAMSIZ] = { 0 };
+	const struct iwpaninfo_netdev *dev;
 
 	DIR *d;
 	struct dirent *e;
@@ -500,7 +742,12 @@ static char * nl802154_phy2ifname(const char *ifname)
 
 	memset(nif, 0, sizeof(nif));
 
-	if (phyidx > -1)
+	if (phyidx > -1 && iwpaninfo_registry_update() >= 0)
+	{
+		if ((dev = iwpaninfo_registry_find_phy(phyidx)) != NULL)
+			snprintf(nif, sizeof(nif), "%s", dev->ifname);
+	}
+	else if (phyidx > -1)
 	{
 		if ((d = opendir("/sys/class/net")) != NULL)
 		{
@@ -548,10 +795,31 @@ static int nl802154_get_mode_cb(struct nl_msg *msg, void *arg)
 }
 
 
+/*
+ * Serve single field getters from a fresh iwpaninfo-shmd snapshot when
+ * one is published, so "iwpaninfo wpan0 info" and the per field Lua
+ * calls cost no netlink round trip either.
+ */
+static int nl802154_shm_field(const char *ifname, uint32_t field,
+                              struct iwpaninfo_info *info)
+{
+	if (iwpaninfo_shm_get_info(ifname, info) || !(info->valid & field))
+		return -1;
+
+	return 0;
+}
+
 static int nl802154_get_mode(const char *ifname, int *buf)
 {
 	char *res;
 	struct nl802154_msg_conveyor *req;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_MODE, &info))
+	{
+		*buf = info.mode;
+		return 0;
+	}
 
 	res = nl802154_phy2ifname(ifname);
 	req = nl802154_msg(res ? res : ifname, NL802154_CMD_GET_INTERFACE, 0);
@@ -568,7 +836,18 @@ static int nl802154_get_mode(const char *ifname, int *buf)
 
 static int nl802154_probe(const char *ifname)
 {
-	char *phy = nl802154_ifname2phy(ifname);
+	const struct iwpaninfo_netdev *dev;
+	char *phy;
+
+	/* plain interface names are answered from the registry */
+	if (ifname && strncmp(ifname, "phy", 3) && strncmp(ifname, "radio", 5) &&
+	    strncmp(ifname, "mon.", 4) && iwpaninfo_registry_update() >= 0)
+	{
+		dev = iwpaninfo_registry_find(ifname);
+		return dev && IWPANINFO_ARPHRD_WPAN(dev->type);
+	}
+
+	phy = nl802154_ifname2phy(ifname);
 	return !!phy;
 }
 
@@ -587,6 +866,13 @@ static int nl802154_get_channel(const char *ifname, int *buf)
 {
 	char *res;
 	struct nl802154_msg_conveyor *req;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_CHANNEL, &info))
+	{
+		*buf = info.channel;
+		return 0;
+	}
 
 	/* try to find channel from interface info */
 	res = nl802154_phy2ifname(ifname);
@@ -618,6 +904,13 @@ static int nl802154_get_txpower(const char *ifname, int *buf)
 {
 	char *res;
 	struct nl802154_msg_conveyor *req;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_TXPOWER, &info))
+	{
+		*buf = info.txpower;
+		return 0;
+	}
 
 	res = nl802154_phy2ifname(ifname);
 	req = nl802154_msg(res ? res : ifname, NL802154_CMD_GET_WPAN_PHY, 0);
@@ -635,6 +928,14 @@ static int nl802154_get_txpower(const char *ifname, int *buf)
 static int nl802154_get_phyname(const char *ifname, char *buf)
 {
 	const char *name;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_PHY, &info) &&
+	    info.phyname[0])
+	{
+		strcpy(buf, info.phyname);
+		return 0;
+	}
 
 	name = nl802154_ifname2phy(ifname);
 
@@ -690,7 +991,9 @@ static int nl802154_get_txpwrlist_cb(struct nl_msg *msg, void *arg)
 		struct nlattr *nl_pwrs;
 
 		nla_for_each_nested(nl_pwrs, tb_caps[NL802154_CAP_ATTR_TX_POWERS], rem_pwrs) {
-			e->dbm = MBM_TO_DBM(nla_get_s32(nl_pwrs));
+			e->mbm = nla_get_s32(nl_pwrs);
+			e->uw = iwpaninfo_mbm2uw(e->mbm);
+			e->dbm = MBM_TO_DBM(e->mbm);
 //			e->mw = iwpaninfo_dbm2mw(e->dbm);
 			e++;
 			arr->count++;
@@ -722,7 +1025,7 @@ static int nl802154_get_txpwrlist(const char *ifname, char *buf, int *len)
 
 	if (arr.count > 0)
 	{
-		*len = arr.count * sizeof(struct iwpaninfo_cca_ed_lvl_list_entry);
+		*len = arr.count * sizeof(struct iwpaninfo_txpwrlist_entry);
 		return 0;
 	}
 
@@ -762,7 +1065,8 @@ static int nl802154_get_cca_ed_lvl_cb(struct nl_msg *msg, void *arg)
 		struct nlattr *nl_cca_ed_lvls;
 
 		nla_for_each_nested(nl_cca_ed_lvls, tb_caps[NL802154_CAP_ATTR_CCA_ED_LEVELS], rem_cca_ed_lvls) {
-			e->dbm = MBM_TO_DBM(nla_get_s32(nl_cca_ed_lvls));
+			e->mbm = nla_get_s32(nl_cca_ed_lvls);
+			e->dbm = MBM_TO_DBM(e->mbm);
 			e++;
 			arr->count++;
 		}
@@ -790,7 +1094,7 @@ static int nl802154_get_cca_ed_lvl_list(const char *ifname, char *buf, int *len)
 
 	if (arr.count > 0)
 	{
-		*len = arr.count * sizeof(struct iwpaninfo_txpwrlist_entry);
+		*len = arr.count * sizeof(struct iwpaninfo_cca_ed_lvl_list_entry);
 		return 0;
 	}
 
@@ -838,7 +1142,8 @@ static int nl802154_get_freqlist_cb(struct nl_msg *msg, void *arg)
 			nla_for_each_nested(nl_ch, nl_pages, rem_ch)
 			{
 				e->channel = nla_type(nl_ch);
-				e->mhz = nl802154_channel2freq(current_page, e->channel);
+				e->khz = iwpaninfo_channel2khz(current_page, e->channel);
+				e->mhz = e->khz / 1000.0f;
 				e++;
 				arr->count++;
 			}
@@ -902,6 +1207,13 @@ static int nl802154_get_panid(const char *ifname, int *buf)
 {
 	char *res;
 	struct nl802154_msg_conveyor *req;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_PANID, &info))
+	{
+		*buf = info.panid;
+		return 0;
+	}
 
 	/* try to find PAN ID from interface info */
 	res = nl802154_phy2ifname(ifname);
@@ -932,6 +1244,13 @@ static int nl802154_get_short_address(const char *ifname, int *buf)
 {
 	char *res;
 	struct nl802154_msg_conveyor *req;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_SHORT_ADDR, &info))
+	{
+		*buf = info.short_address;
+		return 0;
+	}
 
 	/* try to find short address from interface info */
 	res = nl802154_phy2ifname(ifname);
@@ -962,6 +1281,13 @@ static int nl802154_get_extended_address(const char *ifname, uint64_t *buf)
 {
 	char *res;
 	struct nl802154_msg_conveyor *req;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_EXTENDED_ADDR, &info))
+	{
+		*buf = info.extended_address;
+		return 0;
+	}
 
 	/* try to find extended address from interface info */
 	res = nl802154_phy2ifname(ifname);
@@ -993,6 +1319,13 @@ static int nl802154_get_page(const char *ifname, int *buf)
 {
 	char *res;
 	struct nl802154_msg_conveyor *req;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_PAGE, &info))
+	{
+		*buf = info.page;
+		return 0;
+	}
 
 	/* try to find channel page from interface info */
 	res = nl802154_phy2ifname(ifname);
@@ -1011,10 +1344,18 @@ static int nl802154_get_page(const char *ifname, int *buf)
 
 static int nl802154_get_frequency(const char *ifname, int *buf) {
 	int current_page = -1;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_FREQUENCY, &info))
+	{
+		*buf = info.frequency / 1000;
+		return 0;
+	}
+
 	if (!nl802154_get_page(ifname, buf)) {
 		current_page = nl802154_get_page(ifname, buf);
 		if (!nl802154_get_channel(ifname, buf)) {
-			*buf = nl802154_channel2freq(current_page, *buf);
+			*buf = iwpaninfo_channel2khz(current_page, *buf) / 1000;
 			return 0;
 		}
 	}
@@ -1037,6 +1378,13 @@ static int nl802154_get_min_be(const char *ifname, int *buf)
 {
 	char *res;
 	struct nl802154_msg_conveyor *req;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_MIN_BE, &info))
+	{
+		*buf = info.min_be;
+		return 0;
+	}
 
 	/* try to find min be from interface info */
 	res = nl802154_phy2ifname(ifname);
@@ -1068,6 +1416,13 @@ static int nl802154_get_max_be(const char *ifname, int *buf)
 {
 	char *res;
 	struct nl802154_msg_conveyor *req;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_MAX_BE, &info))
+	{
+		*buf = info.max_be;
+		return 0;
+	}
 
 	/* try to find max be from interface info */
 	res = nl802154_phy2ifname(ifname);
@@ -1099,6 +1454,13 @@ static int nl802154_get_csma_backoff(const char *ifname, int *buf)
 {
 	char *res;
 	struct nl802154_msg_conveyor *req;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_CSMA_BACKOFF, &info))
+	{
+		*buf = info.csma_backoff;
+		return 0;
+	}
 
 	/* try to find max be from interface info */
 	res = nl802154_phy2ifname(ifname);
@@ -1129,6 +1491,13 @@ static int nl802154_get_frame_retry(const char *ifname, int *buf)
 {
 	char *res;
 	struct nl802154_msg_conveyor *req;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_FRAME_RETRY, &info))
+	{
+		*buf = info.frame_retry;
+		return 0;
+	}
 
 	/* try to find frame retry from interface info */
 	res = nl802154_phy2ifname(ifname);
@@ -1160,6 +1529,13 @@ static int nl802154_get_lbt_mode(const char *ifname, int *buf)
 {
 	char *res;
 	struct nl802154_msg_conveyor *req;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_LBT_MODE, &info))
+	{
+		*buf = info.lbt_mode;
+		return 0;
+	}
 
 	/* try to find lbt mode from interface info */
 	res = nl802154_phy2ifname(ifname);
@@ -1191,6 +1567,13 @@ static int nl802154_get_cca_mode(const char *ifname, int *buf)
 {
 	char *res;
 	struct nl802154_msg_conveyor *req;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_CCA_MODE, &info))
+	{
+		*buf = info.cca_mode;
+		return 0;
+	}
 
 	/* try to find cca mode from interface info */
 	res = nl802154_phy2ifname(ifname);
@@ -1222,6 +1605,13 @@ static int nl802154_get_cca_opt(const char *ifname, int *buf)
 {
 	char *res;
 	struct nl802154_msg_conveyor *req;
+	struct iwpaninfo_info info;
+
+	if (!nl802154_shm_field(ifname, IWPANINFO_FIELD_CCA_OPT, &info))
+	{
+		*buf = info.cca_opt;
+		return 0;
+	}
 
 	/* try to find cca opt from interface info */
 	res = nl802154_phy2ifname(ifname);
@@ -1238,6 +1628,1003 @@ static int nl802154_get_cca_opt(const char *ifname, int *buf)
 	return *buf;
 }
 
+static void nl802154_info_frequency(struct iwpaninfo_info *info)
+{
+	if ((info->valid & IWPANINFO_FIELD_PAGE) &&
+	    (info->valid & IWPANINFO_FIELD_CHANNEL))
+	{
+		info->frequency = iwpaninfo_channel2khz(info->page, info->channel);
+		if (info->frequency)
+			info->valid |= IWPANINFO_FIELD_FREQUENCY;
+	}
+}
+
+static void nl802154_info_parse(struct nlattr **tb, struct iwpaninfo_info *info)
+{
+	uint32_t iftype;
+
+	if (tb[NL802154_ATTR_IFINDEX])
+	{
+		info->ifindex = nla_get_u32(tb[NL802154_ATTR_IFINDEX]);
+		info->valid |= IWPANINFO_FIELD_IFINDEX;
+	}
+
+	if (tb[NL802154_ATTR_IFNAME])
+		strncpy(info->ifname, nla_get_string(tb[NL802154_ATTR_IFNAME]),
+		        sizeof(info->ifname) - 1);
+
+	if (tb[NL802154_ATTR_WPAN_PHY])
+	{
+		info->phy = nla_get_u32(tb[NL802154_ATTR_WPAN_PHY]);
+		info->valid |= IWPANINFO_FIELD_PHY;
+	}
+
+	if (tb[NL802154_ATTR_WPAN_PHY_NAME])
+		strncpy(info->phyname, nla_get_string(tb[NL802154_ATTR_WPAN_PHY_NAME]),
+		        sizeof(info->phyname) - 1);
+
+	if (tb[NL802154_ATTR_WPAN_DEV])
+	{
+		info->wpan_dev = nla_get_u64(tb[NL802154_ATTR_WPAN_DEV]);
+		info->valid |= IWPANINFO_FIELD_WPAN_DEV;
+	}
+
+	if (tb[NL802154_ATTR_IFTYPE])
+	{
+		iftype = nla_get_u32(tb[NL802154_ATTR_IFTYPE]);
+		info->mode = (iftype <= NL802154_IFTYPE_MAX)
+			? iftype : IWPANINFO_OPMODE_UNKNOWN;
+		info->valid |= IWPANINFO_FIELD_MODE;
+	}
+
+	if (tb[NL802154_ATTR_PAN_ID])
+	{
+		info->panid = le16toh(nla_get_u16(tb[NL802154_ATTR_PAN_ID]));
+		info->valid |= IWPANINFO_FIELD_PANID;
+	}
+
+	if (tb[NL802154_ATTR_SHORT_ADDR])
+	{
+		info->short_address = le16toh(nla_get_u16(tb[NL802154_ATTR_SHORT_ADDR]));
+		info->valid |= IWPANINFO_FIELD_SHORT_ADDR;
+	}
+
+	if (tb[NL802154_ATTR_EXTENDED_ADDR])
+	{
+		info->extended_address = le64toh(nla_get_u64(tb[NL802154_ATTR_EXTENDED_ADDR]));
+		info->valid |= IWPANINFO_FIELD_EXTENDED_ADDR;
+	}
+
+	if (tb[NL802154_ATTR_MIN_BE])
+	{
+		info->min_be = nla_get_u8(tb[NL802154_ATTR_MIN_BE]);
+		info->valid |= IWPANINFO_FIELD_MIN_BE;
+	}
+
+	if (tb[NL802154_ATTR_MAX_BE])
+	{
+		info->max_be = nla_get_u8(tb[NL802154_ATTR_MAX_BE]);
+		info->valid |= IWPANINFO_FIELD_MAX_BE;
+	}
+
+	if (tb[NL802154_ATTR_MAX_CSMA_BACKOFFS])
+	{
+		info->csma_backoff = nla_get_u8(tb[NL802154_ATTR_MAX_CSMA_BACKOFFS]);
+		info->valid |= IWPANINFO_FIELD_CSMA_BACKOFF;
+	}
+
+	if (tb[NL802154_ATTR_MAX_FRAME_RETRIES])
+	{
+		info->frame_retry = nla_get_s8(tb[NL802154_ATTR_MAX_FRAME_RETRIES]);
+		info->valid |= IWPANINFO_FIELD_FRAME_RETRY;
+	}
+
+	if (tb[NL802154_ATTR_LBT_MODE])
+	{
+		info->lbt_mode = nla_get_u8(tb[NL802154_ATTR_LBT_MODE]);
+		info->valid |= IWPANINFO_FIELD_LBT_MODE;
+	}
+
+	if (tb[NL802154_ATTR_PAGE])
+	{
+		info->page = nla_get_u8(tb[NL802154_ATTR_PAGE]);
+		info->valid |= IWPANINFO_FIELD_PAGE;
+	}
+
+	if (tb[NL802154_ATTR_CHANNEL])
+	{
+		info->channel = nla_get_u8(tb[NL802154_ATTR_CHANNEL]);
+		info->valid |= IWPANINFO_FIELD_CHANNEL;
+	}
+
+	if (tb[NL802154_ATTR_TX_POWER])
+	{
+		info->txpower = nla_get_s32(tb[NL802154_ATTR_TX_POWER]);
+		info->valid |= IWPANINFO_FIELD_TXPOWER;
+	}
+
+	if (tb[NL802154_ATTR_CCA_MODE])
+	{
+		info->cca_mode = nla_get_u32(tb[NL802154_ATTR_CCA_MODE]);
+		info->valid |= IWPANINFO_FIELD_CCA_MODE;
+	}
+
+	if (tb[NL802154_ATTR_CCA_OPT])
+	{
+		info->cca_opt = nla_get_u32(tb[NL802154_ATTR_CCA_OPT]);
+		info->valid |= IWPANINFO_FIELD_CCA_OPT;
+	}
+
+	if (tb[NL802154_ATTR_CCA_ED_LEVEL])
+	{
+		info->cca_ed_level = nla_get_s32(tb[NL802154_ATTR_CCA_ED_LEVEL]);
+		info->valid |= IWPANINFO_FIELD_CCA_ED_LEVEL;
+	}
+}
+
+static int nl802154_get_info_cb(struct nl_msg *msg, void *arg)
+{
+	nl802154_info_parse(nl802154_parse(msg), arg);
+	return NL_SKIP;
+}
+
+/* Fields carried by the GET_INTERFACE and GET_WPAN_PHY replies */
+#define NL802154_IFACE_FIELDS \
+	(IWPANINFO_FIELD_IFINDEX | IWPANINFO_FIELD_PHY | \
+	 IWPANINFO_FIELD_WPAN_DEV | IWPANINFO_FIELD_MODE | \
+	 IWPANINFO_FIELD_PANID | IWPANINFO_FIELD_SHORT_ADDR | \
+	 IWPANINFO_FIELD_EXTENDED_ADDR | IWPANINFO_FIELD_MIN_BE | \
+	 IWPANINFO_FIELD_MAX_BE | IWPANINFO_FIELD_CSMA_BACKOFF | \
+	 IWPANINFO_FIELD_FRAME_RETRY | IWPANINFO_FIELD_LBT_MODE)
+
+#define NL802154_PHY_FIELDS \
+	(IWPANINFO_FIELD_PHY | IWPANINFO_FIELD_PAGE | \
+	 IWPANINFO_FIELD_CHANNEL | IWPANINFO_FIELD_FREQUENCY | \
+	 IWPANINFO_FIELD_TXPOWER | IWPANINFO_FIELD_CCA_MODE | \
+	 IWPANINFO_FIELD_CCA_OPT | IWPANINFO_FIELD_CCA_ED_LEVEL)
+
+/*
+ * Send only the requests whose replies carry a field of mask, both are
+ * still answered in one receive loop. The phy index comes with either
+ * reply, the interface one is preferred when there is an interface.
+ */
+static int nl802154_query_idx(int ifidx, int phyidx, uint64_t wdev,
+                              uint32_t mask, struct iwpaninfo_info *info)
+{
+	int i, n = 0, want_if, want_phy;
+	struct nl802154_msg_conveyor cv[2];
+
+	memset(info, 0, sizeof(*info));
+
+	if (nl802154_init() < 0)
+		return -1;
+
+	/* fields the kernel has no attribute for would only cost a request */
+	mask &= features.fields;
+
+	want_if = (ifidx > 0 || wdev) && (mask & NL802154_IFACE_FIELDS) &&
+	          nl802154_has_cmd(NL802154_CMD_GET_INTERFACE);
+	want_phy = ((mask & (NL802154_PHY_FIELDS & ~IWPANINFO_FIELD_PHY)) ||
+	            ((mask & IWPANINFO_FIELD_PHY) && !want_if)) &&
+	           nl802154_has_cmd(NL802154_CMD_GET_WPAN_PHY);
+
+	if (!want_if && !want_phy)
+		return -1;
+
+	if (want_if)
+	{
+		if (nl802154_prepare(&cv[n], nls->nl802154, NL802154_CMD_GET_INTERFACE, 0))
+			goto out;
+
+		n++;
+
+		if (nl802154_put_iface(&cv[n - 1], ifidx, wdev))
+			goto out;
+	}
+
+	if (want_phy)
+	{
+		if (nl802154_prepare(&cv[n], nls->nl802154, NL802154_CMD_GET_WPAN_PHY, 0))
+			goto out;
+
+		n++;
+
+		if ((ifidx > 0 || wdev)
+		    ? nl802154_put_iface(&cv[n - 1], ifidx, wdev)
+		    : nl802154_put_dev(&cv[n - 1], -1, phyidx))
+			goto out;
+	}
+
+	nl802154_send_multi(cv, n, nl802154_get_info_cb, info);
+	nl802154_info_frequency(info);
+	nl802154_wdev_learn(info);
+
+	if (!info->ifname[0] && ifidx > 0)
+		if_indextoname(ifidx, info->ifname);
+
+	info->valid &= mask;
+
+out:
+	for (i = 0; i < n; i++)
+		nl802154_free(&cv[i]);
+
+	return info->valid ? 0 : -1;
+}
+
+/*
+ * Names seen in earlier replies go straight to their wpan_dev id. The
+ * interface request is always sent then, so its name can be checked; if
+ * the interface is gone or the name now belongs to another one, fall back
+ * to resolving the name.
+ */
+static int nl802154_query(const char *ifname, uint32_t mask,
+                          struct iwpaninfo_info *info)
+{
+	int ifidx, phyidx;
+	uint64_t wdev;
+	char *res;
+
+	memset(info, 0, sizeof(*info));
+
+	if (ifname == NULL || nl802154_init() < 0)
+		return -1;
+
+	nl802154_wdev_sync();
+
+	if ((wdev = nl802154_wdev_find(ifname)) != 0)
+	{
+		if (!nl802154_query_idx(-1, -1, wdev,
+		                        mask | IWPANINFO_FIELD_WPAN_DEV, info) &&
+		    !strcmp(info->ifname, ifname))
+		{
+			info->valid &= mask;
+			return info->valid ? 0 : -1;
+		}
+
+		nl802154_wdev_forget(ifname);
+	}
+
+	res = nl802154_phy2ifname(ifname);
+	if (nl802154_resolve(res ? res : ifname, &ifidx, &phyidx))
+	{
+		memset(info, 0, sizeof(*info));
+		return -1;
+	}
+
+	return nl802154_query_idx(ifidx, phyidx, 0, mask, info);
+}
+
+static int nl802154_get_info(const char *ifname, struct iwpaninfo_info *info)
+{
+	return nl802154_query(ifname, IWPANINFO_FIELD_ALL, info);
+}
+
+static int nl802154_dev_info(const struct iwpaninfo_dev *dev,
+                             struct iwpaninfo_info *info)
+{
+	return nl802154_query_idx(dev->ifindex, dev->phy, dev->wpan_dev,
+	                          IWPANINFO_FIELD_ALL, info);
+}
+
+static int nl802154_dev_query(const struct iwpaninfo_dev *dev, uint32_t mask,
+                              struct iwpaninfo_info *info)
+{
+	return nl802154_query_idx(dev->ifindex, dev->phy, dev->wpan_dev,
+	                          mask, info);
+}
+
+static int nl802154_lookup(const char *ifname, struct iwpaninfo_dev *dev)
+{
+	struct iwpaninfo_info info;
+
+	if (nl802154_get_info(ifname, &info))
+		return -1;
+
+	snprintf(dev->ifname, sizeof(dev->ifname), "%s",
+	         info.ifname[0] ? info.ifname : ifname);
+	dev->ifindex = (info.valid & IWPANINFO_FIELD_IFINDEX) ? info.ifindex : -1;
+	dev->phy = (info.valid & IWPANINFO_FIELD_PHY) ? info.phy : -1;
+	dev->wpan_dev = (info.valid & IWPANINFO_FIELD_WPAN_DEV) ? info.wpan_dev : 0;
+
+	return 0;
+}
+
+static int nl802154_get_raw_cb(struct nl_msg *msg, void *arg)
+{
+	struct nl802154_array_buf *arr = arg;
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+	int len = genlmsg_attrlen(gnlh, 0);
+
+	if (arr->count + len <= IWPANINFO_BUFSIZE)
+	{
+		memcpy((char *)arr->buf + arr->count, genlmsg_attrdata(gnlh, 0), len);
+		arr->count += len;
+	}
+
+	return NL_SKIP;
+}
+
+/*
+ * Copy the undecoded attribute streams of the interface and phy replies
+ * into arr, individual fields are extracted later by nl802154_decode().
+ */
+static int nl802154_get_raw_idx(int ifidx, int phyidx, uint64_t wdev,
+                                struct nl802154_array_buf *arr)
+{
+	int i, n = 0;
+	struct nl802154_msg_conveyor cv[2];
+
+	arr->count = 0;
+
+	if (ifidx > 0 || wdev)
+	{
+		if (nl802154_prepare(&cv[n], nls->nl802154, NL802154_CMD_GET_INTERFACE, 0))
+			goto out;
+
+		n++;
+
+		if (nl802154_put_iface(&cv[n - 1], ifidx, wdev))
+			goto out;
+	}
+
+	if (nl802154_prepare(&cv[n], nls->nl802154, NL802154_CMD_GET_WPAN_PHY, 0))
+		goto out;
+
+	n++;
+
+	if ((ifidx > 0 || wdev)
+	    ? nl802154_put_iface(&cv[n - 1], ifidx, wdev)
+	    : nl802154_put_dev(&cv[n - 1], -1, phyidx))
+		goto out;
+
+	nl802154_send_multi(cv, n, nl802154_get_raw_cb, arr);
+
+out:
+	for (i = 0; i < n; i++)
+		nl802154_free(&cv[i]);
+
+	return arr->count ? 0 : -1;
+}
+
+/* A cached wpan_dev id is only used if the interface reply names ifname */
+static int nl802154_get_raw(const char *ifname, char *buf, int *len)
+{
+	int ifidx, phyidx;
+	uint64_t wdev;
+	char *res;
+	struct nlattr *name;
+	struct nl802154_array_buf arr = { .buf = buf, .count = 0 };
+
+	*len = 0;
+
+	if (nl802154_init() < 0)
+		return -1;
+
+	nl802154_wdev_sync();
+
+	if ((wdev = nl802154_wdev_find(ifname)) != 0)
+	{
+		if (!nl802154_get_raw_idx(-1, -1, wdev, &arr) &&
+		    (name = nla_find((struct nlattr *) buf, arr.count,
+		                     NL802154_ATTR_IFNAME)) != NULL &&
+		    !nla_strcmp(name, ifname))
+		{
+			*len = arr.count;
+			return 0;
+		}
+
+		nl802154_wdev_forget(ifname);
+	}
+
+	res = nl802154_phy2ifname(ifname);
+	if (nl802154_resolve(res ? res : ifname, &ifidx, &phyidx) ||
+	    nl802154_get_raw_idx(ifidx, phyidx, 0, &arr))
+		return -1;
+
+	*len = arr.count;
+	return 0;
+}
+
+/* Decode a single field from a buffer filled by nl802154_get_raw() */
+static int nl802154_decode(const char *buf, int len, uint32_t field,
+                           struct iwpaninfo_info *info)
+{
+	int i, bit;
+	struct nlattr *tb[NL802154_ATTR_MAX + 1] = { NULL };
+	const uint8_t *attrs;
+
+	if (!field || (field & ~IWPANINFO_FIELD_ALL))
+		return -1;
+
+	bit = __builtin_ctz(field);
+	attrs = nl802154_field_attrs[bit];
+
+	for (i = 0; i < ARRAY_SIZE(nl802154_field_attrs[0]) && attrs[i]; i++)
+		tb[attrs[i]] = nla_find((struct nlattr *) buf, len, attrs[i]);
+
+	nl802154_info_parse(tb, info);
+
+	if (field == IWPANINFO_FIELD_FREQUENCY)
+		nl802154_info_frequency(info);
+
+	return (info->valid & field) ? 0 : -1;
+}
+
+static void nl802154_async_free(struct iwpaninfo_async *req)
+{
+	struct nl802154_async_state *as = req->priv;
+
+	if (as)
+	{
+		if (as->cb)
+			nl_cb_put(as->cb);
+
+		if (as->nl_sock)
+			nl_socket_free(as->nl_sock);
+
+		free(as);
+	}
+
+	req->priv = NULL;
+	req->fd = -1;
+}
+
+/*
+ * Start an info request on a socket of its own so that several requests
+ * can be in flight at once, the replies are collected by async_poll()
+ * whenever req->fd becomes readable.
+ */
+static int nl802154_async_start(const struct iwpaninfo_dev *dev,
+                                struct iwpaninfo_async *req)
+{
+	int i, n = 0, fd;
+	struct nl802154_async_state *as;
+	struct nl802154_msg_conveyor cv[2];
+
+	memset(req, 0, sizeof(*req));
+	req->fd = -1;
+
+	if (nl802154_init() < 0)
+		return -1;
+
+	as = calloc(1, sizeof(*as));
+	if (!as)
+		return -1;
+
+	req->priv = as;
+
+	as->nl_sock = nl_socket_alloc();
+	if (!as->nl_sock || genl_connect(as->nl_sock))
+		goto err;
+
+	fd = nl_socket_get_fd(as->nl_sock);
+	fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+	nl_socket_set_nonblocking(as->nl_sock);
+
+	as->cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!as->cb)
+		goto err;
+
+	nl_cb_set(as->cb, NL_CB_VALID,  NL_CB_CUSTOM, nl802154_get_info_cb, &req->info);
+	nl_cb_err(as->cb,               NL_CB_CUSTOM, nl802154_multi_error, &as->pending);
+	nl_cb_set(as->cb, NL_CB_FINISH, NL_CB_CUSTOM, nl802154_multi_done,  &as->pending);
+	nl_cb_set(as->cb, NL_CB_ACK,    NL_CB_CUSTOM, nl802154_multi_done,  &as->pending);
+
+	if (dev->ifindex > 0 || dev->wpan_dev)
+	{
+		if (nl802154_prepare(&cv[n], nls->nl802154, NL802154_CMD_GET_INTERFACE, 0))
+			goto out;
+
+		n++;
+
+		if (nl802154_put_iface(&cv[n - 1], dev->ifindex, dev->wpan_dev))
+			goto out;
+	}
+
+	if (nl802154_prepare(&cv[n], nls->nl802154, NL802154_CMD_GET_WPAN_PHY, 0))
+		goto out;
+
+	n++;
+
+	if ((dev->ifindex > 0 || dev->wpan_dev)
+	    ? nl802154_put_iface(&cv[n - 1], dev->ifindex, dev->wpan_dev)
+	    : nl802154_put_dev(&cv[n - 1], -1, dev->phy))
+		goto out;
+
+	for (i = 0; i < n; i++)
+	{
+		if (nl_send_auto_complete(as->nl_sock, cv[i].msg) < 0)
+			break;
+
+		as->pending++;
+	}
+
+out:
+	for (i = 0; i < n; i++)
+		nl802154_free(&cv[i]);
+
+	if (!as->pending)
+		goto err;
+
+	req->fd = fd;
+	return 0;
+
+err:
+	nl802154_async_free(req);
+	return -1;
+}
+
+/* Returns 1 once all replies arrived, 0 if more are pending, -1 on error */
+static int nl802154_async_poll(struct iwpaninfo_async *req)
+{
+	int err;
+	struct nl802154_async_state *as = req->priv;
+
+	if (!as)
+		return -1;
+
+	while (as->pending > 0)
+	{
+		err = nl_recvmsgs(as->nl_sock, as->cb);
+
+		if (err == -NLE_AGAIN)
+			return 0;
+
+		if (err < 0)
+			return -1;
+	}
+
+	nl802154_info_frequency(&req->info);
+
+	if (!req->info.ifname[0] && (req->info.valid & IWPANINFO_FIELD_IFINDEX))
+		if_indextoname(req->info.ifindex, req->info.ifname);
+
+	return req->info.valid ? 1 : -1;
+}
+
+static int nl802154_subscribe_cb(struct nl_msg *msg, void *arg)
+{
+	struct nl802154_group_conveyor *cv = arg;
+	struct nlattr **attr = nl802154_parse(msg);
+	struct nlattr *mgrpinfo[CTRL_ATTR_MCAST_GRP_MAX + 1];
+	struct nlattr *mgrp;
+	int mgrpidx;
+
+	if (!attr[CTRL_ATTR_MCAST_GROUPS])
+		return NL_SKIP;
+
+	nla_for_each_nested(mgrp, attr[CTRL_ATTR_MCAST_GROUPS], mgrpidx)
+	{
+		nla_parse(mgrpinfo, CTRL_ATTR_MCAST_GRP_MAX,
+		          nla_data(mgrp), nla_len(mgrp), NULL);
+
+		if (mgrpinfo[CTRL_ATTR_MCAST_GRP_ID] &&
+		    mgrpinfo[CTRL_ATTR_MCAST_GRP_NAME] &&
+		    !strncmp(nla_data(mgrpinfo[CTRL_ATTR_MCAST_GRP_NAME]),
+		             cv->name, nla_len(mgrpinfo[CTRL_ATTR_MCAST_GRP_NAME])))
+		{
+			cv->id = nla_get_u32(mgrpinfo[CTRL_ATTR_MCAST_GRP_ID]);
+			break;
+		}
+	}
+
+	return NL_SKIP;
+}
+
+static int nl802154_subscribe(const char *family, const char *group)
+{
+	struct nl802154_group_conveyor cv = { .name = group, .id = -ENOENT };
+	struct nl802154_msg_conveyor *req;
+
+	req = nl802154_ctl(CTRL_CMD_GETFAMILY, 0);
+	if (req)
+	{
+		NLA_PUT_STRING(req->msg, CTRL_ATTR_FAMILY_NAME, family);
+		nl802154_send(req, nl802154_subscribe_cb, &cv);
+
+nla_put_failure:
+		nl802154_free(req);
+	}
+
+	if (cv.id < 0)
+		return cv.id;
+
+	return nl_socket_add_membership(nls->ev_sock, cv.id);
+}
+
+static int nl802154_event_cb(struct nl_msg *msg, void *arg)
+{
+	nls->ev_count++;
+	return NL_SKIP;
+}
+
+static int nl802154_no_seq_check(struct nl_msg *msg, void *arg)
+{
+	return NL_OK;
+}
+
+/*
+ * Open a non-blocking socket subscribed to the nl802154 multicast groups
+ * and return its fd. Kernels without nl802154 notifications leave the
+ * socket silent, callers should still refresh periodically.
+ */
+static int nl802154_event_open(void)
+{
+	static const char *groups[] = { "config", "scan", "mlme" };
+	int i, fd, subscribed = 0;
+
+	if (nl802154_init() < 0)
+		return -1;
+
+	if (nls->ev_sock)
+		return nl_socket_get_fd(nls->ev_sock);
+
+	nls->ev_sock = nl_socket_alloc();
+	if (!nls->ev_sock)
+		return -1;
+
+	nls->ev_cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!nls->ev_cb || genl_connect(nls->ev_sock))
+		goto err;
+
+	fd = nl_socket_get_fd(nls->ev_sock);
+	fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+	nl_socket_set_nonblocking(nls->ev_sock);
+	nl_socket_disable_seq_check(nls->ev_sock);
+
+	nl_cb_set(nls->ev_cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, nl802154_no_seq_check, NULL);
+	nl_cb_set(nls->ev_cb, NL_CB_VALID, NL_CB_CUSTOM, nl802154_event_cb, NULL);
+
+	for (i = 0; i < ARRAY_SIZE(groups); i++)
+		if (!nl802154_subscribe(NL802154_GENL_NAME, groups[i]))
+			subscribed++;
+
+	/* without any group the fd would never become readable */
+	if (!subscribed)
+		goto err;
+
+	return fd;
+
+err:
+	if (nls->ev_cb)
+		nl_cb_put(nls->ev_cb);
+
+	nl_socket_free(nls->ev_sock);
+	nls->ev_sock = NULL;
+	nls->ev_cb = NULL;
+
+	return -1;
+}
+
+/* Drain the event socket, returns the number of notifications read */
+static int nl802154_event_read(void)
+{
+	int err;
+
+	if (!nls || !nls->ev_sock)
+		return -1;
+
+	nls->ev_count = 0;
+
+	do {
+		err = nl_recvmsgs(nls->ev_sock, nls->ev_cb);
+	} while (err >= 0);
+
+	/* phys and interfaces may have come, gone or been renamed */
+	if (nls->ev_count)
+	{
+		memset(nls->cmds, 0, sizeof(nls->cmds));
+		memset(nls->wdevs, 0, sizeof(nls->wdevs));
+	}
+
+	return (err == -NLE_AGAIN) ? nls->ev_count : -1;
+}
+
+static uint32_t nl802154_flag_bitmap(struct nlattr *nested)
+{
+	int rem;
+	uint32_t bitmap = 0;
+	struct nlattr *nla;
+
+	nla_for_each_nested(nla, nested, rem)
+		if (nla_type(nla) < 32)
+			bitmap |= (1U << nla_type(nla));
+
+	return bitmap;
+}
+
+static int nl802154_get_caps_cb(struct nl_msg *msg, void *arg)
+{
+	struct iwpaninfo_phy_caps *caps = arg;
+	struct nlattr **tb = nl802154_parse(msg);
+	struct nlattr *tb_caps[NL802154_CAP_ATTR_MAX + 1];
+	struct nlattr *nla, *nl_ch;
+	int rem, rem_ch;
+
+	if (tb[NL802154_ATTR_SUPPORTED_COMMANDS])
+		nla_for_each_nested(nla, tb[NL802154_ATTR_SUPPORTED_COMMANDS], rem)
+			iwpaninfo_command_set(caps->commands, nla_get_u32(nla));
+
+	if (!tb[NL802154_ATTR_WPAN_PHY_CAPS] ||
+	    nla_parse_nested(tb_caps, NL802154_CAP_ATTR_MAX,
+	                     tb[NL802154_ATTR_WPAN_PHY_CAPS], NULL))
+		return NL_SKIP;
+
+	if (tb_caps[NL802154_CAP_ATTR_CHANNELS])
+	{
+		nla_for_each_nested(nla, tb_caps[NL802154_CAP_ATTR_CHANNELS], rem)
+		{
+			if (nla_type(nla) >= IWPANINFO_MAX_PAGES)
+				continue;
+
+			nla_for_each_nested(nl_ch, nla, rem_ch)
+				if (nla_type(nl_ch) < 32)
+					caps->channels[nla_type(nla)] |= (1U << nla_type(nl_ch));
+		}
+	}
+
+	if (tb_caps[NL802154_CAP_ATTR_TX_POWERS])
+		nla_for_each_nested(nla, tb_caps[NL802154_CAP_ATTR_TX_POWERS], rem)
+			if (caps->num_txpowers < IWPANINFO_MAX_TXPOWERS)
+				caps->txpowers[caps->num_txpowers++] = nla_get_s32(nla);
+
+	if (tb_caps[NL802154_CAP_ATTR_CCA_ED_LEVELS])
+		nla_for_each_nested(nla, tb_caps[NL802154_CAP_ATTR_CCA_ED_LEVELS], rem)
+			if (caps->num_cca_ed_levels < IWPANINFO_MAX_CCA_ED_LEVELS)
+				caps->cca_ed_levels[caps->num_cca_ed_levels++] = nla_get_s32(nla);
+
+	if (tb_caps[NL802154_CAP_ATTR_IFTYPES])
+		caps->iftypes = nl802154_flag_bitmap(tb_caps[NL802154_CAP_ATTR_IFTYPES]);
+
+	if (tb_caps[NL802154_CAP_ATTR_CCA_MODES])
+		caps->cca_modes = nl802154_flag_bitmap(tb_caps[NL802154_CAP_ATTR_CCA_MODES]);
+
+	if (tb_caps[NL802154_CAP_ATTR_CCA_OPTS])
+		caps->cca_opts = nl802154_flag_bitmap(tb_caps[NL802154_CAP_ATTR_CCA_OPTS]);
+
+	if (tb_caps[NL802154_CAP_ATTR_MIN_MINBE])
+		caps->min_minbe = nla_get_u8(tb_caps[NL802154_CAP_ATTR_MIN_MINBE]);
+
+	if (tb_caps[NL802154_CAP_ATTR_MAX_MINBE])
+		caps->max_minbe = nla_get_u8(tb_caps[NL802154_CAP_ATTR_MAX_MINBE]);
+
+	if (tb_caps[NL802154_CAP_ATTR_MIN_MAXBE])
+		caps->min_maxbe = nla_get_u8(tb_caps[NL802154_CAP_ATTR_MIN_MAXBE]);
+
+	if (tb_caps[NL802154_CAP_ATTR_MAX_MAXBE])
+		caps->max_maxbe = nla_get_u8(tb_caps[NL802154_CAP_ATTR_MAX_MAXBE]);
+
+	if (tb_caps[NL802154_CAP_ATTR_MIN_CSMA_BACKOFFS])
+		caps->min_csma_backoffs = nla_get_u8(tb_caps[NL802154_CAP_ATTR_MIN_CSMA_BACKOFFS]);
+
+	if (tb_caps[NL802154_CAP_ATTR_MAX_CSMA_BACKOFFS])
+		caps->max_csma_backoffs = nla_get_u8(tb_caps[NL802154_CAP_ATTR_MAX_CSMA_BACKOFFS]);
+
+	if (tb_caps[NL802154_CAP_ATTR_MIN_FRAME_RETRIES])
+		caps->min_frame_retries = nla_get_s8(tb_caps[NL802154_CAP_ATTR_MIN_FRAME_RETRIES]);
+
+	if (tb_caps[NL802154_CAP_ATTR_MAX_FRAME_RETRIES])
+		caps->max_frame_retries = nla_get_s8(tb_caps[NL802154_CAP_ATTR_MAX_FRAME_RETRIES]);
+
+	if (tb_caps[NL802154_CAP_ATTR_LBT])
+		caps->lbt = nla_get_u32(tb_caps[NL802154_CAP_ATTR_LBT]);
+
+	return NL_SKIP;
+}
+
+static struct nl802154_cmd_cache * nl802154_cmd_cache_find(int ifidx, int phyidx)
+{
+	struct nl802154_cmd_cache *c;
+	int i;
+
+	for (i = 0; i < NL802154_CMD_CACHE_SIZE; i++)
+	{
+		c = &nls->cmds[i];
+
+		if (c->used && ((phyidx > -1 && c->phy == phyidx) ||
+		                (ifidx > 0 && c->ifindex == ifidx)))
+			return c;
+	}
+
+	return NULL;
+}
+
+/* Remember the command set, the oldest entry makes room for new phys */
+static void nl802154_cmd_cache_put(int ifidx, int phyidx,
+                                   const uint32_t *commands)
+{
+	struct nl802154_cmd_cache *c = nl802154_cmd_cache_find(ifidx, phyidx);
+
+	if (!c)
+	{
+		c = &nls->cmds[nls->cmds_next];
+		nls->cmds_next = (nls->cmds_next + 1) % NL802154_CMD_CACHE_SIZE;
+	}
+
+	c->used = 1;
+	c->phy = phyidx;
+	c->ifindex = ifidx;
+	memcpy(c->commands, commands, sizeof(c->commands));
+}
+
+static int nl802154_caps_idx(int ifidx, int phyidx, struct iwpaninfo_phy_caps *caps)
+{
+	int err = -1;
+	struct nl802154_msg_conveyor cv;
+
+	memset(caps, 0, sizeof(*caps));
+
+	if (nl802154_init() < 0)
+		return -1;
+
+	/* kernels before the caps attribute would just answer without it */
+	if (!nl802154_has_attr(NL802154_ATTR_WPAN_PHY_CAPS))
+		return -1;
+
+	if (nl802154_prepare(&cv, nls->nl802154, NL802154_CMD_GET_WPAN_PHY, 0))
+		return -1;
+
+	if (!nl802154_put_dev(&cv, (phyidx > -1) ? -1 : ifidx, phyidx))
+		err = nl802154_send_multi(&cv, 1, nl802154_get_caps_cb, caps);
+
+	nl802154_free(&cv);
+
+	/* the kernel always announces the supported iftypes with the caps */
+	if (err || !caps->iftypes)
+		return -1;
+
+	nl802154_cmd_cache_put(ifidx, phyidx, caps->commands);
+
+	return 0;
+}
+
+static int nl802154_get_caps(const char *ifname, struct iwpaninfo_phy_caps *caps)
+{
+	int ifidx, phyidx;
+	char *res;
+
+	res = nl802154_phy2ifname(ifname);
+	if (nl802154_resolve(res ? res : ifname, &ifidx, &phyidx))
+		return -1;
+
+	return nl802154_caps_idx(ifidx, phyidx, caps);
+}
+
+static int nl802154_dev_caps(const struct iwpaninfo_dev *dev,
+                             struct iwpaninfo_phy_caps *caps)
+{
+	/* the phy index is the upper half of the wpan_dev id */
+	if (dev->wpan_dev)
+		return nl802154_caps_idx(-1, dev->wpan_dev >> 32, caps);
+
+	return nl802154_caps_idx(dev->ifindex, dev->phy, caps);
+}
+
+/*
+ * Commands the phy announced, only the first call per phy costs a round
+ * trip. An empty set means the kernel did not announce any, not that
+ * none work.
+ */
+static int nl802154_get_commands(const char *ifname, uint32_t *commands)
+{
+	struct iwpaninfo_phy_caps caps;
+	struct nl802154_cmd_cache *c;
+	int ifidx, phyidx;
+	char *res;
+
+	if (nl802154_init() < 0)
+		return -1;
+
+	res = nl802154_phy2ifname(ifname);
+	if (nl802154_resolve(res ? res : ifname, &ifidx, &phyidx))
+		return -1;
+
+	if ((c = nl802154_cmd_cache_find(ifidx, phyidx)) != NULL)
+	{
+		memcpy(commands, c->commands, sizeof(c->commands));
+		return 0;
+	}
+
+	if (!nl802154_has_attr(NL802154_ATTR_SUPPORTED_COMMANDS))
+	{
+		memset(commands, 0, IWPANINFO_COMMAND_WORDS * sizeof(*commands));
+		return 0;
+	}
+
+	if (nl802154_caps_idx(ifidx, phyidx, &caps))
+		return -1;
+
+	memcpy(commands, caps.commands, sizeof(caps.commands));
+	return 0;
+}
+
+static int nl802154_dump_iface_cb(struct nl_msg *msg, void *arg)
+{
+	struct nl802154_array_buf *arr = arg;
+	struct iwpaninfo_info *e = arr->buf;
+
+	if ((arr->count + 1) * sizeof(*e) > IWPANINFO_BUFSIZE)
+		return NL_SKIP;
+
+	e += arr->count;
+	memset(e, 0, sizeof(*e));
+	nl802154_get_info_cb(msg, e);
+
+	if (!(e->valid & IWPANINFO_FIELD_IFINDEX))
+		return NL_SKIP;
+
+	if (!e->ifname[0])
+		if_indextoname(e->ifindex, e->ifname);
+
+	nl802154_wdev_learn(e);
+	arr->count++;
+
+	return NL_SKIP;
+}
+
+static int nl802154_dump_phy_cb(struct nl_msg *msg, void *arg)
+{
+	struct nl802154_array_buf *arr = arg;
+	struct iwpaninfo_info *e = arr->buf;
+	struct nlattr **tb = nl802154_parse(msg);
+	uint32_t phy;
+	int i;
+
+	if (!tb[NL802154_ATTR_WPAN_PHY])
+		return NL_SKIP;
+
+	phy = nla_get_u32(tb[NL802154_ATTR_WPAN_PHY]);
+
+	/* merge the phy attributes into every interface on that phy */
+	for (i = 0; i < arr->count; i++)
+		if (e[i].phy == phy)
+			nl802154_get_info_cb(msg, &e[i]);
+
+	return NL_SKIP;
+}
+
+/*
+ * Fill buf with one struct iwpaninfo_info per wpan interface using one
+ * interface dump and one phy dump, independent of the number of radios.
+ */
+static int nl802154_get_dump(char *buf, int *len)
+{
+	int i;
+	struct nl802154_msg_conveyor *req;
+	struct nl802154_array_buf arr = { .buf = buf, .count = 0 };
+	struct iwpaninfo_info *e = (struct iwpaninfo_info *) buf;
+
+	if (nl802154_init() < 0)
+		return -1;
+
+	if (!iwpaninfo_command_isset(features.dump_cmds, NL802154_CMD_GET_INTERFACE))
+		return -1;
+
+	req = nl802154_new(nls->nl802154, NL802154_CMD_GET_INTERFACE, NLM_F_DUMP);
+	if (req)
+	{
+		nl802154_send(req, nl802154_dump_iface_cb, &arr);
+		nl802154_free(req);
+	}
+
+	if (arr.count == 0)
+		return -1;
+
+	/* every kernel that dumps interfaces dumps phys as well */
+	req = nl802154_new(nls->nl802154, NL802154_CMD_GET_WPAN_PHY, NLM_F_DUMP);
+	if (req)
+	{
+		nl802154_send(req, nl802154_dump_phy_cb, &arr);
+		nl802154_free(req);
+	}
+
+	for (i = 0; i < arr.count; i++)
+		nl802154_info_frequency(&e[i]);
+
+	*len = arr.count * sizeof(struct iwpaninfo_info);
+	return 0;
+}
+
 const struct iwpaninfo_ops nl802154_ops = {
 	.name				= "nl802154",
 	.probe				= nl802154_probe,
@@ -1261,5 +2648,21 @@ const struct iwpaninfo_ops nl802154_ops = {
 	.lbt_mode			= nl802154_get_lbt_mode,
 	.cca_mode 			= nl802154_get_cca_mode,
 	.cca_opt			= nl802154_get_cca_opt,
+	.info				= nl802154_get_info,
+	.dump				= nl802154_get_dump,
+	.caps				= nl802154_get_caps,
+	.lookup				= nl802154_lookup,
+	.dev_info			= nl802154_dev_info,
+	.dev_caps			= nl802154_dev_caps,
+	.dev_query			= nl802154_dev_query,
+	.commands			= nl802154_get_commands,
+	.query				= nl802154_query,
+	.raw				= nl802154_get_raw,
+	.decode				= nl802154_decode,
+	.async_start		= nl802154_async_start,
+	.async_poll			= nl802154_async_poll,
+	.async_free			= nl802154_async_free,
+	.event_open			= nl802154_event_open,
+	.event_read			= nl802154_event_read,
 	.close				= nl802154_close
 };
@@ -38,11 +38,50 @@
 #include "iwpaninfo/utils.h"
 #include "api/nl802154.h"
 
+#define NL802154_CMD_CACHE_SIZE	8
+
+/* Supported command set announced for a phy, keyed by phy or ifindex */
+struct nl802154_cmd_cache {
+	int used;
+	int phy;
+	int ifindex;
+	uint32_t commands[IWPANINFO_COMMAND_WORDS];
+};
+
+/*
+ * What the running kernel's nl802154 family implements, the api header
+ * is only a snapshot. Probed once per process, see nl802154_features_probe().
+ */
+struct nl802154_features {
+	int probed;
+	uint32_t maxattr;
+	uint32_t cmds[IWPANINFO_COMMAND_WORDS];		/* commands the family implements */
+	uint32_t dump_cmds[IWPANINFO_COMMAND_WORDS];	/* of those, the ones that can dump */
+	uint32_t fields;	/* IWPANINFO_FIELD_* the kernel can report */
+};
+
+#define NL802154_WDEV_CACHE_SIZE	16
+
+/* wpan_dev id learned from an interface reply, keyed by interface name */
+struct nl802154_wdev_cache {
+	char ifname[IFNAMSIZ];
+	uint32_t ifindex;	/* 0 if the reply had none */
+	uint64_t wpan_dev;
+};
+
 struct nl802154_state {
 	struct nl_sock *nl_sock;
 	struct nl_cache *nl_cache;
 	struct genl_family *nl802154;
 	struct genl_family *nlctrl;
+	struct nl_sock *ev_sock;
+	struct nl_cb *ev_cb;
+	int ev_count;
+	struct nl802154_cmd_cache cmds[NL802154_CMD_CACHE_SIZE];
+	int cmds_next;
+	struct nl802154_wdev_cache wdevs[NL802154_WDEV_CACHE_SIZE];
+	int wdevs_next;
+	int listening;
 };
 
 struct nl802154_msg_conveyor {
@@ -60,6 +99,12 @@ struct nl802154_group_conveyor {
 	int id;
 };
 
+struct nl802154_async_state {
+	struct nl_sock *nl_sock;
+	struct nl_cb *cb;
+	int pending;
+};
+
 struct nl802154_array_buf {
 	void *buf;
 	int count;
@@ -0,0 +1,654 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Link statistics
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <time.h>
+#include <netlink/netlink.h>
+#include <netlink/msg.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+
+#include "iwpaninfo/rtnl.h"
+
+struct rtnl_dump_arg {
+	struct iwpaninfo_link_stats *stats;
+	int max;
+	int count;
+	int done;
+};
+
+/* like the nl802154 state, every thread talks over its own sockets */
+static __thread struct nl_sock *rtnl_sock = NULL;
+
+static int rtnl_init(void)
+{
+	if (rtnl_sock)
+		return 0;
+
+	rtnl_sock = nl_socket_alloc();
+	if (!rtnl_sock)
+		return -1;
+
+	if (nl_connect(rtnl_sock, NETLINK_ROUTE))
+	{
+		nl_socket_free(rtnl_sock);
+		rtnl_sock = NULL;
+		return -1;
+	}
+
+	fcntl(nl_socket_get_fd(rtnl_sock), F_SETFD,
+	      fcntl(nl_socket_get_fd(rtnl_sock), F_GETFD) | FD_CLOEXEC);
+
+	return 0;
+}
+
+static void iwpaninfo_registry_close(void);
+
+void iwpaninfo_rtnl_close(void)
+{
+	if (rtnl_sock)
+		nl_socket_free(rtnl_sock);
+
+	rtnl_sock = NULL;
+
+	iwpaninfo_registry_close();
+}
+
+static int rtnl_link_type(struct ifinfomsg *ifi, struct nlattr **tb)
+{
+	struct nlattr *li[IFLA_INFO_MAX + 1];
+
+	if (IWPANINFO_ARPHRD_WPAN(ifi->ifi_type))
+		return IWPANINFO_LINK_WPAN;
+
+	if (ifi->ifi_type == ARPHRD_6LOWPAN)
+		return IWPANINFO_LINK_LOWPAN;
+
+	/* older kernels report lowpan links with a generic type */
+	if (tb[IFLA_LINKINFO] &&
+	    !nla_parse_nested(li, IFLA_INFO_MAX, tb[IFLA_LINKINFO], NULL) &&
+	    li[IFLA_INFO_KIND] &&
+	    !strncmp(nla_data(li[IFLA_INFO_KIND]), "lowpan", nla_len(li[IFLA_INFO_KIND])))
+		return IWPANINFO_LINK_LOWPAN;
+
+	return -1;
+}
+
+/*
+ * Decode an RTM_NEWLINK or RTM_DELLINK message into s, returns -1 for
+ * links that are neither wpan nor lowpan.
+ */
+int iwpaninfo_rtnl_parse_link(struct nlmsghdr *hdr, struct iwpaninfo_link_stats *s)
+{
+	struct ifinfomsg *ifi = nlmsg_data(hdr);
+	struct nlattr *tb[IFLA_MAX + 1];
+	int type;
+
+	if (nlmsg_parse(hdr, sizeof(*ifi), tb, IFLA_MAX, NULL) || !tb[IFLA_IFNAME])
+		return -1;
+
+	if ((type = rtnl_link_type(ifi, tb)) < 0)
+		return -1;
+
+	memset(s, 0, sizeof(*s));
+
+	snprintf(s->ifname, sizeof(s->ifname), "%s", nla_get_string(tb[IFLA_IFNAME]));
+	s->ifindex = ifi->ifi_index;
+	s->flags = ifi->ifi_flags;
+	s->type = type;
+
+	if (tb[IFLA_LINK])
+		s->link = nla_get_u32(tb[IFLA_LINK]);
+
+	/*
+	 * Copy what the kernel sent, an older or newer struct leaves the
+	 * missing counters zero. The payload is only 4 byte aligned.
+	 */
+	if (tb[IFLA_STATS64])
+	{
+		struct rtnl_link_stats64 st;
+		int len = nla_len(tb[IFLA_STATS64]);
+
+		if (len > sizeof(st))
+			len = sizeof(st);
+
+		memset(&st, 0, sizeof(st));
+		memcpy(&st, nla_data(tb[IFLA_STATS64]), len);
+
+		s->rx_packets = st.rx_packets;
+		s->tx_packets = st.tx_packets;
+		s->rx_bytes   = st.rx_bytes;
+		s->tx_bytes   = st.tx_bytes;
+		s->rx_errors  = st.rx_errors;
+		s->tx_errors  = st.tx_errors;
+		s->rx_dropped = st.rx_dropped;
+		s->tx_dropped = st.tx_dropped;
+	}
+	else if (tb[IFLA_STATS])
+	{
+		struct rtnl_link_stats st;
+		int len = nla_len(tb[IFLA_STATS]);
+
+		if (len > sizeof(st))
+			len = sizeof(st);
+
+		memset(&st, 0, sizeof(st));
+		memcpy(&st, nla_data(tb[IFLA_STATS]), len);
+
+		s->rx_packets = st.rx_packets;
+		s->tx_packets = st.tx_packets;
+		s->rx_bytes   = st.rx_bytes;
+		s->tx_bytes   = st.tx_bytes;
+		s->rx_errors  = st.rx_errors;
+		s->tx_errors  = st.tx_errors;
+		s->rx_dropped = st.rx_dropped;
+		s->tx_dropped = st.tx_dropped;
+	}
+
+	return 0;
+}
+
+static int rtnl_link_cb(struct nl_msg *msg, void *arg)
+{
+	struct rtnl_dump_arg *a = arg;
+	struct nlmsghdr *hdr = nlmsg_hdr(msg);
+
+	if (hdr->nlmsg_type != RTM_NEWLINK || a->count >= a->max)
+		return NL_SKIP;
+
+	if (!iwpaninfo_rtnl_parse_link(hdr, &a->stats[a->count]))
+		a->count++;
+
+	return NL_SKIP;
+}
+
+static int rtnl_finish_cb(struct nl_msg *msg, void *arg)
+{
+	struct rtnl_dump_arg *a = arg;
+
+	a->done = 1;
+	return NL_STOP;
+}
+
+static int rtnl_error_cb(struct sockaddr_nl *nla, struct nlmsgerr *err, void *arg)
+{
+	struct rtnl_dump_arg *a = arg;
+
+	a->done = err->error ? err->error : -1;
+	return NL_STOP;
+}
+
+int iwpaninfo_link_stats(struct iwpaninfo_link_stats *stats, int max)
+{
+	struct rtnl_dump_arg arg = { .stats = stats, .max = max };
+	struct ifinfomsg ifi = { .ifi_family = AF_UNSPEC };
+	struct nl_msg *msg;
+	struct nl_cb *cb;
+
+	if (rtnl_init())
+		return -1;
+
+	msg = nlmsg_alloc_simple(RTM_GETLINK, NLM_F_REQUEST | NLM_F_DUMP);
+	if (!msg)
+		return -1;
+
+	cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!cb)
+	{
+		nlmsg_free(msg);
+		return -1;
+	}
+
+	if (nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) ||
+	    nl_send_auto_complete(rtnl_sock, msg) < 0)
+		goto out;
+
+	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, rtnl_link_cb, &arg);
+	nl_cb_set(cb, NL_CB_FINISH, NL_CB_CUSTOM, rtnl_finish_cb, &arg);
+	nl_cb_err(cb, NL_CB_CUSTOM, rtnl_error_cb, &arg);
+
+	while (!arg.done)
+		if (nl_recvmsgs(rtnl_sock, cb) < 0)
+			break;
+
+out:
+	nl_cb_put(cb);
+	nlmsg_free(msg);
+
+	/* a broken socket is reopened on the next call */
+	if (arg.done != 1)
+	{
+		iwpaninfo_rtnl_close();
+		return -1;
+	}
+
+	return arg.count;
+}
+
+
+static uint64_t rtnl_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Per-second rate scaled by IWPANINFO_LINK_RATE_SCALE, so a few frames a
+ * minute do not round to 0. Counters going backwards mean the link was
+ * reset, report no traffic.
+ */
+static uint64_t rtnl_rate(uint64_t cur, uint64_t prev, uint64_t ms)
+{
+	if (cur < prev)
+		return 0;
+
+	return ((cur - prev) * 1000 * IWPANINFO_LINK_RATE_SCALE + ms / 2) / ms;
+}
+
+int iwpaninfo_link_rates(struct iwpaninfo_link_rate_ctx *ctx,
+                         struct iwpaninfo_link_rate *rates, int max)
+{
+	struct iwpaninfo_link_stats cur[IWPANINFO_MAX_LINKS];
+	struct iwpaninfo_link_stats *p;
+	struct iwpaninfo_link_rate *r;
+	uint64_t now, ms;
+	int i, j, n, count = 0;
+
+	n = iwpaninfo_link_stats(cur, IWPANINFO_MAX_LINKS);
+	if (n < 0)
+		return -1;
+
+	now = rtnl_now();
+	ms = now - ctx->stamp;
+
+	for (i = 0; ctx->stamp && ms > 0 && i < n && count < max; i++)
+	{
+		for (j = 0, p = NULL; j < ctx->count; j++)
+		{
+			if (ctx->prev[j].ifindex == cur[i].ifindex)
+			{
+				p = &ctx->prev[j];
+				break;
+			}
+		}
+
+		/* links that appeared since the last sample have no rate yet */
+		if (!p)
+			continue;
+
+		r = &rates[count++];
+		memcpy(r->ifname, cur[i].ifname, sizeof(r->ifname));
+		r->ifindex    = cur[i].ifindex;
+		r->interval   = ms;
+		r->rx_packets = rtnl_rate(cur[i].rx_packets, p->rx_packets, ms);
+		r->tx_packets = rtnl_rate(cur[i].tx_packets, p->tx_packets, ms);
+		r->rx_bytes   = rtnl_rate(cur[i].rx_bytes,   p->rx_bytes,   ms);
+		r->tx_bytes   = rtnl_rate(cur[i].tx_bytes,   p->tx_bytes,   ms);
+		r->rx_errors  = rtnl_rate(cur[i].rx_errors,  p->rx_errors,  ms);
+		r->tx_errors  = rtnl_rate(cur[i].tx_errors,  p->tx_errors,  ms);
+		r->rx_dropped = rtnl_rate(cur[i].rx_dropped, p->rx_dropped, ms);
+		r->tx_dropped = rtnl_rate(cur[i].tx_dropped, p->tx_dropped, ms);
+	}
+
+	memcpy(ctx->prev, cur, n * sizeof(*cur));
+	ctx->count = n;
+	ctx->stamp = now;
+
+	return count;
+}
+
+
+/*
+ * Interface registry. Filled by one RTM_GETLINK dump on a socket that is
+ * subscribed to RTNLGRP_LINK beforehand and then kept current by draining
+ * that socket, so lookups never rescan /sys/class/net.
+ */
+
+struct registry_arg {
+	int changed;
+	int done;
+};
+
+#define REGISTRY_MAX_LISTENERS	4
+
+static __thread struct {
+	struct nl_sock *sock;
+	struct nl_cb *cb;
+	struct registry_arg arg;
+	struct iwpaninfo_netdev *devs;
+	int count;
+	int size;
+	int phys_valid;
+	int failed;
+	int dumping;
+	int updating;
+	struct {
+		iwpaninfo_registry_cb cb;
+		void *priv;
+	} listeners[REGISTRY_MAX_LISTENERS];
+} reg;
+
+/* Pass a notification, or NULL after notifications were lost, on */
+static void registry_notify(struct nlmsghdr *hdr)
+{
+	int i;
+
+	for (i = 0; i < REGISTRY_MAX_LISTENERS; i++)
+		if (reg.listeners[i].cb)
+			reg.listeners[i].cb(hdr, reg.listeners[i].priv);
+}
+
+static struct iwpaninfo_netdev * registry_lookup(uint32_t ifindex)
+{
+	int i;
+
+	for (i = 0; i < reg.count; i++)
+		if (reg.devs[i].ifindex == ifindex)
+			return &reg.devs[i];
+
+	return NULL;
+}
+
+static int registry_link_cb(struct nl_msg *msg, void *arg)
+{
+	struct registry_arg *a = arg;
+	struct nlmsghdr *hdr = nlmsg_hdr(msg);
+	struct ifinfomsg *ifi = nlmsg_data(hdr);
+	struct nlattr *tb[IFLA_MAX + 1];
+	struct iwpaninfo_netdev *dev, *p;
+
+	if (hdr->nlmsg_type != RTM_NEWLINK && hdr->nlmsg_type != RTM_DELLINK)
+		return NL_SKIP;
+
+	if (nlmsg_parse(hdr, sizeof(*ifi), tb, IFLA_MAX, NULL) || !tb[IFLA_IFNAME])
+		return NL_SKIP;
+
+	/* listeners resynchronise on their own after a dump */
+	if (!reg.dumping)
+		registry_notify(hdr);
+
+	dev = registry_lookup(ifi->ifi_index);
+
+	if (hdr->nlmsg_type == RTM_DELLINK)
+	{
+		if (dev)
+		{
+			*dev = reg.devs[--reg.count];
+			a->changed++;
+		}
+
+		return NL_SKIP;
+	}
+
+	if (!dev)
+	{
+		if (reg.count == reg.size)
+		{
+			p = realloc(reg.devs, (reg.size + 16) * sizeof(*p));
+			if (!p)
+				return NL_SKIP;
+
+			reg.devs = p;
+			reg.size += 16;
+		}
+
+		dev = &reg.devs[reg.count++];
+		dev->ifindex = ifi->ifi_index;
+		dev->phy = -1;
+
+		/* a new wpan needs its phy looked up again */
+		if (IWPANINFO_ARPHRD_WPAN(ifi->ifi_type))
+			reg.phys_valid = 0;
+	}
+
+	snprintf(dev->ifname, sizeof(dev->ifname), "%s", nla_get_string(tb[IFLA_IFNAME]));
+	dev->type = ifi->ifi_type;
+	dev->flags = ifi->ifi_flags;
+	dev->link = tb[IFLA_LINK] ? nla_get_u32(tb[IFLA_LINK]) : 0;
+	dev->master = tb[IFLA_MASTER] ? nla_get_u32(tb[IFLA_MASTER]) : 0;
+
+	a->changed++;
+
+	return NL_SKIP;
+}
+
+static int registry_finish_cb(struct nl_msg *msg, void *arg)
+{
+	struct registry_arg *a = arg;
+
+	a->done = 1;
+	return NL_STOP;
+}
+
+static int registry_no_seq_check(struct nl_msg *msg, void *arg)
+{
+	return NL_OK;
+}
+
+/* Replace the registry content with a fresh dump, blocking until done */
+static int registry_dump(void)
+{
+	struct ifinfomsg ifi = { .ifi_family = AF_UNSPEC };
+	struct nl_msg *msg;
+	int fd = nl_socket_get_fd(reg.sock);
+	int err = -1;
+
+	msg = nlmsg_alloc_simple(RTM_GETLINK, NLM_F_REQUEST | NLM_F_DUMP);
+	if (!msg)
+		return -1;
+
+	reg.count = 0;
+	reg.phys_valid = 0;
+	reg.arg.done = 0;
+	reg.dumping = 1;
+
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+	if (!nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) &&
+	    nl_send_auto_complete(reg.sock, msg) >= 0)
+	{
+		while (!reg.arg.done)
+			if (nl_recvmsgs(reg.sock, reg.cb) < 0)
+				break;
+
+		err = reg.arg.done ? 0 : -1;
+	}
+
+	nl_socket_set_nonblocking(reg.sock);
+	nlmsg_free(msg);
+
+	reg.dumping = 0;
+
+	return err;
+}
+
+static void iwpaninfo_registry_close(void)
+{
+	if (reg.cb)
+		nl_cb_put(reg.cb);
+
+	if (reg.sock)
+		nl_socket_free(reg.sock);
+
+	free(reg.devs);
+
+	reg.sock = NULL;
+	reg.cb = NULL;
+	reg.devs = NULL;
+	reg.count = reg.size = 0;
+	reg.phys_valid = reg.failed = 0;
+}
+
+static int registry_open(void)
+{
+	if (reg.failed)
+		return -1;
+
+	reg.sock = nl_socket_alloc();
+	reg.cb = nl_cb_alloc(NL_CB_DEFAULT);
+
+	if (!reg.sock || !reg.cb)
+		goto err;
+
+	nl_socket_disable_seq_check(reg.sock);
+	nl_cb_set(reg.cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, registry_no_seq_check, NULL);
+	nl_cb_set(reg.cb, NL_CB_VALID, NL_CB_CUSTOM, registry_link_cb, &reg.arg);
+	nl_cb_set(reg.cb, NL_CB_FINISH, NL_CB_CUSTOM, registry_finish_cb, &reg.arg);
+
+	/* subscribe first so no change can slip in before the dump */
+	if (nl_connect(reg.sock, NETLINK_ROUTE) ||
+	    nl_socket_add_membership(reg.sock, RTNLGRP_LINK))
+		goto err;
+
+	fcntl(nl_socket_get_fd(reg.sock), F_SETFD,
+	      fcntl(nl_socket_get_fd(reg.sock), F_GETFD) | FD_CLOEXEC);
+
+	if (registry_dump())
+		goto err;
+
+	return 0;
+
+err:
+	iwpaninfo_registry_close();
+
+	/* do not retry on every lookup, callers fall back to the old paths */
+	reg.failed = 1;
+
+	return -1;
+}
+
+int iwpaninfo_registry_fd(void)
+{
+	if (!reg.sock && registry_open())
+		return -1;
+
+	return nl_socket_get_fd(reg.sock);
+}
+
+int iwpaninfo_registry_update(void)
+{
+	int err;
+
+	if (!reg.sock && registry_open())
+		return -1;
+
+	/* a listener looking something up while we drain sees the old state */
+	if (reg.updating)
+		return 0;
+
+	reg.updating = 1;
+	reg.arg.changed = 0;
+
+	do {
+		err = nl_recvmsgs(reg.sock, reg.cb);
+	} while (err >= 0);
+
+	/* notifications were lost to a socket overrun, start over */
+	if (err == -NLE_NOMEM)
+	{
+		err = registry_dump() ? -1 : reg.count;
+		registry_notify(NULL);
+	}
+	else
+	{
+		err = (err == -NLE_AGAIN) ? reg.arg.changed : -1;
+	}
+
+	reg.updating = 0;
+
+	return err;
+}
+
+int iwpaninfo_registry_listen(iwpaninfo_registry_cb cb, void *priv)
+{
+	int i;
+
+	if (!reg.sock && registry_open())
+		return -1;
+
+	for (i = 0; i < REGISTRY_MAX_LISTENERS; i++)
+	{
+		if (!reg.listeners[i].cb)
+		{
+			reg.listeners[i].cb = cb;
+			reg.listeners[i].priv = priv;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+void iwpaninfo_registry_unlisten(iwpaninfo_registry_cb cb, void *priv)
+{
+	int i;
+
+	for (i = 0; i < REGISTRY_MAX_LISTENERS; i++)
+		if (reg.listeners[i].cb == cb && reg.listeners[i].priv == priv)
+			reg.listeners[i].cb = NULL;
+}
+
+const struct iwpaninfo_netdev * iwpaninfo_registry_find(const char *ifname)
+{
+	int i;
+
+	for (i = 0; i < reg.count; i++)
+		if (!strncmp(reg.devs[i].ifname, ifname, IFNAMSIZ))
+			return &reg.devs[i];
+
+	return NULL;
+}
+
+const struct iwpaninfo_netdev * iwpaninfo_registry_find_index(uint32_t ifindex)
+{
+	return registry_lookup(ifindex);
+}
+
+/* The wpan with the lowest ifindex on phy, like the old sysfs scan */
+const struct iwpaninfo_netdev * iwpaninfo_registry_find_phy(int phy)
+{
+	struct iwpaninfo_info info[IWPANINFO_MAX_LINKS];
+	struct iwpaninfo_netdev *dev, *best = NULL;
+	int i, n;
+
+	/* rtnetlink does not carry the phy, take it from one nl802154 dump */
+	if (!reg.phys_valid)
+	{
+		n = iwpaninfo_get_dump_live(info, IWPANINFO_MAX_LINKS);
+
+		for (i = 0; i < n; i++)
+			if ((info[i].valid & IWPANINFO_FIELD_PHY) &&
+			    (dev = registry_lookup(info[i].ifindex)) != NULL)
+				dev->phy = info[i].phy;
+
+		reg.phys_valid = (n >= 0);
+	}
+
+	for (i = 0; i < reg.count; i++)
+	{
+		dev = &reg.devs[i];
+
+		if (IWPANINFO_ARPHRD_WPAN(dev->type) && dev->phy == phy &&
+		    (!best || dev->ifindex < best->ifindex))
+			best = dev;
+	}
+
+	return best;
+}
@@ -0,0 +1,250 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Shared memory snapshot
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <time.h>
+#include <sys/stat.h>
+
+#include "iwpaninfo/shm.h"
+
+/* give up on a segment whose writer keeps it odd, e.g. died mid-update */
+#define IWPANINFO_SHM_RETRIES	64
+
+/*
+ * The mapping is kept while its segment is stale, the writer may resume.
+ * Only once per publish interval the name is opened again to find out
+ * whether a restarted writer created a new segment in the meantime.
+ * Each thread keeps its own mapping, reads need no lock.
+ */
+static __thread const struct iwpaninfo_shm *shm_map = NULL;
+static __thread ino_t shm_ino;
+static __thread uint64_t shm_retry = 0;	/* no new probe before, ms */
+
+static uint64_t iwpaninfo_shm_now(void)
+{
+	struct timespec ts;
+
+	/* served from the vDSO, no syscall */
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+struct iwpaninfo_shm * iwpaninfo_shm_create(uint32_t interval)
+{
+	struct iwpaninfo_shm *shm;
+	int fd;
+
+	fd = shm_open(IWPANINFO_SHM_NAME, O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+		return NULL;
+
+	if (ftruncate(fd, sizeof(*shm)))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	shm = mmap(NULL, sizeof(*shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (shm == MAP_FAILED)
+		return NULL;
+
+	/* invalidate for readers still mapping an older segment */
+	shm->magic = 0;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	shm->version = IWPANINFO_SHM_VERSION;
+	shm->abi = IWPANINFO_ABI_VERSION;
+	shm->interval = interval;
+	shm->seq = 0;
+	shm->updated = 0;
+	shm->count = 0;
+	shm->total = 0;
+
+	__atomic_store_n(&shm->magic, IWPANINFO_SHM_MAGIC, __ATOMIC_RELEASE);
+
+	return shm;
+}
+
+void iwpaninfo_shm_publish(struct iwpaninfo_shm *shm,
+                           const struct iwpaninfo_info *info, int count,
+                           int total)
+{
+	uint32_t seq = shm->seq;
+
+	if (count < 0)
+		count = 0;
+	else if (count > IWPANINFO_SHM_MAX_IFACES)
+		count = IWPANINFO_SHM_MAX_IFACES;
+
+	if (total < count)
+		total = count;
+
+	__atomic_store_n(&shm->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	memcpy(shm->info, info, count * sizeof(*info));
+	shm->count = count;
+	shm->total = total;
+	shm->updated = iwpaninfo_shm_now();
+
+	__atomic_store_n(&shm->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void iwpaninfo_shm_destroy(struct iwpaninfo_shm *shm)
+{
+	shm_unlink(IWPANINFO_SHM_NAME);
+	munmap(shm, sizeof(*shm));
+}
+
+static int iwpaninfo_shm_fresh(const struct iwpaninfo_shm *shm)
+{
+	if (__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != IWPANINFO_SHM_MAGIC ||
+	    shm->version != IWPANINFO_SHM_VERSION ||
+	    shm->abi != IWPANINFO_ABI_VERSION)
+		return 0;
+
+	return shm->updated &&
+	       iwpaninfo_shm_now() - shm->updated <=
+	       (uint64_t)shm->interval * IWPANINFO_SHM_STALE;
+}
+
+static const struct iwpaninfo_shm * iwpaninfo_shm_attach(void)
+{
+	const struct iwpaninfo_shm *shm;
+	uint64_t now;
+	struct stat st;
+	int fd;
+
+	if (shm_map && iwpaninfo_shm_fresh(shm_map))
+		return shm_map;
+
+	/* absent or stale, readers fall back to netlink until the next probe */
+	now = iwpaninfo_shm_now();
+	if (now < shm_retry)
+		return NULL;
+
+	shm_retry = now + IWPANINFO_SHM_INTERVAL;
+
+	fd = shm_open(IWPANINFO_SHM_NAME, O_RDONLY, 0);
+	if (fd < 0)
+		return NULL;
+
+	/* same segment as mapped, its writer just stopped publishing */
+	if (fstat(fd, &st) || st.st_size < (off_t)sizeof(*shm) ||
+	    (shm_map && st.st_ino == shm_ino))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	shm = mmap(NULL, sizeof(*shm), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (shm == MAP_FAILED)
+		return NULL;
+
+	if (shm_map)
+		munmap((void *)shm_map, sizeof(*shm_map));
+
+	shm_map = shm;
+	shm_ino = st.st_ino;
+
+	return iwpaninfo_shm_fresh(shm) ? shm : NULL;
+}
+
+void iwpaninfo_shm_detach(void)
+{
+	if (shm_map)
+		munmap((void *)shm_map, sizeof(*shm_map));
+
+	shm_map = NULL;
+	shm_retry = 0;
+}
+
+/*
+ * Copy the entry named ifname (or all when NULL) into info from a
+ * consistent snapshot. Returns the number copied for a name and the
+ * number the publisher saw for all, or -1.
+ */
+static int iwpaninfo_shm_copy(const char *ifname,
+                              struct iwpaninfo_info *info, int max)
+{
+	const struct iwpaninfo_shm *shm = iwpaninfo_shm_attach();
+	uint32_t seq, count, total;
+	int i, n, tries;
+
+	if (!shm)
+		return -1;
+
+	for (tries = 0; tries < IWPANINFO_SHM_RETRIES; tries++)
+	{
+		seq = __atomic_load_n(&shm->seq, __ATOMIC_ACQUIRE);
+
+		if (seq & 1)
+			continue;
+
+		/* went stale since attach, the mapping stays for the next probe */
+		if (!iwpaninfo_shm_fresh(shm))
+			return -1;
+
+		count = shm->count;
+		if (count > IWPANINFO_SHM_MAX_IFACES)
+			count = IWPANINFO_SHM_MAX_IFACES;
+
+		total = shm->total;
+		n = 0;
+
+		if (ifname)
+		{
+			for (i = 0; i < count; i++)
+			{
+				if (!strncmp(shm->info[i].ifname, ifname, IFNAMSIZ))
+				{
+					memcpy(info, &shm->info[i], sizeof(*info));
+					n = 1;
+					break;
+				}
+			}
+		}
+		else
+		{
+			n = (count < max) ? count : max;
+			memcpy(info, shm->info, n * sizeof(*info));
+		}
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (__atomic_load_n(&shm->seq, __ATOMIC_RELAXED) == seq)
+			return (ifname || total < n) ? n : total;
+	}
+
+	return -1;
+}
+
+int iwpaninfo_shm_read(struct iwpaninfo_info *info, int max)
+{
+	return iwpaninfo_shm_copy(NULL, info, max);
+}
+
+int iwpaninfo_shm_get_info(const char *ifname, struct iwpaninfo_info *info)
+{
+	/* an interface missing from a fresh table is left to the backends */
+	return (iwpaninfo_shm_copy(ifname, info, 1) == 1) ? 0 : -1;
+}
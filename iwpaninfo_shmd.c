@@ -0,0 +1,167 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Shared memory publisher
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ *
+ *
+ * Publishes the device table into the shared memory segment read by
+ * iwpaninfo_get_info() and iwpaninfo_get_dump(). The table is rewritten
+ * every interval and immediately after an nl802154 notification, each
+ * rewrite also appends to the metric history shown by iwpaninfo history.
+ */
+
+#include <poll.h>
+#include <signal.h>
+
+#include "iwpaninfo.h"
+
+static volatile sig_atomic_t running = 1;
+
+static void handle_signal(int sig)
+{
+	running = 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage:\n"
+		"	%s [-i <interval ms>] [-m <metric>=<bytes> ...]\n",
+		prog);
+}
+
+/* Parse "<metric>=<bytes>" into the ring size table */
+static int parse_ring_size(const char *arg, uint32_t *sizes)
+{
+	char name[32];
+	unsigned int bytes;
+	int metric;
+
+	if (sscanf(arg, "%31[^=]=%u", name, &bytes) != 2)
+		return -1;
+
+	metric = iwpaninfo_metric_by_name(name);
+	if (metric < 0 || bytes > IWPANINFO_HISTORY_MAX_RING)
+		return -1;
+
+	sizes[metric] = bytes;
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct iwpaninfo_info info[IWPANINFO_SHM_MAX_IFACES];
+	struct iwpaninfo_link_stats links[IWPANINFO_MAX_LINKS];
+	struct iwpaninfo_shm *shm;
+	struct iwpaninfo_history *hist;
+	const struct iwpaninfo_ops *ops;
+	struct pollfd pfd = { .fd = -1, .events = POLLIN };
+	uint32_t sizes[IWPANINFO_METRIC_COUNT];
+	int ch, i, n, m, interval = IWPANINFO_SHM_INTERVAL, truncated = 0;
+	uint32_t hist_dropped = 0;
+
+	for (i = 0; i < IWPANINFO_METRIC_COUNT; i++)
+		sizes[i] = (i >= IWPANINFO_METRIC_RX_PACKETS)
+			? IWPANINFO_HISTORY_COUNTER_SIZE : IWPANINFO_HISTORY_SETTING_SIZE;
+
+	while ((ch = getopt(argc, argv, "i:m:")) != -1)
+	{
+		switch (ch)
+		{
+		case 'i':
+			interval = atoi(optarg);
+			if (interval <= 0)
+				interval = IWPANINFO_SHM_INTERVAL;
+			break;
+
+		case 'm':
+			if (parse_ring_size(optarg, sizes))
+			{
+				fprintf(stderr, "Invalid ring size: %s\n", optarg);
+				return 1;
+			}
+			break;
+
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	ops = iwpaninfo_backend_by_name("nl802154");
+	if (!ops)
+	{
+		fprintf(stderr, "No nl802154 backend available\n");
+		return 1;
+	}
+
+	shm = iwpaninfo_shm_create(interval);
+	if (!shm)
+	{
+		fprintf(stderr, "Cannot create shared memory segment: %s\n",
+		        strerror(errno));
+		return 1;
+	}
+
+	/* history is optional, the device table is published regardless */
+	hist = iwpaninfo_history_create(sizes);
+	if (!hist)
+		fprintf(stderr, "Cannot create history segment: %s\n",
+		        strerror(errno));
+
+	signal(SIGINT, handle_signal);
+	signal(SIGTERM, handle_signal);
+
+	if (ops->event_open)
+		pfd.fd = ops->event_open();
+
+	while (running)
+	{
+		n = iwpaninfo_get_dump_live(info, IWPANINFO_SHM_MAX_IFACES);
+		iwpaninfo_shm_publish(shm, info, n, iwpaninfo_dump_total());
+
+		if (iwpaninfo_dump_total() > n && !truncated)
+			fprintf(stderr, "Publishing %d of %d interfaces, table is full\n",
+			        n, iwpaninfo_dump_total());
+
+		truncated = (iwpaninfo_dump_total() > n);
+
+		if (hist)
+		{
+			m = iwpaninfo_link_stats(links, IWPANINFO_MAX_LINKS);
+			iwpaninfo_history_record(hist, info, n, links, (m > 0) ? m : 0);
+
+			if (hist->dropped && !hist_dropped)
+				fprintf(stderr, "History is full, %u interfaces not recorded\n",
+				        hist->dropped);
+
+			hist_dropped = hist->dropped;
+		}
+
+		/* a negative fd is ignored by poll(), which then just sleeps */
+		if (poll(&pfd, 1, interval) > 0 && ops->event_read() < 0)
+			pfd.fd = -1;
+	}
+
+	/* unlink so readers fall back to netlink right away */
+	iwpaninfo_shm_destroy(shm);
+
+	if (hist)
+		iwpaninfo_history_destroy(hist);
+
+	iwpaninfo_finish();
+
+	return 0;
+}
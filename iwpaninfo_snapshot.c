@@ -0,0 +1,395 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Snapshots and diffs
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ *
+ *
+ * Snapshots are stored as text, one "iface <name>" line per interface
+ * followed by indented "<field> <value>" lines for its valid fields and
+ * the phy name:
+ *
+ *	iface wpan0
+ *		phyname phy0
+ *		channel 11
+ *		panid 0xabcd
+ *
+ * Field names are those of IWPANINFO_FIELD_NAMES, unknown names are
+ * skipped so older readers can load files written by newer versions.
+ */
+
+#include <inttypes.h>
+
+#include "iwpaninfo/snapshot.h"
+
+/* Identifiers rather than quantities, written in hex */
+#define SNAPSHOT_HEX_FIELDS \
+	(IWPANINFO_FIELD_WPAN_DEV | IWPANINFO_FIELD_PANID | \
+	 IWPANINFO_FIELD_SHORT_ADDR | IWPANINFO_FIELD_EXTENDED_ADDR)
+
+int64_t iwpaninfo_info_field_get(const struct iwpaninfo_info *info,
+                                 uint32_t field)
+{
+	switch (field)
+	{
+	case IWPANINFO_FIELD_IFINDEX:
+		return info->ifindex;
+	case IWPANINFO_FIELD_PHY:
+		return info->phy;
+	case IWPANINFO_FIELD_WPAN_DEV:
+		return info->wpan_dev;
+	case IWPANINFO_FIELD_MODE:
+		return info->mode;
+	case IWPANINFO_FIELD_PAGE:
+		return info->page;
+	case IWPANINFO_FIELD_CHANNEL:
+		return info->channel;
+	case IWPANINFO_FIELD_FREQUENCY:
+		return info->frequency;
+	case IWPANINFO_FIELD_TXPOWER:
+		return info->txpower;
+	case IWPANINFO_FIELD_PANID:
+		return info->panid;
+	case IWPANINFO_FIELD_SHORT_ADDR:
+		return info->short_address;
+	case IWPANINFO_FIELD_EXTENDED_ADDR:
+		return info->extended_address;
+	case IWPANINFO_FIELD_MIN_BE:
+		return info->min_be;
+	case IWPANINFO_FIELD_MAX_BE:
+		return info->max_be;
+	case IWPANINFO_FIELD_CSMA_BACKOFF:
+		return info->csma_backoff;
+	case IWPANINFO_FIELD_FRAME_RETRY:
+		return info->frame_retry;
+	case IWPANINFO_FIELD_LBT_MODE:
+		return info->lbt_mode;
+	case IWPANINFO_FIELD_CCA_MODE:
+		return info->cca_mode;
+	case IWPANINFO_FIELD_CCA_OPT:
+		return info->cca_opt;
+	case IWPANINFO_FIELD_CCA_ED_LEVEL:
+		return info->cca_ed_level;
+	}
+
+	return 0;
+}
+
+int iwpaninfo_info_field_set(struct iwpaninfo_info *info, uint32_t field,
+                             int64_t val)
+{
+	switch (field)
+	{
+	case IWPANINFO_FIELD_IFINDEX:
+		info->ifindex = val;
+		break;
+	case IWPANINFO_FIELD_PHY:
+		info->phy = val;
+		break;
+	case IWPANINFO_FIELD_WPAN_DEV:
+		info->wpan_dev = val;
+		break;
+	case IWPANINFO_FIELD_MODE:
+		/* used as an index into IWPANINFO_OPMODE_NAMES */
+		if (val < 0 || val > IWPANINFO_OPMODE_UNKNOWN)
+			return -1;
+		info->mode = val;
+		break;
+	case IWPANINFO_FIELD_PAGE:
+		info->page = val;
+		break;
+	case IWPANINFO_FIELD_CHANNEL:
+		info->channel = val;
+		break;
+	case IWPANINFO_FIELD_FREQUENCY:
+		info->frequency = val;
+		break;
+	case IWPANINFO_FIELD_TXPOWER:
+		info->txpower = val;
+		break;
+	case IWPANINFO_FIELD_PANID:
+		info->panid = val;
+		break;
+	case IWPANINFO_FIELD_SHORT_ADDR:
+		info->short_address = val;
+		break;
+	case IWPANINFO_FIELD_EXTENDED_ADDR:
+		info->extended_address = val;
+		break;
+	case IWPANINFO_FIELD_MIN_BE:
+		info->min_be = val;
+		break;
+	case IWPANINFO_FIELD_MAX_BE:
+		info->max_be = val;
+		break;
+	case IWPANINFO_FIELD_CSMA_BACKOFF:
+		info->csma_backoff = val;
+		break;
+	case IWPANINFO_FIELD_FRAME_RETRY:
+		info->frame_retry = val;
+		break;
+	case IWPANINFO_FIELD_LBT_MODE:
+		info->lbt_mode = val;
+		break;
+	case IWPANINFO_FIELD_CCA_MODE:
+		info->cca_mode = val;
+		break;
+	case IWPANINFO_FIELD_CCA_OPT:
+		info->cca_opt = val;
+		break;
+	case IWPANINFO_FIELD_CCA_ED_LEVEL:
+		info->cca_ed_level = val;
+		break;
+	default:
+		return -1;
+	}
+
+	info->valid |= field;
+	return 0;
+}
+
+int iwpaninfo_info_field_format(uint32_t field, int64_t val, char *buf, int len)
+{
+	if (field & SNAPSHOT_HEX_FIELDS)
+		return snprintf(buf, len, "0x%" PRIx64, (uint64_t)val);
+
+	return snprintf(buf, len, "%" PRId64, val);
+}
+
+static uint32_t snapshot_field_by_name(const char *name)
+{
+	int i;
+
+	for (i = 0; i < IWPANINFO_FIELD_COUNT; i++)
+		if (!strcmp(IWPANINFO_FIELD_NAMES[i], name))
+			return 1 << i;
+
+	return 0;
+}
+
+/* Interfaces are identified by name, phys without one by phy name */
+static const char * snapshot_key(const struct iwpaninfo_info *info)
+{
+	return info->ifname[0] ? info->ifname : info->phyname;
+}
+
+static int snapshot_find(const struct iwpaninfo_snapshot *s, const char *key)
+{
+	int i;
+
+	for (i = 0; i < s->count; i++)
+		if (!strcmp(snapshot_key(&s->info[i]), key))
+			return i;
+
+	return -1;
+}
+
+int iwpaninfo_snapshot_take(struct iwpaninfo_snapshot *s)
+{
+	int n = iwpaninfo_get_dump(s->info, IWPANINFO_MAX_IFACES);
+
+	s->count = (n > 0) ? n : 0;
+	s->dropped = (n > 0) ? iwpaninfo_dump_total() - n : 0;
+
+	return (n < 0) ? -1 : 0;
+}
+
+int iwpaninfo_snapshot_save(const struct iwpaninfo_snapshot *s, FILE *f)
+{
+	const struct iwpaninfo_info *info;
+	uint32_t field;
+	char buf[32];
+	int i;
+
+	fprintf(f, "# iwpaninfo snapshot\n");
+
+	for (i = 0; i < s->count; i++)
+	{
+		info = &s->info[i];
+
+		fprintf(f, "iface %s\n", snapshot_key(info));
+
+		if (info->phyname[0])
+			fprintf(f, "\tphyname %s\n", info->phyname);
+
+		for (field = 1; field & IWPANINFO_FIELD_ALL; field <<= 1)
+		{
+			if (!(info->valid & field))
+				continue;
+
+			iwpaninfo_info_field_format(field,
+				iwpaninfo_info_field_get(info, field), buf, sizeof(buf));
+
+			fprintf(f, "\t%s %s\n",
+			        IWPANINFO_FIELD_NAMES[__builtin_ctz(field)], buf);
+		}
+	}
+
+	return ferror(f) ? -1 : 0;
+}
+
+int iwpaninfo_snapshot_load(struct iwpaninfo_snapshot *s, FILE *f)
+{
+	struct iwpaninfo_info *cur = NULL;
+	char line[128], key[32], val[64], *end;
+	uint32_t field;
+	int64_t v;
+	int n;
+
+	s->count = 0;
+	s->dropped = 0;
+
+	while (fgets(line, sizeof(line), f))
+	{
+		n = sscanf(line, "%31s %63s", key, val);
+
+		if (n < 1 || key[0] == '#')
+			continue;
+
+		if (n != 2)
+			return -1;
+
+		if (!strcmp(key, "iface"))
+		{
+			if (strlen(val) >= sizeof(cur->ifname))
+				return -1;
+
+			/* a full table skips the interface and its fields */
+			if (s->count >= IWPANINFO_MAX_IFACES)
+			{
+				s->dropped++;
+				cur = NULL;
+				continue;
+			}
+
+			cur = &s->info[s->count++];
+			memset(cur, 0, sizeof(*cur));
+			strcpy(cur->ifname, val);
+			continue;
+		}
+
+		if (!cur)
+		{
+			if (s->count < IWPANINFO_MAX_IFACES)
+				return -1;
+
+			continue;
+		}
+
+		if (!strcmp(key, "phyname"))
+		{
+			if (strlen(val) >= sizeof(cur->phyname))
+				return -1;
+
+			strcpy(cur->phyname, val);
+			continue;
+		}
+
+		field = snapshot_field_by_name(key);
+		if (!field)
+			continue;
+
+		v = (val[0] == '-') ? strtoll(val, &end, 0)
+		                    : (int64_t)strtoull(val, &end, 0);
+
+		if (*end || iwpaninfo_info_field_set(cur, field, v))
+			return -1;
+	}
+
+	return ferror(f) ? -1 : 0;
+}
+
+static void snapshot_change(struct iwpaninfo_change *c, int type,
+                            uint32_t field, const char *key,
+                            const struct iwpaninfo_info *a,
+                            const struct iwpaninfo_info *b)
+{
+	memset(c, 0, sizeof(*c));
+	snprintf(c->ifname, sizeof(c->ifname), "%s", key);
+	c->type = type;
+	c->field = field;
+
+	if (a && (a->valid & field))
+	{
+		c->old_valid = 1;
+		c->old_value = iwpaninfo_info_field_get(a, field);
+	}
+
+	if (b && (b->valid & field))
+	{
+		c->new_valid = 1;
+		c->new_value = iwpaninfo_info_field_get(b, field);
+	}
+}
+
+int iwpaninfo_snapshot_diff(const struct iwpaninfo_snapshot *a,
+                            const struct iwpaninfo_snapshot *b,
+                            struct iwpaninfo_change *changes, int max)
+{
+	const struct iwpaninfo_info *old, *new;
+	const char *key;
+	uint32_t field, mask;
+	int i, j, n = 0;
+
+	if (a->count < 0 || b->count < 0)
+		return -1;
+
+	for (i = 0; i < b->count; i++)
+	{
+		new = &b->info[i];
+		key = snapshot_key(new);
+		j = snapshot_find(a, key);
+		old = (j < 0) ? NULL : &a->info[j];
+
+		if (old)
+		{
+			mask = iwpaninfo_info_changed(old, new);
+		}
+		else
+		{
+			if (n < max)
+				snapshot_change(&changes[n], IWPANINFO_CHANGE_ADDED, 0,
+				                key, NULL, NULL);
+			n++;
+
+			mask = new->valid;
+		}
+
+		for (field = 1; field & IWPANINFO_FIELD_ALL; field <<= 1)
+		{
+			if (!(mask & field))
+				continue;
+
+			if (n < max)
+				snapshot_change(&changes[n], IWPANINFO_CHANGE_FIELD, field,
+				                key, old, new);
+			n++;
+		}
+	}
+
+	for (i = 0; i < a->count; i++)
+	{
+		key = snapshot_key(&a->info[i]);
+
+		if (snapshot_find(b, key) >= 0)
+			continue;
+
+		if (n < max)
+			snapshot_change(&changes[n], IWPANINFO_CHANGE_REMOVED, 0,
+			                key, NULL, NULL);
+		n++;
+	}
+
+	return n;
+}
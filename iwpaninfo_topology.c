@@ -0,0 +1,305 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Interface topology
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <netlink/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include "iwpaninfo/topology.h"
+
+static void topo_add_phy(struct iwpaninfo_topology *t,
+                         const struct iwpaninfo_info *info)
+{
+	int i;
+
+	if (!(info->valid & IWPANINFO_FIELD_PHY))
+		return;
+
+	for (i = 0; i < t->num_phys; i++)
+		if (t->phys[i].phy == info->phy)
+			return;
+
+	if (t->num_phys >= IWPANINFO_MAX_IFACES)
+	{
+		t->dropped++;
+		return;
+	}
+
+	t->phys[t->num_phys].phy = info->phy;
+	memcpy(t->phys[t->num_phys].phyname, info->phyname,
+	       sizeof(t->phys[t->num_phys].phyname));
+	t->num_phys++;
+}
+
+/* Drop phys that no longer carry a wpan interface */
+static void topo_prune_phys(struct iwpaninfo_topology *t)
+{
+	int i, j;
+
+	for (i = 0; i < t->num_phys; )
+	{
+		for (j = 0; j < t->num_wpans; j++)
+			if ((t->wpans[j].info.valid & IWPANINFO_FIELD_PHY) &&
+			    t->wpans[j].info.phy == t->phys[i].phy)
+				break;
+
+		if (j < t->num_wpans)
+			i++;
+		else
+			t->phys[i] = t->phys[--t->num_phys];
+	}
+}
+
+static void topo_set_lowpan(struct iwpaninfo_topo_lowpan *l,
+                            const struct iwpaninfo_link_stats *s)
+{
+	memcpy(l->ifname, s->ifname, sizeof(l->ifname));
+	l->ifindex = s->ifindex;
+	l->link = s->link;
+	l->flags = s->flags;
+}
+
+int iwpaninfo_topology_build(struct iwpaninfo_topology *t)
+{
+	struct iwpaninfo_info info[IWPANINFO_MAX_IFACES];
+	struct iwpaninfo_link_stats links[IWPANINFO_MAX_LINKS];
+	int i, j, n, m;
+
+	n = iwpaninfo_get_dump_live(info, IWPANINFO_MAX_IFACES);
+	m = iwpaninfo_link_stats(links, IWPANINFO_MAX_LINKS);
+
+	if (m < 0)
+		return -1;
+
+	t->num_phys = t->num_wpans = t->num_lowpans = 0;
+	t->dropped = (n > 0) ? iwpaninfo_dump_total() - n : 0;
+
+	for (i = 0; i < n; i++)
+	{
+		t->wpans[t->num_wpans].info = info[i];
+		t->wpans[t->num_wpans].flags = 0;
+		t->wpans[t->num_wpans].pending = 0;
+
+		for (j = 0; j < m; j++)
+			if (links[j].ifindex == info[i].ifindex)
+				t->wpans[t->num_wpans].flags = links[j].flags;
+
+		topo_add_phy(t, &info[i]);
+		t->num_wpans++;
+	}
+
+	for (j = 0; j < m; j++)
+	{
+		if (links[j].type != IWPANINFO_LINK_LOWPAN)
+			continue;
+
+		if (t->num_lowpans >= IWPANINFO_MAX_IFACES)
+			t->dropped++;
+		else
+			topo_set_lowpan(&t->lowpans[t->num_lowpans++], &links[j]);
+	}
+
+	return 0;
+}
+
+static int topo_wpan_event(struct iwpaninfo_topology *t, int del,
+                           const struct iwpaninfo_link_stats *s)
+{
+	struct iwpaninfo_topo_wpan *w;
+	int i;
+
+	for (i = 0; i < t->num_wpans; i++)
+		if (t->wpans[i].info.ifindex == s->ifindex)
+			break;
+
+	if (del)
+	{
+		if (i == t->num_wpans)
+			return 0;
+
+		del = !t->wpans[i].pending;
+		t->wpans[i] = t->wpans[--t->num_wpans];
+		topo_prune_phys(t);
+		return del;
+	}
+
+	if (i < t->num_wpans)
+	{
+		/* up/down or rename, the nl802154 state is unaffected */
+		w = &t->wpans[i];
+		w->flags = s->flags;
+		memcpy(w->info.ifname, s->ifname, sizeof(w->info.ifname));
+		return 1;
+	}
+
+	if (t->num_wpans >= IWPANINFO_MAX_IFACES)
+	{
+		t->dropped++;
+		return 0;
+	}
+
+	/*
+	 * a new interface is the only event that costs an nl802154 query,
+	 * it runs once the registry has been drained
+	 */
+	w = &t->wpans[t->num_wpans++];
+	memset(&w->info, 0, sizeof(w->info));
+	memcpy(w->info.ifname, s->ifname, sizeof(w->info.ifname));
+	w->info.ifindex = s->ifindex;
+	w->flags = s->flags;
+	w->pending = 1;
+
+	return 0;
+}
+
+static int topo_lowpan_event(struct iwpaninfo_topology *t, int del,
+                             const struct iwpaninfo_link_stats *s)
+{
+	int i;
+
+	for (i = 0; i < t->num_lowpans; i++)
+		if (t->lowpans[i].ifindex == s->ifindex)
+			break;
+
+	if (del)
+	{
+		if (i == t->num_lowpans)
+			return 0;
+
+		t->lowpans[i] = t->lowpans[--t->num_lowpans];
+		return 1;
+	}
+
+	if (i == t->num_lowpans)
+	{
+		if (t->num_lowpans >= IWPANINFO_MAX_IFACES)
+		{
+			t->dropped++;
+			return 0;
+		}
+
+		t->num_lowpans++;
+	}
+
+	topo_set_lowpan(&t->lowpans[i], s);
+
+	return 1;
+}
+
+static void topo_registry_cb(struct nlmsghdr *hdr, void *priv)
+{
+	struct iwpaninfo_topology *t = priv;
+	struct iwpaninfo_link_stats s;
+	int del;
+
+	if (!hdr)
+	{
+		t->resync = 1;
+		return;
+	}
+
+	if (iwpaninfo_rtnl_parse_link(hdr, &s))
+		return;
+
+	del = (hdr->nlmsg_type == RTM_DELLINK);
+
+	if (s.type == IWPANINFO_LINK_WPAN)
+		t->changed += topo_wpan_event(t, del, &s);
+	else
+		t->changed += topo_lowpan_event(t, del, &s);
+}
+
+/* Query the wpans the registry announced since the last call */
+static void topo_resolve(struct iwpaninfo_topology *t)
+{
+	struct iwpaninfo_topo_wpan *w;
+	int i;
+
+	for (i = 0; i < t->num_wpans; )
+	{
+		w = &t->wpans[i];
+
+		if (!w->pending)
+		{
+			i++;
+			continue;
+		}
+
+		if (iwpaninfo_get_info_live(w->info.ifname, &w->info))
+		{
+			t->wpans[i] = t->wpans[--t->num_wpans];
+			continue;
+		}
+
+		w->pending = 0;
+		topo_add_phy(t, &w->info);
+		t->changed++;
+		i++;
+	}
+}
+
+int iwpaninfo_topology_event_open(struct iwpaninfo_topology *t)
+{
+	if (t->listening)
+		return iwpaninfo_registry_fd();
+
+	if (iwpaninfo_registry_listen(topo_registry_cb, t))
+		return -1;
+
+	t->listening = 1;
+	t->changed = 0;
+	t->resync = 0;
+
+	if (iwpaninfo_topology_build(t))
+	{
+		iwpaninfo_topology_free(t);
+		return -1;
+	}
+
+	return iwpaninfo_registry_fd();
+}
+
+int iwpaninfo_topology_event(struct iwpaninfo_topology *t)
+{
+	int changed;
+
+	if (!t->listening || iwpaninfo_registry_update() < 0)
+		return -1;
+
+	if (t->resync)
+	{
+		t->resync = 0;
+		t->changed = 0;
+
+		return iwpaninfo_topology_build(t) ? -1 : t->num_wpans + 1;
+	}
+
+	topo_resolve(t);
+
+	changed = t->changed;
+	t->changed = 0;
+
+	return changed;
+}
+
+void iwpaninfo_topology_free(struct iwpaninfo_topology *t)
+{
+	if (t->listening)
+		iwpaninfo_registry_unlisten(topo_registry_cb, t);
+
+	t->listening = 0;
+}
@@ -22,8 +22,8 @@
 #include "iwpaninfo/utils.h"
 
 
-static int ioctl_socket = -1;
-struct uci_context *uci_ctx = NULL;
+static __thread int ioctl_socket = -1;
+__thread struct uci_context *uci_ctx = NULL;
 
 static int iwpaninfo_ioctl_socket(void)
 {
@@ -43,37 +43,192 @@ int iwpaninfo_ioctl(int cmd, void *ifr)
 	return ioctl(s, cmd, ifr);
 }
 
-int iwpaninfo_dbm2mw(int in)
+/*
+ * 10^(k/100) scaled by 10^6, one entry per 10 mBm step of a decade. The
+ * power conversions interpolate linearly between neighbouring entries,
+ * which stays well below 0.01 dB off over the whole range.
+ */
+static const uint32_t mbm_decade[101] = {
+	1000000, 1023293, 1047129, 1071519, 1096478, 1122018,
+	1148154, 1174898, 1202264, 1230269, 1258925, 1288250,
+	1318257, 1348963, 1380384, 1412538, 1445440, 1479108,
+	1513561, 1548817, 1584893, 1621810, 1659587, 1698244,
+	1737801, 1778279, 1819701, 1862087, 1905461, 1949845,
+	1995262, 2041738, 2089296, 2137962, 2187762, 2238721,
+	2290868, 2344229, 2398833, 2454709, 2511886, 2570396,
+	2630268, 2691535, 2754229, 2818383, 2884032, 2951209,
+	3019952, 3090295, 3162278, 3235937, 3311311, 3388442,
+	3467369, 3548134, 3630781, 3715352, 3801894, 3890451,
+	3981072, 4073803, 4168694, 4265795, 4365158, 4466836,
+	4570882, 4677351, 4786301, 4897788, 5011872, 5128614,
+	5248075, 5370318, 5495409, 5623413, 5754399, 5888437,
+	6025596, 6165950, 6309573, 6456542, 6606934, 6760830,
+	6918310, 7079458, 7244360, 7413102, 7585776, 7762471,
+	7943282, 8128305, 8317638, 8511380, 8709636, 8912509,
+	9120108, 9332543, 9549926, 9772372, 10000000,
+};
+
+static const uint32_t pow10_tab[10] = {
+	1, 10, 100, 1000, 10000, 100000, 1000000,
+	10000000, 100000000, 1000000000,
+};
+
+uint32_t iwpaninfo_mbm2uw(int32_t mbm)
 {
-	double res = 1.0;
-	int ip = in / 10;
-	int fp = in % 10;
+	uint64_t m, uw;
+	int32_t t;
 	int k;
 
-	for(k = 0; k < ip; k++) res *= 10;
-	for(k = 0; k < fp; k++) res *= LOG10_MAGIC;
+	/* below 1 uW only rounding is left, 70 dBm no longer fits */
+	if (mbm < -3000)
+		return (mbm >= -3301);
+
+	if (mbm >= 7000)
+		return UINT32_MAX;
+
+	t = mbm + 3000;
+	k = (t % 1000) / 10;
 
-	return (int)res;
+	m = mbm_decade[k] +
+		(uint64_t)(mbm_decade[k + 1] - mbm_decade[k]) * (t % 10) / 10;
+	uw = (m * pow10_tab[t / 1000] + 500000) / 1000000;
+
+	return (uw > UINT32_MAX) ? UINT32_MAX : uw;
 }
 
-int iwpaninfo_mw2dbm(int in)
+int32_t iwpaninfo_uw2mbm(uint32_t uw)
 {
-	double fin = (double) in;
-	int res = 0;
+	uint64_t m, span;
+	int d = 0, lo = 0, hi = 100, k;
+
+	if (!uw)
+		return INT32_MIN;
+
+	while (d < 9 && uw >= pow10_tab[d + 1])
+		d++;
+
+	/* mantissa in [10^6, 10^7), then locate it within the decade */
+	m = (uint64_t)uw * 1000000 / pow10_tab[d];
 
-	while(fin > 10.0)
+	while (hi - lo > 1)
 	{
-		res += 10;
-		fin /= 10.0;
+		k = (lo + hi) / 2;
+
+		if (mbm_decade[k] <= m)
+			lo = k;
+		else
+			hi = k;
 	}
 
-	while(fin > 1.000001)
+	span = mbm_decade[lo + 1] - mbm_decade[lo];
+
+	return d * 1000 + lo * 10 - 3000 +
+		((m - mbm_decade[lo]) * 20 + span) / (2 * span);
+}
+
+int iwpaninfo_dbm2mw(int in)
+{
+	/* the float version this replaced never went below 1 mW */
+	if (in < 0)
+		return 1;
+
+	return iwpaninfo_mbm2uw(in * 100) / 1000;
+}
+
+int iwpaninfo_mw2dbm(int in)
+{
+	if (in <= 0)
+		return 0;
+
+	return (iwpaninfo_uw2mbm((uint32_t)in * 1000) + 50) / 100;
+}
+
+/* Format val / 10^digits without going through floating point */
+char * iwpaninfo_format_fixed(char *buf, size_t size, long long val, int digits)
+{
+	long long div = 1;
+	unsigned long long mag = (val < 0) ? -(unsigned long long)val : val;
+	int i, len;
+
+	for (i = 0; i < digits; i++)
+		div *= 10;
+
+	len = snprintf(buf, size, "%s%llu.%0*llu", (val < 0) ? "-" : "",
+	               mag / div, digits, mag % div);
+
+	if (len >= size)
+		len = size - 1;
+
+	while (len > 1 && buf[len - 1] == '0')
+		buf[--len] = 0;
+
+	if (buf[len - 1] == '.')
+		buf[--len] = 0;
+
+	return buf;
+}
+
+/*
+ * Channel center frequency in kHz, 0 for channels the page does not
+ * define. Integer so the frequency lists need no floating point.
+ */
+uint32_t iwpaninfo_channel2khz(int page, int channel)
+{
+	static const uint32_t uwb[16] = {
+		499200, 3494400, 3993600, 4492800, 3993600, 6489600,
+		6988800, 6489600, 7488000, 7987200, 8486400, 7987200,
+		8985600, 9484800, 9984000, 9484800,
+	};
+
+	switch (page)
 	{
-		res += 1;
-		fin /= LOG10_MAGIC;
+	case 0:
+		if (channel == 0)
+			return 868300;
+		else if (channel > 0 && channel < 11)
+			return 906000 + 2000 * (channel - 1);
+		else if (channel > 0)
+			return 2405000 + 5000 * (channel - 11);
+		break;
+
+	case 1:
+	case 2:
+		if (channel == 0)
+			return 868300;
+		else if (channel >= 1 && channel <= 10)
+			return 906000 + 2000 * (channel - 1);
+		break;
+
+	case 3:
+		if (channel >= 0 && channel <= 12)
+			return 2412000 + 5000 * channel;
+		else if (channel == 13)
+			return 2484000;
+		break;
+
+	case 4:
+		if (channel >= 0 && channel < ARRAY_SIZE(uwb))
+			return uwb[channel];
+		break;
+
+	case 5:
+		if (channel >= 0 && channel <= 3)
+			return 780000 + 2000 * channel;
+		else if (channel >= 4 && channel <= 7)
+			return 780000 + 2000 * (channel - 4);
+		break;
+
+	case 6:
+		if (channel >= 0 && channel <= 7)
+			return 951200 + 600 * channel;
+		else if (channel >= 8 && channel <= 9)
+			return 954400 + 200 * (channel - 8);
+		else if (channel >= 10 && channel <= 21)
+			return 951100 + 400 * (channel - 10);
+		break;
 	}
 
-	return (int)res;
+	return 0;
 }
 
 int iwpaninfo_ifup(const char *ifname)
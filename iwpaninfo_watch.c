@@ -0,0 +1,79 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - Refresh scheduling
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "iwpaninfo/watch.h"
+
+static void iwpaninfo_watch_timer_cb(struct uloop_timeout *t)
+{
+	struct iwpaninfo_watch *w = container_of(t, struct iwpaninfo_watch, timer);
+
+	w->changed = w->pending;
+	w->pending = 0;
+
+	w->refresh(w);
+
+	w->changed = 0;
+	uloop_timeout_set(t, w->interval * 1000);
+}
+
+static void iwpaninfo_watch_event_cb(struct uloop_fd *fd, unsigned int events)
+{
+	struct iwpaninfo_watch *w = container_of(fd, struct iwpaninfo_watch, event_fd);
+	int n = w->ops->event_read();
+
+	if (n < 0)
+	{
+		fprintf(stderr, "Event socket failed, relying on periodic refresh\n");
+		uloop_fd_delete(fd);
+		return;
+	}
+
+	/* coalesce bursts of notifications into a single refresh */
+	if (n > 0)
+	{
+		w->pending = 1;
+		uloop_timeout_set(&w->timer, IWPANINFO_WATCH_DEBOUNCE);
+	}
+}
+
+int iwpaninfo_watch_start(struct iwpaninfo_watch *w)
+{
+	int fd = w->ops->event_open ? w->ops->event_open() : -1;
+
+	if (fd >= 0)
+	{
+		w->event_fd.fd = fd;
+		w->event_fd.cb = iwpaninfo_watch_event_cb;
+		uloop_fd_add(&w->event_fd, ULOOP_READ);
+	}
+
+	/* the first refresh sees everything as changed */
+	w->pending = 1;
+	w->timer.cb = iwpaninfo_watch_timer_cb;
+	iwpaninfo_watch_timer_cb(&w->timer);
+
+	return (fd >= 0) ? 0 : 1;
+}
+
+void iwpaninfo_watch_stop(struct iwpaninfo_watch *w)
+{
+	uloop_timeout_cancel(&w->timer);
+
+	if (w->event_fd.registered)
+		uloop_fd_delete(&w->event_fd);
+}
@@ -0,0 +1,436 @@
+/*
+ * iwpaninfo - 802.15.4 WPAN Information Library - ubus caching daemon
+ *
+ * Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+ *
+ * The iwpaninfo library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * The iwpaninfo library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+ *
+ *
+ * Keeps a snapshot of every WPAN interface and the capabilities of its phy
+ * in memory and answers iwpaninfo.info, iwpaninfo.caps and iwpaninfo.list
+ * over ubus. The snapshot is refreshed by one enumeration dump whenever an
+ * nl802154 notification arrives and on a periodic timer, so the kernel
+ * sees the same query load regardless of the number of consumers.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include <libubox/uloop.h>
+#include <libubox/blobmsg.h>
+#include <libubus.h>
+
+#include "iwpaninfo.h"
+#include "iwpaninfo/watch.h"
+
+#define IWPANINFOD_REFRESH	10	/* s */
+
+struct iwpaninfod_caps {
+	int phy;
+	int valid;
+	struct iwpaninfo_phy_caps caps;
+};
+
+static struct iwpaninfo_info ifaces[IWPANINFO_MAX_IFACES];
+static struct iwpaninfod_caps caps[IWPANINFO_MAX_IFACES];
+static int num_ifaces;
+static int num_dropped;
+
+static struct ubus_context *ctx;
+static struct blob_buf b;
+
+static struct iwpaninfo_watch watch = { .interval = IWPANINFOD_REFRESH };
+
+
+static void iwpaninfod_refresh(struct iwpaninfo_watch *w)
+{
+	int i, j, n;
+
+	n = iwpaninfo_get_dump_live(ifaces, IWPANINFO_MAX_IFACES);
+	num_ifaces = (n > 0) ? n : 0;
+
+	if (iwpaninfo_dump_total() - num_ifaces != num_dropped)
+	{
+		num_dropped = iwpaninfo_dump_total() - num_ifaces;
+
+		if (num_dropped)
+			fprintf(stderr, "Serving %d of %d interfaces, table is full\n",
+			        num_ifaces, num_ifaces + num_dropped);
+	}
+
+	/* drop cached caps of phys that disappeared, keep the others */
+	for (i = 0; i < IWPANINFO_MAX_IFACES; i++)
+	{
+		if (!caps[i].valid)
+			continue;
+
+		for (j = 0; j < num_ifaces; j++)
+			if ((ifaces[j].valid & IWPANINFO_FIELD_PHY) &&
+			    ifaces[j].phy == caps[i].phy)
+				break;
+
+		if (j == num_ifaces)
+			caps[i].valid = 0;
+	}
+}
+
+static struct iwpaninfo_info * iwpaninfod_find(const char *ifname)
+{
+	int i;
+
+	for (i = 0; i < num_ifaces; i++)
+		if (!strcmp(ifaces[i].ifname, ifname))
+			return &ifaces[i];
+
+	return NULL;
+}
+
+static struct iwpaninfo_phy_caps * iwpaninfod_caps(struct iwpaninfo_info *info)
+{
+	struct iwpaninfod_caps *slot = NULL;
+	int i;
+
+	if (!(info->valid & IWPANINFO_FIELD_PHY))
+		return NULL;
+
+	for (i = 0; i < IWPANINFO_MAX_IFACES; i++)
+	{
+		if (caps[i].valid && caps[i].phy == info->phy)
+			return &caps[i].caps;
+
+		if (!caps[i].valid && !slot)
+			slot = &caps[i];
+	}
+
+	if (!slot || !watch.ops->caps || watch.ops->caps(info->ifname, &slot->caps))
+		return NULL;
+
+	slot->phy = info->phy;
+	slot->valid = 1;
+
+	return &slot->caps;
+}
+
+
+static void iwpaninfod_add_info(struct iwpaninfo_info *info)
+{
+	char buf[24];
+	int i;
+
+	blobmsg_add_string(&b, "phyname", info->phyname);
+
+	for (i = 0; i < IWPANINFO_FIELD_COUNT; i++)
+	{
+		if (!(info->valid & (1 << i)))
+			continue;
+
+		switch (1 << i)
+		{
+		case IWPANINFO_FIELD_IFINDEX:
+			blobmsg_add_u32(&b, IWPANINFO_FIELD_NAMES[i], info->ifindex);
+			break;
+
+		case IWPANINFO_FIELD_PHY:
+			blobmsg_add_u32(&b, IWPANINFO_FIELD_NAMES[i], info->phy);
+			break;
+
+		case IWPANINFO_FIELD_WPAN_DEV:
+			blobmsg_add_u64(&b, IWPANINFO_FIELD_NAMES[i], info->wpan_dev);
+			break;
+
+		case IWPANINFO_FIELD_MODE:
+			blobmsg_add_string(&b, IWPANINFO_FIELD_NAMES[i],
+				IWPANINFO_OPMODE_NAMES[info->mode < IWPANINFO_OPMODE_UNKNOWN
+					? info->mode : IWPANINFO_OPMODE_UNKNOWN]);
+			break;
+
+		case IWPANINFO_FIELD_PAGE:
+			blobmsg_add_u32(&b, IWPANINFO_FIELD_NAMES[i], info->page);
+			break;
+
+		case IWPANINFO_FIELD_CHANNEL:
+			blobmsg_add_u32(&b, IWPANINFO_FIELD_NAMES[i], info->channel);
+			break;
+
+		case IWPANINFO_FIELD_FREQUENCY:
+			blobmsg_add_u32(&b, IWPANINFO_FIELD_NAMES[i], info->frequency);
+			break;
+
+		case IWPANINFO_FIELD_TXPOWER:
+			blobmsg_add_u32(&b, IWPANINFO_FIELD_NAMES[i], info->txpower);
+			break;
+
+		case IWPANINFO_FIELD_PANID:
+			snprintf(buf, sizeof(buf), "0x%04x", info->panid);
+			blobmsg_add_string(&b, IWPANINFO_FIELD_NAMES[i], buf);
+			break;
+
+		case IWPANINFO_FIELD_SHORT_ADDR:
+			snprintf(buf, sizeof(buf), "0x%04x", info->short_address);
+			blobmsg_add_string(&b, IWPANINFO_FIELD_NAMES[i], buf);
+			break;
+
+		case IWPANINFO_FIELD_EXTENDED_ADDR:
+			snprintf(buf, sizeof(buf), "0x%016" PRIx64, info->extended_address);
+			blobmsg_add_string(&b, IWPANINFO_FIELD_NAMES[i], buf);
+			break;
+
+		case IWPANINFO_FIELD_MIN_BE:
+			blobmsg_add_u32(&b, IWPANINFO_FIELD_NAMES[i], info->min_be);
+			break;
+
+		case IWPANINFO_FIELD_MAX_BE:
+			blobmsg_add_u32(&b, IWPANINFO_FIELD_NAMES[i], info->max_be);
+			break;
+
+		case IWPANINFO_FIELD_CSMA_BACKOFF:
+			blobmsg_add_u32(&b, IWPANINFO_FIELD_NAMES[i], info->csma_backoff);
+			break;
+
+		case IWPANINFO_FIELD_FRAME_RETRY:
+			blobmsg_add_u32(&b, IWPANINFO_FIELD_NAMES[i], info->frame_retry);
+			break;
+
+		case IWPANINFO_FIELD_LBT_MODE:
+			blobmsg_add_u8(&b, IWPANINFO_FIELD_NAMES[i], info->lbt_mode);
+			break;
+
+		case IWPANINFO_FIELD_CCA_MODE:
+			blobmsg_add_u32(&b, IWPANINFO_FIELD_NAMES[i], info->cca_mode);
+			break;
+
+		case IWPANINFO_FIELD_CCA_OPT:
+			blobmsg_add_u32(&b, IWPANINFO_FIELD_NAMES[i], info->cca_opt);
+			break;
+
+		case IWPANINFO_FIELD_CCA_ED_LEVEL:
+			blobmsg_add_u32(&b, IWPANINFO_FIELD_NAMES[i], info->cca_ed_level);
+			break;
+		}
+	}
+}
+
+static void iwpaninfod_add_caps(struct iwpaninfo_phy_caps *c)
+{
+	void *a, *t;
+	char key[8];
+	uint32_t i;
+
+	t = blobmsg_open_table(&b, "channels");
+	for (i = 0; i < IWPANINFO_MAX_PAGES; i++)
+	{
+		if (!c->channels[i])
+			continue;
+
+		snprintf(key, sizeof(key), "%u", i);
+		blobmsg_add_u32(&b, key, c->channels[i]);
+	}
+	blobmsg_close_table(&b, t);
+
+	a = blobmsg_open_array(&b, "txpowers");
+	for (i = 0; i < c->num_txpowers; i++)
+		blobmsg_add_u32(&b, NULL, c->txpowers[i]);
+	blobmsg_close_array(&b, a);
+
+	a = blobmsg_open_array(&b, "cca_ed_levels");
+	for (i = 0; i < c->num_cca_ed_levels; i++)
+		blobmsg_add_u32(&b, NULL, c->cca_ed_levels[i]);
+	blobmsg_close_array(&b, a);
+
+	blobmsg_add_u32(&b, "iftypes", c->iftypes);
+	blobmsg_add_u32(&b, "cca_modes", c->cca_modes);
+	blobmsg_add_u32(&b, "cca_opts", c->cca_opts);
+	blobmsg_add_u32(&b, "lbt", c->lbt);
+	blobmsg_add_u32(&b, "min_minbe", c->min_minbe);
+	blobmsg_add_u32(&b, "max_minbe", c->max_minbe);
+	blobmsg_add_u32(&b, "min_maxbe", c->min_maxbe);
+	blobmsg_add_u32(&b, "max_maxbe", c->max_maxbe);
+	blobmsg_add_u32(&b, "min_csma_backoffs", c->min_csma_backoffs);
+	blobmsg_add_u32(&b, "max_csma_backoffs", c->max_csma_backoffs);
+	blobmsg_add_u32(&b, "min_frame_retries", c->min_frame_retries);
+	blobmsg_add_u32(&b, "max_frame_retries", c->max_frame_retries);
+}
+
+
+enum {
+	IWPANINFOD_DEVICE,
+	__IWPANINFOD_MAX,
+};
+
+static const struct blobmsg_policy device_policy[__IWPANINFOD_MAX] = {
+	[IWPANINFOD_DEVICE] = { .name = "device", .type = BLOBMSG_TYPE_STRING },
+};
+
+static struct iwpaninfo_info * iwpaninfod_lookup(struct blob_attr *msg)
+{
+	struct blob_attr *tb[__IWPANINFOD_MAX];
+
+	blobmsg_parse(device_policy, __IWPANINFOD_MAX, tb,
+	              blob_data(msg), blob_len(msg));
+
+	if (!tb[IWPANINFOD_DEVICE])
+		return NULL;
+
+	return iwpaninfod_find(blobmsg_get_string(tb[IWPANINFOD_DEVICE]));
+}
+
+static int iwpaninfod_info(struct ubus_context *ctx, struct ubus_object *obj,
+                           struct ubus_request_data *req, const char *method,
+                           struct blob_attr *msg)
+{
+	struct iwpaninfo_info *info = iwpaninfod_lookup(msg);
+
+	if (!info)
+		return UBUS_STATUS_NOT_FOUND;
+
+	blob_buf_init(&b, 0);
+	iwpaninfod_add_info(info);
+	ubus_send_reply(ctx, req, b.head);
+
+	return UBUS_STATUS_OK;
+}
+
+static int iwpaninfod_caps_req(struct ubus_context *ctx, struct ubus_object *obj,
+                               struct ubus_request_data *req, const char *method,
+                               struct blob_attr *msg)
+{
+	struct iwpaninfo_info *info = iwpaninfod_lookup(msg);
+	struct iwpaninfo_phy_caps *c;
+
+	if (!info)
+		return UBUS_STATUS_NOT_FOUND;
+
+	c = iwpaninfod_caps(info);
+	if (!c)
+		return UBUS_STATUS_UNKNOWN_ERROR;
+
+	blob_buf_init(&b, 0);
+	iwpaninfod_add_caps(c);
+	ubus_send_reply(ctx, req, b.head);
+
+	return UBUS_STATUS_OK;
+}
+
+static int iwpaninfod_list(struct ubus_context *ctx, struct ubus_object *obj,
+                           struct ubus_request_data *req, const char *method,
+                           struct blob_attr *msg)
+{
+	void *t;
+	int i;
+
+	blob_buf_init(&b, 0);
+
+	for (i = 0; i < num_ifaces; i++)
+	{
+		t = blobmsg_open_table(&b, ifaces[i].ifname);
+		iwpaninfod_add_info(&ifaces[i]);
+		blobmsg_close_table(&b, t);
+	}
+
+	ubus_send_reply(ctx, req, b.head);
+
+	return UBUS_STATUS_OK;
+}
+
+static const struct ubus_method iwpaninfod_methods[] = {
+	UBUS_METHOD("info", iwpaninfod_info, device_policy),
+	UBUS_METHOD("caps", iwpaninfod_caps_req, device_policy),
+	UBUS_METHOD_NOARG("list", iwpaninfod_list),
+};
+
+static struct ubus_object_type iwpaninfod_object_type =
+	UBUS_OBJECT_TYPE("iwpaninfo", iwpaninfod_methods);
+
+static struct ubus_object iwpaninfod_object = {
+	.name = "iwpaninfo",
+	.type = &iwpaninfod_object_type,
+	.methods = iwpaninfod_methods,
+	.n_methods = ARRAY_SIZE(iwpaninfod_methods),
+};
+
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage:\n"
+		"	%s [-s <ubus socket>] [-r <refresh seconds>]\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	const char *ubus_socket = NULL;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "s:r:")) != -1)
+	{
+		switch (ch)
+		{
+		case 's':
+			ubus_socket = optarg;
+			break;
+
+		case 'r':
+			watch.interval = atoi(optarg);
+			if (watch.interval <= 0)
+				watch.interval = IWPANINFOD_REFRESH;
+			break;
+
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	watch.ops = iwpaninfo_backend_by_name("nl802154");
+	if (!watch.ops)
+	{
+		fprintf(stderr, "No nl802154 backend available\n");
+		return 1;
+	}
+
+	uloop_init();
+
+	ctx = ubus_connect(ubus_socket);
+	if (!ctx)
+	{
+		fprintf(stderr, "Failed to connect to ubus\n");
+		return 1;
+	}
+
+	ubus_add_uloop(ctx);
+
+	if (ubus_add_object(ctx, &iwpaninfod_object))
+	{
+		fprintf(stderr, "Failed to publish ubus object\n");
+		ubus_free(ctx);
+		return 1;
+	}
+
+	watch.refresh = iwpaninfod_refresh;
+
+	if (iwpaninfo_watch_start(&watch))
+		fprintf(stderr, "No nl802154 events, relying on periodic refresh\n");
+
+	uloop_run();
+
+	iwpaninfo_watch_stop(&watch);
+
+	ubus_free(ctx);
+	uloop_done();
+	blob_buf_free(&b);
+	iwpaninfo_finish();
+
+	return 0;
+}
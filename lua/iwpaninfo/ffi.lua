@@ -0,0 +1,169 @@
+--[[
+iwpaninfo - 802.15.4 WPAN Information Library - LuaJIT FFI Binding
+
+Copyright (C) 2017 Xue Liu <liuxuenetmail@gmail.com>
+
+The iwpaninfo library is free software: you can redistribute it and/or
+modify it under the terms of the GNU General Public License version 2
+as published by the Free Software Foundation.
+
+The iwpaninfo library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with the iwpaninfo library. If not, see http://www.gnu.org/licenses/.
+
+
+Snapshots are returned as cdata backed by C memory, fields are read
+directly (info.channel, caps.txpowers[i]) without building Lua tables.
+Classic Lua keeps using the iwpaninfo C module.
+]]
+
+local ffi = require "ffi"
+
+-- must match IWPANINFO_ABI_VERSION and the structs in iwpaninfo.h
+local ABI_VERSION = 3
+
+-- must match IWPANINFO_MAX_IFACES
+local MAX_IFACES = 256
+
+ffi.cdef[[
+struct iwpaninfo_info {
+	uint64_t wpan_dev;
+	uint64_t extended_address;
+	uint32_t valid;
+	uint32_t ifindex;
+	uint32_t phy;
+	int32_t txpower;
+	int32_t cca_ed_level;
+	uint32_t frequency;
+	uint16_t panid;
+	uint16_t short_address;
+	uint8_t mode;
+	uint8_t page;
+	uint8_t channel;
+	uint8_t min_be;
+	uint8_t max_be;
+	uint8_t csma_backoff;
+	int8_t frame_retry;
+	uint8_t lbt_mode;
+	uint8_t cca_mode;
+	uint8_t cca_opt;
+	char ifname[16];
+	char phyname[32];
+};
+
+struct iwpaninfo_phy_caps {
+	uint32_t channels[32];
+	int32_t txpowers[64];
+	int32_t cca_ed_levels[64];
+	uint32_t num_txpowers;
+	uint32_t num_cca_ed_levels;
+	uint32_t iftypes;
+	uint32_t cca_modes;
+	uint32_t cca_opts;
+	uint32_t lbt;
+	uint32_t commands[4];
+	uint8_t min_minbe;
+	uint8_t max_minbe;
+	uint8_t min_maxbe;
+	uint8_t max_maxbe;
+	uint8_t min_csma_backoffs;
+	uint8_t max_csma_backoffs;
+	int8_t min_frame_retries;
+	int8_t max_frame_retries;
+};
+
+unsigned int iwpaninfo_abi_version(void);
+int iwpaninfo_get_info(const char *ifname, struct iwpaninfo_info *info);
+int iwpaninfo_get_caps(const char *ifname, struct iwpaninfo_phy_caps *caps);
+int iwpaninfo_get_dump(struct iwpaninfo_info *info, int max);
+void iwpaninfo_finish(void);
+]]
+
+local C = ffi.load("iwpaninfo")
+
+if C.iwpaninfo_abi_version() ~= ABI_VERSION then
+	error("iwpaninfo.ffi: library ABI version " ..
+	      tonumber(C.iwpaninfo_abi_version()) .. " does not match " ..
+	      ABI_VERSION)
+end
+
+local info_t = ffi.typeof("struct iwpaninfo_info")
+local info_array_t = ffi.typeof("struct iwpaninfo_info[?]")
+local caps_t = ffi.typeof("struct iwpaninfo_phy_caps")
+
+local M = {
+	FIELD = {
+		IFINDEX       = 0x00001,
+		PHY           = 0x00002,
+		WPAN_DEV      = 0x00004,
+		MODE          = 0x00008,
+		PAGE          = 0x00010,
+		CHANNEL       = 0x00020,
+		FREQUENCY     = 0x00040,
+		TXPOWER       = 0x00080,
+		PANID         = 0x00100,
+		SHORT_ADDR    = 0x00200,
+		EXTENDED_ADDR = 0x00400,
+		MIN_BE        = 0x00800,
+		MAX_BE        = 0x01000,
+		CSMA_BACKOFF  = 0x02000,
+		FRAME_RETRY   = 0x04000,
+		LBT_MODE      = 0x08000,
+		CCA_MODE      = 0x10000,
+		CCA_OPT       = 0x20000,
+		CCA_ED_LEVEL  = 0x40000,
+	}
+}
+
+-- Fill out (or a new struct) with the snapshot of ifname, nil on failure
+function M.info(ifname, out)
+	out = out or info_t()
+	if C.iwpaninfo_get_info(ifname, out) ~= 0 then
+		return nil
+	end
+	return out
+end
+
+-- Fill out (or a new struct) with the phy capabilities, nil on failure
+function M.caps(ifname, out)
+	out = out or caps_t()
+	if C.iwpaninfo_get_caps(ifname, out) ~= 0 then
+		return nil
+	end
+	return out
+end
+
+-- Snapshot all interfaces into buf (or a new array of max entries),
+-- returns the number of entries and the zero based array. An array buf
+-- caps max at its length, a pointer buf needs max.
+function M.all(buf, max)
+	if not buf then
+		max = max or MAX_IFACES
+		buf = info_array_t(max)
+	else
+		local len = math.floor(ffi.sizeof(buf) / ffi.sizeof(info_t))
+
+		if len > 0 then
+			max = math.min(max or len, len)
+		elseif not max then
+			error("iwpaninfo.ffi: all() needs max for a pointer buffer")
+		end
+	end
+
+	return C.iwpaninfo_get_dump(buf, max), buf
+end
+
+function M.valid(info, field)
+	return bit.band(info.valid, field) ~= 0
+end
+
+M.new_info = info_t
+M.new_info_array = info_array_t
+M.new_caps = caps_t
+M.finish = C.iwpaninfo_finish
+
+return M